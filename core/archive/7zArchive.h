@@ -38,6 +38,8 @@ public:
 
 	ArchiveFile* OpenFile(const char* name) override;
 	ArchiveFile *OpenFileByCrc(u32 crc) override;
+	// 7z archives are usually solid
+	bool randomAccess() const override { return false; }
 
 protected:
 	bool Open(FILE *file) override;
@@ -37,6 +37,8 @@ public:
 	virtual ~Archive() = default;
 	virtual ArchiveFile *OpenFile(const char *name) = 0;
 	virtual ArchiveFile *OpenFileByCrc(u32 crc) = 0;
+	// Returns true if files can be extracted without decompressing the preceding ones
+	virtual bool randomAccess() const { return true; }
 
 protected:
 	virtual bool Open(FILE *file) = 0;
@@ -3,6 +3,7 @@
 #include <alsa/asoundlib.h>
 #include "cfg/cfg.h"
 #include "cfg/option.h"
+#include "profiler/perf_counters.h"
 
 class AlsaAudioBackend : public AudioBackend
 {
@@ -266,6 +267,7 @@ public:
 			if (rc == -EPIPE)
 			{
 				// EPIPE means underrun
+				perfcounters::add(perfcounters::AudioUnderruns);
 				// Write some silence then our samples
 				const size_t silence_size = buffer_size - samples;
 				void *silence = alloca(silence_size * 4);
@@ -4,6 +4,7 @@
 #include "audiostream.h"
 #include "cfg/option.h"
 #include "stdclass.h"
+#include "profiler/perf_counters.h"
 
 #include <algorithm>
 #include <atomic>
@@ -38,6 +39,7 @@ class SDLAudioBackend : AudioBackend
 		{
 			// No data, just output a bit of silence for the underrun
 			memset(stream, 0, len);
+			perfcounters::add(perfcounters::AudioUnderruns);
 			backend->stream_mutex.unlock();
 			backend->read_wait.Set();
 			return;
@@ -7,6 +7,7 @@
 
 #include "cfg/cfg.h"
 #include "stdclass.h"
+#include "hw/pvr/ta_capture.h"
 
 static int setconfig(char *arg[], int cl)
 {
@@ -80,6 +81,9 @@ static int showhelp()
 	printf("-config	section:key=value     add a virtual config value;\n");
 	printf("                              virtual config values won't be saved to the .cfg file\n");
 	printf("                              unless a different value is written to them\n");
+	printf("-replay-ta file               replay a captured TA frame through the renderer\n");
+	printf("                              and print the timings\n");
+	printf("-replay-count n               number of times the captured frame is replayed\n");
 	printf("-help                         display this help\n");
 
 	exit(0);
@@ -89,6 +93,8 @@ static int showhelp()
 void ParseCommandLine(int argc,char* argv[])
 {
 	settings.content.path.clear();
+	std::string replayPath;
+	int replayCount = 100;
 	int cl=argc-2;
 	char** arg=argv+1;
 	while(cl>=0)
@@ -103,6 +109,28 @@ void ParseCommandLine(int argc,char* argv[])
 			cl-=as;
 			arg+=as;
 		}
+		else if (stricmp(*arg, "-replay-ta") == 0 || stricmp(*arg, "--replay-ta") == 0)
+		{
+			if (cl < 1)
+				WARN_LOG(COMMON, "-replay-ta : missing file name");
+			else
+			{
+				replayPath = arg[1];
+				cl--;
+				arg++;
+			}
+		}
+		else if (stricmp(*arg, "-replay-count") == 0 || stricmp(*arg, "--replay-count") == 0)
+		{
+			if (cl < 1)
+				WARN_LOG(COMMON, "-replay-count : missing count");
+			else
+			{
+				replayCount = atoi(arg[1]);
+				cl--;
+				arg++;
+			}
+		}
 #if defined(__APPLE__)
 		else if (!strncmp(*arg, "-NSDocumentRevisions", 20))
 		{
@@ -140,4 +168,6 @@ void ParseCommandLine(int argc,char* argv[])
 		arg++;
 		cl--;
 	}
+	if (!replayPath.empty())
+		tacapture::setReplay(replayPath, replayCount);
 }
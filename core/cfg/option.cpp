@@ -25,6 +25,7 @@ namespace config {
 // Dynarec
 
 Option<bool> DynarecEnabled("Dynarec.Enabled", true);
+Option<bool> ShadowMMU("Dynarec.ShadowMMU", false);
 Option<int> Sh4Clock("Sh4Clock", 200);
 
 // General
@@ -57,6 +58,7 @@ Option<bool> AutoLatency("aica.AutoLatency",
 		false
 #endif
 		);
+Option<bool> ThreadedAica("aica.Threaded", false);
 
 OptionString AudioBackend("backend", "auto", "audio");
 AudioVolumeOption AudioVolume;
@@ -133,6 +135,10 @@ Option<int> GDBPort("Debug.GDBPort", debugger::DEFAULT_PORT);
 Option<bool> GDBWaitForConnection("Debug.GDBWaitForConnection");
 Option<bool> UseReios("UseReios");
 Option<bool> FastGDRomLoad("FastGDRomLoad", false);
+Option<int> ChdCacheHunks("ChdCacheHunks", 32);
+Option<bool> ChdReadAhead("ChdReadAhead", true);
+Option<bool> GDRomPrefetch("GDRomPrefetch", true);
+Option<bool> GDDecryptionCache("naomi.GDDecryptionCache", false);
 Option<bool> RamMod32MB("Dreamcast.RamMod32MB", false);
 
 Option<bool> OpenGlChecks("OpenGlChecks", false, "validate");
@@ -160,6 +166,10 @@ Option<bool> ProfilerEnabled("Profiler.Enabled");
 Option<bool> ProfilerDrawToGUI("Profiler.DrawGUI");
 Option<bool> ProfilerOutputTTY("Profiler.OutputTTY");
 Option<float> ProfilerFrameWarningTime("Profiler.FrameWarningTime", 1.0f / 55.0f);
+Option<bool> ProfilerTrace("Profiler.Trace");
+Option<bool> PerfCounters("Profiler.Counters");
+Option<int> PerfCountersPort("Profiler.CountersPort", 8010);
+Option<bool> PerfCountersFile("Profiler.CountersFile");
 
 // Network
 
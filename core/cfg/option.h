@@ -350,6 +350,7 @@ using OptionString = Option<std::string>;
 // Dynarec
 
 extern Option<bool> DynarecEnabled;
+extern Option<bool> ShadowMMU;	// experimental, x64 only
 #ifndef LIBRETRO
 extern Option<int> Sh4Clock;
 #endif
@@ -375,6 +376,7 @@ constexpr bool LimitFPS = true;
 extern Option<bool> DSPEnabled;
 extern Option<int> AudioBufferSize;	//In samples ,*4 for bytes
 extern Option<bool> AutoLatency;
+extern Option<bool> ThreadedAica;	// experimental, not used with netplay
 
 extern OptionString AudioBackend;
 
@@ -489,6 +491,10 @@ extern Option<int> GDBPort;
 extern Option<bool> GDBWaitForConnection;
 extern Option<bool> UseReios;
 extern Option<bool> FastGDRomLoad;
+extern Option<int> ChdCacheHunks;		// number of decompressed CHD hunks kept in memory
+extern Option<bool> ChdReadAhead;
+extern Option<bool> GDRomPrefetch;		// read GD-ROM sectors ahead on the I/O thread
+extern Option<bool> GDDecryptionCache;	// save decrypted NAOMI GD-ROM images to disk
 extern Option<bool> RamMod32MB;
 
 extern Option<bool> OpenGlChecks;
@@ -516,6 +522,10 @@ extern Option<bool> ProfilerEnabled;
 extern Option<bool> ProfilerDrawToGUI;
 extern Option<bool> ProfilerOutputTTY;
 extern Option<float> ProfilerFrameWarningTime;
+extern Option<bool> ProfilerTrace;
+extern Option<bool> PerfCounters;
+extern Option<int> PerfCountersPort;
+extern Option<bool> PerfCountersFile;
 
 // Network
 
@@ -44,6 +44,7 @@
 #include "profiler/fc_profiler.h"
 #include "oslib/storage.h"
 #include "wsi/context.h"
+#include "rend/texture_upscaler.h"
 #include <chrono>
 #ifndef LIBRETRO
 #include "ui/gui.h"
@@ -516,6 +517,14 @@ void Emulator::init()
 	state = Init;
 }
 
+void Emulator::initPlatform(int platform)
+{
+	init();
+	setPlatform(platform);
+	mem_map_default();
+	dc_reset(true);
+}
+
 Sh4Executor *Emulator::getSh4Executor()
 {
 #if FEAT_SHREC != DYNAREC_NONE
@@ -726,6 +735,7 @@ void Emulator::runInternal()
 			}
 		} while (resetRequested);
 	}
+	aica::sync();
 }
 
 void Emulator::unloadGame()
@@ -755,6 +765,7 @@ void Emulator::unloadGame()
 		settings.content.title.clear();
 		settings.platform.system = DC_PLATFORM_DREAMCAST;
 		custom_texture.terminate();
+		textureUpscaler.term();
 		state = Init;
 		EventManager::event(Event::Terminate);
 	}
@@ -779,6 +790,7 @@ void Emulator::term()
 			recompiler = nullptr;
 		}
 		custom_texture.terminate();	// lr: avoid deadlock on exit (win32)
+		textureUpscaler.term();
 		reios_term();
 		aica::term();
 		pvr::term();
@@ -1077,6 +1089,7 @@ bool Emulator::render()
 
 void Emulator::vblank()
 {
+	FC_PROFILE_INSTANT("vblank");
 	EventManager::event(Event::VBlank);
 	// Time out if a frame hasn't been rendered for 50 ms
 	if (sh4_sched_now64() - startTime <= 10000000)
@@ -105,6 +105,11 @@ public:
 	 * Initialize the emulator. Does nothing if already initialized.
 	 */
 	void init();
+	/**
+	 * Initialize the emulator for the specified platform without loading any media.
+	 * Used to replay captured frames.
+	 */
+	void initPlatform(int platform);
 	/**
 	 * Terminate the emulator. After calling this method, the application must be restarted.
 	 */
@@ -7,6 +7,11 @@
 #include "hw/sh4/sh4_sched.h"
 #include "hw/arm7/arm7.h"
 #include "hw/arm7/arm_mem.h"
+#include "hw/mem/addrspace.h"
+#include "cfg/option.h"
+#include "util/worker_thread.h"
+
+#include <future>
 
 namespace aica
 {
@@ -61,10 +66,24 @@ static void update_arm_interrupts()
 	arm::interruptChange(p_ints,Lval);
 }
 
+// Threaded mode (experimental): the arm7, timers, channels and dsp run on a worker thread in batches of AICA_BATCH samples,
+// up to two batches behind the sh4. The sh4 thread waits for the worker to catch up before
+// accessing aica registers or wave memory. Interrupts to the sh4 and CD-DA reads happen at batch boundaries
+// so the timing differs from the inline mode.
+constexpr u32 AICA_BATCH = 32;
+static bool threaded;
+static bool batchRunning;
+static u32 pendingSamples;
+static WorkerThread aicaThread("AICA");
+static std::future<void> batchDone;
+
 //sh4 side
 static bool UpdateSh4Ints()
 {
 	u32 p_ints = MCIEB->full & MCIPD->full;
+	if (batchRunning)
+		// holly interrupts are updated by the sh4 thread at the end of the batch
+		return p_ints != 0;
 	if (p_ints)
 	{
 		if ((SB_ISTEXT & SH4_IRQ_BIT) == 0)
@@ -84,9 +103,43 @@ AicaTimer timers[3];
 int aica_schid = -1;
 constexpr int AICA_TICK = 4535;		// 44.1 KHz
 
+static void waitBatch()
+{
+	if (!batchDone.valid())
+		return;
+	batchDone.get();
+	batchRunning = false;
+	UpdateSh4Ints();
+}
+
+void sync()
+{
+	if (!threaded)
+		return;
+	waitBatch();
+	if (pendingSamples != 0)
+	{
+		arm::run(pendingSamples);
+		pendingSamples = 0;
+	}
+}
+
 static int AicaUpdate(int tag, int cycles, int jitter, void *arg)
 {
-	arm::run(1);
+	if (!threaded)
+	{
+		arm::run(1);
+		return AICA_TICK;
+	}
+	if (++pendingSamples == AICA_BATCH)
+	{
+		waitBatch();
+		// the gdrom state must only be accessed by the sh4 thread
+		sgc::prefetchCdda(pendingSamples);
+		batchRunning = true;
+		batchDone = aicaThread.runFuture(arm::run, pendingSamples);
+		pendingSamples = 0;
+	}
 
 	return AICA_TICK;
 }
@@ -238,6 +291,7 @@ template void writeTimerAndIntReg<>(u32 reg, u32 data);
 
 void midiSend(u8 data)
 {
+	sync();
 	midiSendBuffer.push_back(data);
 	SCIPD->MIDI_IN = 1;
 	update_arm_interrupts();
@@ -258,6 +312,17 @@ void init()
 
 void reset(bool hard)
 {
+	sync();
+	// netplay rollback snapshots wave memory asynchronously
+	threaded = config::ThreadedAica && !config::GGPOEnable;
+	// sh4 reads of wave memory must go through the area 0 handlers to sync with the aica thread
+	if (threaded && !addrspace::mapAramReads(false))
+	{
+		WARN_LOG(AICA, "Threaded AICA isn't supported on this platform");
+		threaded = false;
+	}
+	if (!threaded)
+		addrspace::mapAramReads(true);
 	if (hard)
 	{
 		initMem();
@@ -273,6 +338,9 @@ void reset(bool hard)
 
 void term()
 {
+	sync();
+	aicaThread.stop();
+	threaded = false;
 	arm::term();
 	sgc::term();
 	termMem();
@@ -395,6 +395,7 @@ static void Write_SB_ADST(u32 addr, u32 data)
 			else
 				DEBUG_LOG(AICA, "AICA-DMA : SB_ADDIR==0:DMA Write to 0x%X from 0x%X %x bytes", dst, src, SB_ADLEN);
 
+			sync();
 			WriteMemBlock_nommu_dma(dst, src, len);
 
 			// indicate that dma is in progress
@@ -513,6 +514,7 @@ void sbTerm()
 
 void serialize(Serializer& ser)
 {
+	sync();
 	ser << arm::aica_interr;
 	ser << arm::aica_reg_L;
 	ser << arm::e68k_out;
@@ -548,6 +550,7 @@ void serialize(Serializer& ser)
 
 void deserialize(Deserializer& deser)
 {
+	sync();
 	deser >> arm::aica_interr;
 	deser >> arm::aica_reg_L;
 	deser >> arm::e68k_out;
@@ -16,6 +16,8 @@ void init();
 void reset(bool hard);
 void term();
 void timeStep();
+// Wait for the aica thread to catch up with the sh4. Must be called before accessing aica state from the sh4 thread.
+void sync();
 void serialize(Serializer& ser);
 void deserialize(Deserializer& deser);
 
@@ -1,5 +1,7 @@
 #include "dsp.h"
 #include "aica.h"
+#include "aica_if.h"
+#include <vector>
 /*
 	DSP rec_v1
 
@@ -21,6 +23,18 @@ namespace aica::dsp
 
 DSPState state;
 
+// Ring buffer accesses and effect outputs of the current program, used to run idle samples
+struct MemAccess
+{
+	u8 step;
+	u8 MASA;
+	bool NXADR;
+	bool TABLE;
+	bool write;
+};
+static std::vector<MemAccess> memAccesses;
+static std::vector<u8> efOutputs;
+
 //float format is ?
 u16 DYNACALL PACK(s32 val)
 {
@@ -129,6 +143,77 @@ void term()
 	recTerm();
 }
 
+static void analyzeProgram()
+{
+	memAccesses.clear();
+	efOutputs.clear();
+	for (int step = 0; step < 128; step++)
+	{
+		Instruction op;
+		DecodeInst(&DSPData->MPRO[step * 4], &op);
+		// memory is only accessed on odd steps
+		if (step & 1)
+		{
+			if (op.MRD)
+				memAccesses.push_back({ (u8)step, op.MASA, op.NXADR, op.TABLE, false });
+			if (op.MWT)
+				memAccesses.push_back({ (u8)step, op.MASA, op.NXADR, op.TABLE, true });
+		}
+		if (op.EWT)
+			efOutputs.push_back(op.EWA);
+	}
+}
+
+static u32 ringAddress(const MemAccess& access)
+{
+	// ADRS_REG is 0 when the DSP is idle
+	u32 addr = DSPData->MADRS[access.MASA];
+	if (access.NXADR)
+		addr++;
+	if (!access.TABLE)
+		addr = (addr + state.MDEC_CT) & state.RBL;
+	else
+		addr &= 0xFFFF;
+	return ((addr << 1) + state.RBP) & ARAM_MASK;
+}
+
+//
+// When all the DSP registers, inputs and memory reads are zero, every value computed by the program is zero.
+// So the sample can be skipped, only replicating the memory and EFREG writes,
+// which is much faster than running the 128 steps during silent stretches.
+//
+static bool runIdleStep()
+{
+	s32 nonZero = DSPData->EXTS[0] | DSPData->EXTS[1];
+	for (s32 v : state.MIXS)
+		nonZero |= v;
+	if (nonZero != 0)
+		return false;
+	nonZero = state.SHIFTED | state.B | state.FRC_REG | state.Y_REG | state.ADRS_REG;
+	for (s32 v : state.MEMVAL)
+		nonZero |= v;
+	for (s32 v : state.MEMS)
+		nonZero |= v;
+	for (s32 v : state.TEMP)
+		nonZero |= v;
+	if (nonZero != 0)
+		return false;
+	for (const MemAccess& access : memAccesses)
+		if (!access.write && UNPACK(*(u16 *)&aica_ram[ringAddress(access)]) != 0)
+			return false;
+
+	const u16 zero = PACK(0);
+	for (const MemAccess& access : memAccesses)
+		if (access.write)
+			*(u16 *)&aica_ram[ringAddress(access)] = zero;
+	for (u8 ewa : efOutputs)
+		DSPData->EFREG[ewa] = 0;
+	if (--state.MDEC_CT == 0)
+		state.MDEC_CT = state.RBL + 1;
+
+	return true;
+}
+
 void step()
 {
 	if (state.dirty)
@@ -142,10 +227,15 @@ void step()
 				break;
 			}
 		if (!state.stopped)
+		{
 			recompile();
+			analyzeProgram();
+		}
 	}
 	if (state.stopped)
 		return;
+	if (runIdleStep())
+		return;
 	runStep();
 }
 
@@ -27,9 +27,12 @@
 #include "hw/gdrom/gdrom_if.h"
 #include "cfg/option.h"
 #include "serialize.h"
+#include "log/BitSet.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <deque>
 
 #undef FAR
 
@@ -417,6 +420,7 @@ enum PCMSType
 struct ChannelEx
 {
 	static ChannelEx Chans[64];
+	static u64 activeChannels;	// bit n set if Chans[n].enabled
 
 	ChannelCommonData* ccd;
 
@@ -595,6 +599,7 @@ struct ChannelEx
 	void disable()
 	{
 		enabled = false;
+		activeChannels &= ~(1ull << ChannelNumber);
 		SetAegState(EG_Release);
 		AEG.SetValue(0x3FF);
 		CA = 0;
@@ -603,6 +608,7 @@ struct ChannelEx
 	void enable()
 	{
 		enabled = true;
+		activeChannels |= 1ull << ChannelNumber;
 	}
 
 	SampleType InterpolateSample()
@@ -699,24 +705,37 @@ struct ChannelEx
 		return true;
 	}
 
-	void Step(SampleType& mixl, SampleType& mixr)
+	// Disabled channels output silence and don't change state, so only the active ones are stepped.
+	// Channel outputs are first gathered into separate arrays, then summed in tight loops the compiler can vectorize.
+	static void StepAll(SampleType& mixl, SampleType& mixr)
 	{
-		SampleType oLeft, oRight, oDsp;
+		alignas(32) SampleType left[64];
+		alignas(32) SampleType right[64];
+		int count = 0;
+		const bool dspEnabled = config::DSPEnabled;
 
-		Step(oLeft, oRight, oDsp);
+		for (u64 mask = activeChannels; mask != 0; mask &= mask - 1)
+		{
+			ChannelEx& channel = Chans[Common::LeastSignificantSetBit(mask)];
+			SampleType oLeft, oRight, oDsp;
 
-		*VolMix.DSPOut += oDsp;
-		if (oLeft + oRight == 0 && !config::DSPEnabled)
-			oLeft = oRight = oDsp >> 4;
+			channel.Step(oLeft, oRight, oDsp);
 
-		mixl += oLeft;
-		mixr += oRight;
-	}
-
-	static void StepAll(SampleType& mixl, SampleType& mixr)
-	{
-		for (ChannelEx& channel : Chans)
-			channel.Step(mixl, mixr);
+			*channel.VolMix.DSPOut += oDsp;
+			if (oLeft + oRight == 0 && !dspEnabled)
+				oLeft = oRight = oDsp >> 4;
+			left[count] = oLeft;
+			right[count] = oRight;
+			count++;
+		}
+		SampleType suml = 0;
+		SampleType sumr = 0;
+		for (int i = 0; i < count; i++)
+			suml += left[i];
+		for (int i = 0; i < count; i++)
+			sumr += right[i];
+		mixl += suml;
+		mixr += sumr;
 	}
 
 	void SetAegState(EGState newstate)
@@ -1467,6 +1486,7 @@ static void staticinitialise()
 static OnLoad staticInit(staticinitialise);
 
 ChannelEx ChannelEx::Chans[64];
+u64 ChannelEx::activeChannels;
 
 #define Chans ChannelEx::Chans
 
@@ -1544,12 +1564,35 @@ void ReadCommonReg(u32 reg,bool byte)
 
 void vmuBeep(int on, int period)
 {
+	sync();
 	beep.update(on, period);
 }
 
 constexpr int CDDA_SIZE = 2352 / 2;
 static s16 cdda_sector[CDDA_SIZE];
 static u32 cdda_index = CDDA_SIZE;
+// CD-DA sectors read ahead by the SH4 thread when the AICA runs on its own thread
+static std::deque<std::array<s16, CDDA_SIZE>> cddaQueue;
+
+void prefetchCdda(u32 samples)
+{
+	u32 index = cdda_index;
+	size_t sectors = 0;
+	for (u32 i = 0; i < samples; i++)
+	{
+		if (index >= CDDA_SIZE)
+		{
+			index = 0;
+			sectors++;
+		}
+		index += 2;
+	}
+	while (cddaQueue.size() < sectors)
+	{
+		cddaQueue.emplace_back();
+		libCore_CDDA_Sector(cddaQueue.back().data());
+	}
+}
 
 void AICA_Sample()
 {
@@ -1566,7 +1609,13 @@ void AICA_Sample()
 	if (cdda_index >= CDDA_SIZE)
 	{
 		cdda_index = 0;
-		libCore_CDDA_Sector(cdda_sector);
+		if (!cddaQueue.empty())
+		{
+			memcpy(cdda_sector, cddaQueue.front().data(), sizeof(cdda_sector));
+			cddaQueue.pop_front();
+		}
+		else
+			libCore_CDDA_Sector(cdda_sector);
 	}
 	s32 EXTS0L = cdda_sector[cdda_index];
 	s32 EXTS0R = cdda_sector[cdda_index+1];
@@ -1722,11 +1771,16 @@ void deserialize(Deserializer& deser)
 		deser >> channel.lfo.state;
 		channel.UpdateLFO(true);
 		deser >> channel.enabled;
+		if (channel.enabled)
+			ChannelEx::activeChannels |= 1ull << channel.ChannelNumber;
+		else
+			ChannelEx::activeChannels &= ~(1ull << channel.ChannelNumber);
 		channel.quiet = false;
 	}
 	beep.deserialize(deser);
 	deser >> cdda_sector;
 	deser >> cdda_index;
+	cddaQueue.clear();
 	midiSendBuffer.clear();
 	if (deser.version() >= Deserializer::V28)
 	{
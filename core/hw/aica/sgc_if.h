@@ -5,6 +5,8 @@ namespace aica::sgc
 {
 
 void AICA_Sample();
+// Read the CD-DA sectors needed by the next samples ahead of time
+void prefetchCdda(u32 samples);
 
 void WriteChannelReg(u32 channel, u32 reg, int size);
 
@@ -63,10 +63,20 @@ GD_HardwareInfo_t GD_HardwareInfo;
 #define printf_spicmd(...) DEBUG_LOG(GDROM, __VA_ARGS__)
 #define printf_subcode(...) DEBUG_LOG(GDROM, __VA_ARGS__)
 
+// Number of CDDA sectors read in advance (~0.2 s)
+constexpr u32 CDDA_PREFETCH = 16;
+
+static void prefetchCdda(u32 fad)
+{
+	if (fad < cdda.EndAddr.FAD)
+		libGDR_Prefetch(fad, std::min(CDDA_PREFETCH * 2, cdda.EndAddr.FAD - fad), 2352);
+}
+
 void libCore_CDDA_Sector(s16* sector)
 {
 	if (cdda.status == cdda_t::Playing)
 	{
+		prefetchCdda(cdda.CurrAddr.FAD + CDDA_PREFETCH);
 		if (libGDR_ReadSector((u8*)sector, cdda.CurrAddr.FAD, 1, 2352, true) == 0)
 		{
 			// Stop
@@ -117,6 +127,12 @@ void DmaBuffer::fill(read_params_t& params)
 	libGDR_ReadSector(cache, params.start_sector, count, params.sector_type);
 	params.start_sector += count;
 	params.remaining_sectors -= count;
+	// Read the next chunk while this one is being transferred.
+	// Once the command is complete, assume the next command will read the following sectors.
+	if (params.remaining_sectors > 0)
+		libGDR_Prefetch(params.start_sector, std::min(params.remaining_sectors, NSECT), params.sector_type);
+	else
+		libGDR_Prefetch(params.start_sector, NSECT, params.sector_type);
 }
 
 const u8 *DmaBuffer::read(u32 len)
@@ -259,6 +275,8 @@ static void gd_set_state(gd_states state)
 				libGDR_ReadSector((u8*)buffer, read_params.start_sector, sector_count, read_params.sector_type);
 				read_params.start_sector += sector_count;
 				read_params.remaining_sectors -= sector_count;
+				if (read_params.remaining_sectors > 0)
+					libGDR_Prefetch(read_params.start_sector, std::min(read_params.remaining_sectors, maxSectors), read_params.sector_type);
 
 				gd_spi_pio_end(nullptr, 0, next_state);
 			}
@@ -926,6 +944,7 @@ static void gd_process_spi_cmd()
 				cdda.repeats = packet_cmd.data_8[6] & 0xF;
 				cdda.status = cdda_t::Playing;
 				SecNumber.Status = GD_PLAY;
+				prefetchCdda(cdda.CurrAddr.FAD);
 
 				GDStatus.DSC = 1;
 			}
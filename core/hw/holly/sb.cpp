@@ -14,6 +14,7 @@
 #include "emulator.h"
 #include "hw/bba/bba.h"
 #include "serialize.h"
+#include "profiler/guest_profiler.h"
 #include <map>
 
 u32 sb_regs[0x540];
@@ -179,6 +180,8 @@ u32 sb_ReadMem(u32 addr)
 {
 	// All Holly accesses are 32-bit for now
 	u32 rv = hollyRegs.read<u32>(addr);
+	if (unlikely(guestprof::active))
+		guestprof::mmioAccess(addr & 0x1fffffff, false, regName(addr));
 
 	if ((addr & 0xffffff) != 0x5f6c18) // SB_MDST
 		DEBUG_LOG(HOLLY, "read %s.%c == %x", regName(addr),
@@ -192,6 +195,8 @@ void sb_WriteMem(u32 addr, u32 data)
 	DEBUG_LOG(HOLLY, "write %s.%c = %x", regName(addr),
 			((addr >> 26) & 7) == 2 ? 'b' : (addr & 0x2000000) ? '1' : '0',
 					data);
+	if (unlikely(guestprof::active))
+		guestprof::mmioAccess(addr & 0x1fffffff, true, regName(addr));
 	// All Holly accesses are 32-bit for now
 	hollyRegs.write<u32>(addr, data);
 }
@@ -113,7 +113,10 @@ T DYNACALL ReadMem_area0(u32 paddr)
 		}
 		// AICA sound registers
 		if (addr >= 0x00700000 && addr <= 0x00707FFF)
+		{
+			aica::sync();
 			return aica::readAicaReg<T>(addr);
+		}
 		// AICA RTC registers
 		if (addr >= 0x00710000 && addr <= 0x0071000B)
 			return aica::readRtcReg<T>(addr);
@@ -124,6 +127,7 @@ T DYNACALL ReadMem_area0(u32 paddr)
 	case 6:
 	case 7:
 		// AICA ram
+		aica::sync();
 		return ReadMemArr<T>(&aica::aica_ram[0], addr & ARAM_MASK);
 
 	default:
@@ -227,6 +231,7 @@ void DYNACALL WriteMem_area0(u32 paddr, T data)
 		// AICA sound registers
 		if (addr >= 0x00700000 && addr <= 0x00707FFF)
 		{
+			aica::sync();
 			aica::writeAicaReg(addr, data);
 			return;
 		}
@@ -242,6 +247,7 @@ void DYNACALL WriteMem_area0(u32 paddr, T data)
 	case 6:
 	case 7:
 		// AICA ram
+		aica::sync();
 		WriteMemArr(&aica::aica_ram[0], addr & ARAM_MASK, data);
 		return;
 
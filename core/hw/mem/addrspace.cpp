@@ -401,9 +401,12 @@ static void termMappings()
 	}
 }
 
+static bool aramReadsUnmapped;
+
 void initMappings()
 {
 	termMappings();
+	aramReadsUnmapped = false;
 	// Fallback to statically allocated buffers, this results in slow-ops being generated.
 	if (ram_base == nullptr)
 	{
@@ -543,6 +546,32 @@ u32 getVramOffset(void *addr)
 	}
 }
 
+bool mapAramReads(bool enable)
+{
+	if (ram_base == nullptr)
+		// always accessed through the handlers
+		return !enable;
+	if (aramReadsUnmapped != enable)
+		return true;
+	u8 * const area = &ram_base[0x00800000];
+	constexpr u32 areaSize = 0x00800000;
+	if (enable)
+	{
+		for (u32 offset = 0; offset < areaSize; offset += ARAM_SIZE)
+			if (!virtmem::map_shadow(area + offset, ARAM_SIZE, MAP_ARAM_START_OFFSET, false))
+				return false;
+	}
+	else
+	{
+		// Remapping the first mirror as is tells whether the platform can change mappings
+		if (!virtmem::map_shadow(area, ARAM_SIZE, MAP_ARAM_START_OFFSET, false))
+			return false;
+		virtmem::unmap_shadow(area, areaSize);
+	}
+	aramReadsUnmapped = !enable;
+	return true;
+}
+
 void getAddress(void** out_ram_base, void** out_ram, void** out_vram, void** out_aica) {
     if (ram_base != nullptr) {
         *out_ram_base =	ram_base;
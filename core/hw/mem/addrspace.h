@@ -81,5 +81,8 @@ void protectVram(u32 addr, u32 size);
 void unprotectVram(u32 addr, u32 size);
 u32 getVramOffset(void *addr);
 void getAddress(void** out_ram_base, void** out_ram, void** out_vram, void** out_aica);
+// Maps or unmaps the read-only view of aica ram in area 0. When unmapped, sh4 reads go through the area 0 handlers.
+// Returns false if the mapping can't be changed.
+bool mapAramReads(bool enable);
 
 } // namespace addrspace
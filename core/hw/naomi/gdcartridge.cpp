@@ -18,10 +18,12 @@
 #include "hw/holly/sb.h"
 #include "hw/holly/holly_intc.h"
 #include "hw/mem/addrspace.h"
+#include "cfg/option.h"
 #include "serialize.h"
 #include "hw/sh4/sh4_sched.h"
 #include "naomi.h"
 #include <algorithm>
+#include <future>
 
 /*
 
@@ -457,6 +459,7 @@ void GDCartridge::device_start(LoadProgress *progress, std::vector<u8> *digest)
 	}
 	dimm_data_size = 0;
 	loadedSegments.clear();
+	closeDecryptionCache(false);
 
 	char name[128];
 	memset(name,'\0',128);
@@ -500,6 +503,11 @@ void GDCartridge::device_start(LoadProgress *progress, std::vector<u8> *digest)
 
 		DEBUG_LOG(NAOMI, "key is %08x%08x, name is %s", (u32)(key >> 32), (u32)key, name);
 
+		// The disc hash is needed to identify the decrypted image in the cache
+		std::vector<u8> discDigest;
+		if (digest == nullptr && config::GDDecryptionCache)
+			digest = &discDigest;
+
 		u8 buffer[2048];
 		std::string parent = hostfs::storage().getParentPath(settings.content.path);
 		std::string gdrom_path = get_file_basename(settings.content.fileName) + "/" + gdrom_name;
@@ -597,11 +605,27 @@ void GDCartridge::device_start(LoadProgress *progress, std::vector<u8> *digest)
 			if (dimm_data_size != file_rounded_size)
 				memset(dimm_data + file_rounded_size, 0, dimm_data_size - file_rounded_size);
 
+			fileSize = file_rounded_size;
 			loadedSegments.resize(dimm_data_size / SEGMENT_SIZE);
 			std::fill(loadedSegments.begin() + (file_rounded_size + SEGMENT_SIZE - 1) / SEGMENT_SIZE,
 					loadedSegments.end(), true);
 
 			des_generate_subkeys(rev64(key), des_subkeys);
+
+			if (config::GDDecryptionCache && digest != nullptr && !digest->empty())
+			{
+				std::string hash;
+				char hex[3];
+				for (u8 b : *digest)
+				{
+					snprintf(hex, sizeof(hex), "%02x", b);
+					hash += hex;
+				}
+				char keyHex[17];
+				snprintf(keyHex, sizeof(keyHex), "%08x%08x", (u32)(key >> 32), (u32)key);
+				decryptionCachePath = get_writable_data_path("naomigd_" + hash + "_" + keyHex + ".bin");
+				openDecryptionCache();
+			}
 		}
 
 		if (!dimm_data)
@@ -609,25 +633,156 @@ void GDCartridge::device_start(LoadProgress *progress, std::vector<u8> *digest)
 	}
 }
 
+void GDCartridge::decrypt(u8 *data, u32 size)
+{
+	u64 *pData = (u64 *)data;
+	const u32 blocks = size / 8;
+	// DES in ECB mode: each block can be decrypted independently
+	const u32 threadCount = size >= PARALLEL_DECRYPT_SIZE ? std::clamp(std::thread::hardware_concurrency(), 1u, 8u) : 1;
+	if (threadCount == 1)
+	{
+		for (u32 i = 0; i < blocks; i++)
+			pData[i] = des_encrypt_decrypt<true>(pData[i], des_subkeys);
+		return;
+	}
+	const u32 blocksPerThread = (blocks + threadCount - 1) / threadCount;
+	std::vector<std::future<void>> tasks;
+	for (u32 start = 0; start < blocks; start += blocksPerThread)
+	{
+		const u32 end = std::min(start + blocksPerThread, blocks);
+		tasks.push_back(std::async(std::launch::async, [this, pData, start, end]() {
+			for (u32 i = start; i < end; i++)
+				pData[i] = des_encrypt_decrypt<true>(pData[i], des_subkeys);
+		}));
+	}
+	for (auto& task : tasks)
+		task.wait();
+}
+
 void GDCartridge::loadSegments(u32 offset, u32 size)
 {
 	const u32 lastSegment = (offset + size - 1) / SEGMENT_SIZE;
-	for (u32 segment = offset / SEGMENT_SIZE; segment <= lastSegment; segment++)
+	u32 segment = offset / SEGMENT_SIZE;
+	while (segment <= lastSegment)
 	{
 		if (loadedSegments[segment])
+		{
+			segment++;
 			continue;
-		DEBUG_LOG(NAOMI, "Loading segment %d", segment);
-		// load data
+		}
+		// load and decrypt consecutive missing segments at once,
+		// and read ahead since DMA transfers are small and mostly sequential
+		u32 end = segment + 1;
+		while (end < loadedSegments.size() && !loadedSegments[end]
+				&& (end <= lastSegment || end - segment < READ_AHEAD_SEGMENTS))
+			end++;
+		DEBUG_LOG(NAOMI, "Loading segments %d-%d", segment, end - 1);
 		read_gdrom(gdrom.get(), file_start + (segment * SEGMENT_SIZE) / 2048,
 				dimm_data + segment * SEGMENT_SIZE,
-				SEGMENT_SIZE / 2048,
+				(end - segment) * SEGMENT_SIZE / 2048,
 				nullptr);
-		// decrypt loaded data
-		u64 *pData = (u64 *)(dimm_data + segment * SEGMENT_SIZE);
-		for (u32 i = 0; i < SEGMENT_SIZE; i += 8, pData++)
-			*pData = des_encrypt_decrypt<true>(*pData, des_subkeys);
-		loadedSegments[segment] = true;
+		decrypt(dimm_data + segment * SEGMENT_SIZE, (end - segment) * SEGMENT_SIZE);
+		std::fill(loadedSegments.begin() + segment, loadedSegments.begin() + end, true);
+		if (cacheFile != nullptr)
+			saveDecryptionCache(segment * SEGMENT_SIZE, (end - segment) * SEGMENT_SIZE);
+		segment = end;
+	}
+}
+
+// Segments past the end of the file are marked as loaded and aren't saved
+u32 GDCartridge::decryptionCacheSize() const
+{
+	u32 size = dimm_data_size;
+	while (size >= SEGMENT_SIZE && size - SEGMENT_SIZE >= fileSize)
+		size -= SEGMENT_SIZE;
+	return size;
+}
+
+//
+// The cache file holds the decrypted image followed by a bitmap of the loaded segments.
+// Segments are written as soon as they're decrypted, before the game can modify them,
+// and the bitmap is updated after the segment data so that a partial cache can be reused.
+//
+void GDCartridge::openDecryptionCache()
+{
+	const u32 size = decryptionCacheSize();
+	std::vector<u8> bitmap((loadedSegments.size() + 7) / 8);
+	cacheFile = nowide::fopen(decryptionCachePath.c_str(), "r+b");
+	if (cacheFile != nullptr)
+	{
+		if (flycast::fsize(cacheFile) == size + bitmap.size()
+				&& std::fread(dimm_data, 1, size, cacheFile) == size
+				&& std::fread(bitmap.data(), 1, bitmap.size(), cacheFile) == bitmap.size())
+		{
+			u32 loaded = 0;
+			for (u32 i = 0; i < loadedSegments.size(); i++)
+				if (bitmap[i / 8] & (1 << (i % 8)))
+				{
+					loadedSegments[i] = true;
+					loaded++;
+				}
+			INFO_LOG(NAOMI, "Loaded %d decrypted DIMM segments from %s", loaded, decryptionCachePath.c_str());
+		}
+		else
+		{
+			WARN_LOG(NAOMI, "Invalid DIMM image cache file %s", decryptionCachePath.c_str());
+			std::fclose(cacheFile);
+			cacheFile = nullptr;
+		}
+	}
+	if (std::find(loadedSegments.begin(), loadedSegments.end(), false) == loadedSegments.end())
+	{
+		// no need to save it again
+		closeDecryptionCache(false);
+		return;
+	}
+	if (cacheFile == nullptr)
+	{
+		cacheFile = nowide::fopen(decryptionCachePath.c_str(), "w+b");
+		if (cacheFile == nullptr)
+		{
+			WARN_LOG(NAOMI, "Can't create DIMM image cache file %s: errno %d", decryptionCachePath.c_str(), errno);
+			decryptionCachePath.clear();
+		}
+	}
+}
+
+void GDCartridge::saveDecryptionCache(u32 offset, u32 size)
+{
+	const u32 cacheSize = decryptionCacheSize();
+	if (offset >= cacheSize)
+		return;
+	size = std::min(size, cacheSize - offset);
+	std::vector<u8> bitmap((loadedSegments.size() + 7) / 8);
+	for (u32 i = 0; i < loadedSegments.size(); i++)
+		if (loadedSegments[i])
+			bitmap[i / 8] |= 1 << (i % 8);
+	if (std::fseek(cacheFile, offset, SEEK_SET) != 0 || std::fwrite(dimm_data + offset, 1, size, cacheFile) != size
+			|| std::fseek(cacheFile, cacheSize, SEEK_SET) != 0 || std::fwrite(bitmap.data(), 1, bitmap.size(), cacheFile) != bitmap.size()
+			|| std::fflush(cacheFile) != 0)
+	{
+		WARN_LOG(NAOMI, "Error writing DIMM image cache file %s", decryptionCachePath.c_str());
+		closeDecryptionCache(true);
+		return;
+	}
+	if (std::find(loadedSegments.begin(), loadedSegments.end(), false) == loadedSegments.end())
+	{
+		INFO_LOG(NAOMI, "Saved decrypted DIMM image to %s", decryptionCachePath.c_str());
+		closeDecryptionCache(false);
+	}
+}
+
+// Partially loaded images are kept and completed on the next boot unless discarded
+void GDCartridge::closeDecryptionCache(bool discard)
+{
+	if (cacheFile != nullptr)
+	{
+		discard = std::fclose(cacheFile) != 0 || discard;
+		cacheFile = nullptr;
+		if (discard)
+			nowide::remove(decryptionCachePath.c_str());
 	}
+	decryptionCachePath.clear();
 }
 
 void GDCartridge::device_reset()
@@ -670,6 +825,7 @@ GDCartridge::GDCartridge(u32 size) : NaomiCartridge(size)
 
 GDCartridge::~GDCartridge()
 {
+	closeDecryptionCache(false);
 	free(dimm_data);
 	sh4_sched_unregister(schedId);
 }
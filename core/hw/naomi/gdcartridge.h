@@ -93,9 +93,14 @@ private:
 
 	std::vector<bool> loadedSegments;
 	static constexpr u32 SEGMENT_SIZE = 16_KB;
+	static constexpr u32 READ_AHEAD_SEGMENTS = 16;
+	static constexpr u32 PARALLEL_DECRYPT_SIZE = 64_KB;
 	std::unique_ptr<Disc> gdrom;
 	u32 file_start = 0;
+	u32 fileSize = 0;
 	u32 des_subkeys[32];
+	std::string decryptionCachePath;
+	FILE *cacheFile = nullptr;
 
 	void device_start(LoadProgress *progress, std::vector<u8> *digest);
 	void device_reset();
@@ -108,5 +113,10 @@ private:
 	u64 rev64(u64 src);
 	void read_gdrom(Disc *gdrom, u32 sector, u8* dst, u32 count = 1, LoadProgress *progress = nullptr);
 	void loadSegments(u32 offset, u32 size);
+	void decrypt(u8 *data, u32 size);
+	u32 decryptionCacheSize() const;
+	void openDecryptionCache();
+	void saveDecryptionCache(u32 offset, u32 size);
+	void closeDecryptionCache(bool discard);
 	void systemCmd(int cmd);
 };
@@ -46,6 +46,7 @@
 #include "systemsp.h"
 #include "hopper.h"
 #include "midiffb.h"
+#include "util/worker_thread.h"
 
 Cartridge *CurrentCartridge;
 bool bios_loaded = false;
@@ -226,6 +227,101 @@ void naomi_cart_LoadBios(const char *filename)
 	bios_loaded = true;
 }
 
+static ArchiveFile *openRomBlob(const Game *game, int romid, Archive *archive, Archive *parent_archive)
+{
+	ArchiveFile *file = nullptr;
+	// Find by CRC
+	if (archive != nullptr)
+		file = archive->OpenFileByCrc(game->blobs[romid].crc);
+	if (file == nullptr && parent_archive != nullptr)
+		file = parent_archive->OpenFileByCrc(game->blobs[romid].crc);
+	// Fallback to find by filename
+	if (file == nullptr && archive != nullptr)
+		file = archive->OpenFile(game->blobs[romid].filename);
+	if (file == nullptr && parent_archive != nullptr)
+		file = parent_archive->OpenFile(game->blobs[romid].filename);
+	return file;
+}
+
+//
+// Load the normal rom blobs on several threads. Each thread uses its own archive handles.
+// Only blobs preceding the first Copy blob are loaded since they might be the source of the copy.
+// Returns which blobs have been loaded.
+//
+static std::vector<u8> preloadRomBlobs(const Game *game, int romCount, const std::string& path, const std::string& parentPath,
+		const Archive *archive, const Archive *parent_archive, LoadProgress *progress)
+{
+	std::vector<u8> preloaded(romCount);
+	if ((archive != nullptr && !archive->randomAccess())
+			|| (parent_archive != nullptr && !parent_archive->randomAccess()))
+		return preloaded;
+
+	struct Job {
+		int romid;
+		u8 *dst;
+	};
+	std::vector<Job> jobs;
+	u64 totalSize = 0;
+	for (int romid = 0; romid < romCount && game->blobs[romid].blob_type != Copy; romid++)
+	{
+		if (game->blobs[romid].blob_type != Normal)
+			continue;
+		u32 len = game->blobs[romid].length;
+		u8 *dst = (u8 *)CurrentCartridge->GetPtr(game->blobs[romid].offset, len);
+		if (dst == nullptr)
+			// Will fail later
+			continue;
+		jobs.push_back({ romid, dst });
+		totalSize += game->blobs[romid].length;
+	}
+	const u32 threadCount = std::min<u32>(std::min(std::thread::hardware_concurrency(), 4u), jobs.size());
+	if (threadCount < 2)
+		return preloaded;
+
+	// Open all archives on this thread
+	std::vector<std::unique_ptr<Archive>> archives;
+	std::vector<std::unique_ptr<Archive>> parentArchives;
+	for (u32 i = 0; i < threadCount; i++)
+	{
+		archives.emplace_back(archive != nullptr ? OpenArchive(path) : nullptr);
+		parentArchives.emplace_back(parent_archive != nullptr ? OpenArchive(parentPath) : nullptr);
+	}
+	if (progress != nullptr)
+		progress->label = "ROM";
+
+	std::atomic<size_t> nextJob { 0 };
+	std::atomic<u64> loadedSize { 0 };
+	std::vector<std::future<void>> tasks;
+	for (u32 i = 0; i < threadCount; i++)
+	{
+		tasks.push_back(std::async(std::launch::async, [&, i]() {
+			ThreadName _("ROM loader");
+			for (size_t j = nextJob++; j < jobs.size(); j = nextJob++)
+			{
+				if (progress != nullptr && progress->cancelled)
+					throw LoadCancelledException();
+				const int romid = jobs[j].romid;
+				std::unique_ptr<ArchiveFile> file(openRomBlob(game, romid, archives[i].get(), parentArchives[i].get()));
+				if (!file)
+					// Will fail later
+					continue;
+				u32 read = file->Read(jobs[j].dst, game->blobs[romid].length);
+				DEBUG_LOG(NAOMI, "Mapped %s: %x bytes at %07x", game->blobs[romid].filename, read, game->blobs[romid].offset);
+				preloaded[romid] = true;
+				loadedSize += game->blobs[romid].length;
+				if (progress != nullptr)
+					progress->progress = (float)loadedSize / totalSize;
+			}
+		}));
+	}
+	for (auto& task : tasks)
+		task.wait();
+	for (auto& task : tasks)
+		task.get();
+
+	return preloaded;
+}
+
 static void loadMameRom(const std::string& path, const std::string& fileName, LoadProgress *progress)
 {
 	const Game *game = FindGame(fileName.c_str());
@@ -238,10 +334,11 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 		INFO_LOG(NAOMI, "Opened %s", path.c_str());
 
 	std::unique_ptr<Archive> parent_archive;
+	std::string parentPath;
 	if (game->parent_name != nullptr)
 	{
 		try {
-			std::string parentPath = hostfs::storage().getParentPath(path);
+			parentPath = hostfs::storage().getParentPath(path);
 			parentPath = hostfs::storage().getSubPath(parentPath, game->parent_name);
 			parent_archive.reset(OpenArchive(parentPath));
 		} catch (const FlycastException& e) {
@@ -311,12 +408,29 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 		CurrentCartridge->game = game;
 
 		MD5Sum md5;
+		// Hash the loaded data in the background, in order
+		WorkerThread md5Thread("MD5");
+		auto md5Add = [&md5, &md5Thread](const u8 *data, u32 len) {
+			md5Thread.run([&md5, data, len]() {
+				md5.add(data, len);
+			});
+		};
 
 		int romCount = 0;
 		while (game->blobs[romCount].filename != nullptr)
 			romCount++;
+		std::vector<u8> preloaded = preloadRomBlobs(game, romCount, path, parentPath, archive.get(), parent_archive.get(), progress);
 		for (int romid = 0; romid < romCount; romid++)
 		{
+			if (preloaded[romid])
+			{
+				if (config::GGPOEnable)
+				{
+					u32 len = game->blobs[romid].length;
+					md5Add((u8 *)CurrentCartridge->GetPtr(game->blobs[romid].offset, len), game->blobs[romid].length);
+				}
+				continue;
+			}
 			if (progress != nullptr)
 			{
 				if (progress->cancelled)
@@ -338,22 +452,15 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 				u8 *src = (u8 *)CurrentCartridge->GetPtr(game->blobs[romid].src_offset, len);
 				if (dst == nullptr || src == nullptr)
 					throw NaomiCartException("Invalid ROM");
+				if (config::GGPOEnable)
+					// the destination might not be hashed yet
+					md5Thread.runFuture([]() {}).wait();
 				memcpy(dst, src, game->blobs[romid].length);
 				DEBUG_LOG(NAOMI, "Copied: %x bytes from %07x to %07x", game->blobs[romid].length, game->blobs[romid].src_offset, game->blobs[romid].offset);
 			}
 			else
 			{
-				std::unique_ptr<ArchiveFile> file;
-				// Find by CRC
-				if (archive != NULL)
-					file.reset(archive->OpenFileByCrc(game->blobs[romid].crc));
-				if (!file && parent_archive != NULL)
-					file.reset(parent_archive->OpenFileByCrc(game->blobs[romid].crc));
-				// Fallback to find by filename
-				if (!file && archive != NULL)
-					file.reset(archive->OpenFile(game->blobs[romid].filename));
-				if (!file && parent_archive != NULL)
-					file.reset(parent_archive->OpenFile(game->blobs[romid].filename));
+				std::unique_ptr<ArchiveFile> file(openRomBlob(game, romid, archive.get(), parent_archive.get()));
 				if (!file) {
 					WARN_LOG(NAOMI, "%s: Cannot open %s", fileName.c_str(), game->blobs[romid].filename);
 					if (game->blobs[romid].blob_type != Eeprom)
@@ -371,7 +478,7 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 								throw NaomiCartException(std::string("Invalid ROM: truncated ") + game->blobs[romid].filename);
 							u32 read = file->Read(dst, game->blobs[romid].length);
 							if (config::GGPOEnable)
-								md5.add(dst, game->blobs[romid].length);
+								md5Add(dst, game->blobs[romid].length);
 							DEBUG_LOG(NAOMI, "Mapped %s: %x bytes at %07x", game->blobs[romid].filename, read, game->blobs[romid].offset);
 						}
 						break;
@@ -391,7 +498,7 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 								*to++ = *from++;
 							free(buf);
 							if (config::GGPOEnable)
-								md5.add((u8*)CurrentCartridge->GetPtr(game->blobs[romid].offset, len), game->blobs[romid].length);
+								md5Add((u8*)CurrentCartridge->GetPtr(game->blobs[romid].offset, len), game->blobs[romid].length);
 							DEBUG_LOG(NAOMI, "Mapped %s: %x bytes (interleaved word) at %07x", game->blobs[romid].filename, read, game->blobs[romid].offset);
 						}
 						break;
@@ -405,7 +512,7 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 							u32 read = file->Read(buf, game->blobs[romid].length);
 							CurrentCartridge->SetKeyData(buf);
 							if (config::GGPOEnable)
-								md5.add(buf, game->blobs[romid].length);
+								md5Add(buf, game->blobs[romid].length);
 							DEBUG_LOG(NAOMI, "Loaded %s: %x bytes cart key", game->blobs[romid].filename, read);
 						}
 						break;
@@ -418,7 +525,7 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 								u8 data[0x84];
 								u32 read = file->Read(data, sizeof(data));
 								if (config::GGPOEnable)
-									md5.add(data, sizeof(data));
+									md5Thread.runFuture([&md5, &data]() { md5.add(data, sizeof(data)); }).wait();
 								setGameSerialId(data);
 								DEBUG_LOG(NAOMI, "Loaded %s: %x bytes rom serial eeprom", game->blobs[romid].filename, read);
 							}
@@ -430,7 +537,7 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 
 								u32 read = file->Read(naomi_default_eeprom, game->blobs[romid].length);
 								if (config::GGPOEnable)
-									md5.add(naomi_default_eeprom, game->blobs[romid].length);
+									md5Add(naomi_default_eeprom, game->blobs[romid].length);
 								DEBUG_LOG(NAOMI, "Loaded %s: %x bytes default eeprom", game->blobs[romid].filename, read);
 							}
 						}
@@ -452,6 +559,7 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 
 		if (config::GGPOEnable)
 		{
+			md5Thread.runFuture([]() {}).wait();
 			if (game->cart_type == GD)
 			{
 				std::vector<u8> romMD5 = md5.getDigest();
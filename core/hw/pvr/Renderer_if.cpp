@@ -1,5 +1,6 @@
 #include "Renderer_if.h"
 #include "spg.h"
+#include "ta_capture.h"
 #include "rend/texconv.h"
 #include "rend/transform_matrix.h"
 #include "cfg/option.h"
@@ -413,6 +414,7 @@ void rend_start_render()
 		}
 		ggpo::endOfFrame();
 	}
+	tacapture::onStartRender(ctx);
 
 	if (QueueRender(ctx))
 	{
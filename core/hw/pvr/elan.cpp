@@ -60,6 +60,7 @@
 #include "hw/sh4/sh4_sched.h"
 #include "serialize.h"
 #include "elan_struct.h"
+#include "elan_vertex.h"
 #include "network/ggpo.h"
 #include "cfg/option.h"
 #include <glm/glm.hpp>
@@ -232,24 +233,6 @@ static glm::vec4 unpackColor(u8 red, u8 green, u8 blue, u8 alpha = 0)
 	return glm::vec4((float)red / 255.f, (float)green / 255.f, (float)blue / 255.f, (float)alpha / 255.f);
 }
 
-static u32 packColorBGRA(const glm::vec4& color)
-{
-	return (int)(std::min(1.f, color.a) * 255.f) << 24
-			| (int)(std::min(1.f, color.r) * 255.f) << 16
-			| (int)(std::min(1.f, color.g) * 255.f) << 8
-			| (int)(std::min(1.f, color.b) * 255.f);
-}
-
-static u32 packColorRGBA(const glm::vec4& color)
-{
-	return (int)(std::min(1.f, color.r) * 255.f)
-			| (int)(std::min(1.f, color.g) * 255.f) << 8
-			| (int)(std::min(1.f, color.b) * 255.f) << 16
-			| (int)(std::min(1.f, color.a) * 255.f) << 24;
-}
-
-static u32 (*packColor)(const glm::vec4& color) = packColorRGBA;
-
 static GMP *curGmp;
 static glm::mat4x4 curMatrix;
 static int taMVMatrix = -1;
@@ -259,15 +242,12 @@ static LightModel *curLightModel;
 static ElanBase *curLights[MAX_LIGHTS];
 static float nearPlane = 0.001f;
 static float farPlane = 100000.f;
-static bool envMapping;
 static bool cullingReversed;
 static bool openModifierVolume;
 static bool shadowedVolume;
 static TSP modelTSP;
-static glm::vec4 gmpDiffuseColor0;
-static glm::vec4 gmpSpecularColor0;
-static glm::vec4 gmpDiffuseColor1;
-static glm::vec4 gmpSpecularColor1;
+static VertexParams vertexParams;
+static ListConverter listConverter;
 
 struct State
 {
@@ -281,8 +261,6 @@ struct State
 			Null, Null, Null, Null, Null, Null, Null, Null
 	};
 	bool lightModelUpdated = false;
-	float envMapUOffset = 0.f;
-	float envMapVOffset = 0.f;
 	float projMatrix[4] = { 579.411194f, -320.f, -579.411194f, -240.f };
 	int projMatrixIdx = -1;
 
@@ -294,11 +272,8 @@ struct State
 		for (auto& light : lights)
 			light = Null;
 		projMatrixIdx = -1;
+		vertexParams.bgra = isDirectX(config::RendererType);
 		update();
-		if (isDirectX(config::RendererType))
-			packColor = packColorBGRA;
-		else
-			packColor = packColorRGBA;
 	}
 	void setMatrix(InstanceMatrix *pinstance)
 	{
@@ -312,8 +287,7 @@ struct State
 		{
 			taMVMatrix = -1;
 			taNormalMatrix = -1;
-			envMapUOffset = 0.f;
-			envMapVOffset = 0.f;
+			vertexParams.setMatrix(nullptr);
 			return;
 		}
 		InstanceMatrix *mat = (InstanceMatrix *)&RAM[instance];
@@ -325,12 +299,8 @@ struct State
 				mat->lm01, mat->lm11, mat->lm21,
 				mat->lm02, mat->lm12, mat->lm22);
 
-		curMatrix = glm::mat4x4{
-			-mat->tm00, mat->tm01, -mat->tm02, 0.f,
-			-mat->tm10, mat->tm11, -mat->tm12, 0.f,
-			-mat->tm20, mat->tm21, -mat->tm22, 0.f,
-			-mat->tm30, mat->tm31, -mat->tm32, 1.f
-		};
+		vertexParams.setMatrix(mat);
+		curMatrix = vertexParams.matrix;
 		glm::mat4x4 normalMatrix = glm::mat4x4{
 			mat->lm00, mat->lm01, mat->lm02, 0.f,
 			mat->lm10, mat->lm11, mat->lm12, 0.f,
@@ -339,8 +309,6 @@ struct State
 		};
 		nearPlane = mat->_near;
 		farPlane = mat->_far;
-		envMapUOffset = mat->envMapU;
-		envMapVOffset = mat->envMapV;
 		taMVMatrix = ta_add_matrix(glm::value_ptr(curMatrix));
 		if (normalMatrix != curMatrix)
 			taNormalMatrix = ta_add_matrix(glm::value_ptr(normalMatrix));
@@ -398,34 +366,13 @@ struct State
 	void updateGMP()
 	{
 		if (gmp == Null)
-		{
 			curGmp = nullptr;
-			gmpDiffuseColor0 = glm::vec4(0);
-			gmpSpecularColor0 = glm::vec4(0);
-			gmpDiffuseColor1 = glm::vec4(0);
-			gmpSpecularColor1 = glm::vec4(0);
-		}
 		else
 		{
 			curGmp = (GMP *)&RAM[gmp];
 			DEBUG_LOG(PVR, "GMP paramSelect %x", curGmp->paramSelect.full);
-			if (curGmp->paramSelect.d0)
-				gmpDiffuseColor0 = unpackColor(curGmp->diffuse0);
-			else
-				gmpDiffuseColor0 = glm::vec4(0);
-			if (curGmp->paramSelect.s0)
-				gmpSpecularColor0 = unpackColor(curGmp->specular0);
-			else
-				gmpSpecularColor0 = glm::vec4(0);
-			if (curGmp->paramSelect.d1)
-				gmpDiffuseColor1 = unpackColor(curGmp->diffuse1);
-			else
-				gmpDiffuseColor1 = glm::vec4(0);
-			if (curGmp->paramSelect.s1)
-				gmpSpecularColor1 = unpackColor(curGmp->specular1);
-			else
-				gmpSpecularColor1 = glm::vec4(0);
 		}
+		vertexParams.setGmpColors(curGmp);
 	}
 
 	void setLightModel(void *p)
@@ -545,218 +492,30 @@ struct State
 
 static State state;
 
-static void setCoords(Vertex& vtx, float x, float y, float z)
-{
-	vtx.x = x;
-	vtx.y = y;
-	vtx.z = z;
-}
-
-template <typename Ts>
-static void setUV(const Ts& vs, Vertex& vd)
-{
-	if (envMapping)
-	{
-		vd.u = state.envMapUOffset;
-		vd.v = state.envMapVOffset;
-		vd.u1 = state.envMapUOffset;
-		vd.v1 = state.envMapVOffset;
-	}
-	else
-	{
-		vd.u = vs.uv.u;
-		vd.v = vs.uv.v;
-		vd.u1 = vs.uv.u;
-		vd.v1 = vs.uv.v;
-	}
-}
-
-static void SetEnvMapUV(Vertex& vtx)
-{
-	if (envMapping)
-	{
-		vtx.u = state.envMapUOffset;
-		vtx.v = state.envMapVOffset;
-		vtx.u1 = state.envMapUOffset;
-		vtx.v1 = state.envMapVOffset;
-	}
-}
-
-template<typename T>
-static glm::vec3 getNormal(const T& vtx)
-{
-	return { (int8_t)vtx.header.nx / 127.f, (int8_t)vtx.header.ny / 127.f, (int8_t)vtx.header.nz / 127.f };
-}
-
-template<typename T>
-static void setNormal(Vertex& vd, const T& vs)
-{
-	glm::vec3 normal = getNormal(vs);
-	vd.nx = normal.x;
-	vd.ny = normal.y;
-	vd.nz = normal.z;
-}
-
-static void setModelColors(glm::vec4& baseCol0, glm::vec4& offsetCol0, glm::vec4& baseCol1, glm::vec4& offsetCol1)
-{
-	if (curGmp == nullptr)
-		return;
-	if (curGmp->paramSelect.d0)
-		baseCol0 = gmpDiffuseColor0;
-	if (curGmp->paramSelect.s0)
-		offsetCol0 = gmpSpecularColor0;
-	if (curGmp->paramSelect.d1)
-		baseCol1 = gmpDiffuseColor1;
-	if (curGmp->paramSelect.s1)
-		offsetCol1 = gmpSpecularColor1;
-}
-
-template <typename T>
-static void convertVertex(const T& vs, Vertex& vd);
-
-template<>
-void convertVertex(const N2_VERTEX& vs, Vertex& vd)
-{
-	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
-	SetEnvMapUV(vd);
-	glm::vec4 baseCol0(1);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1(1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
-}
-
-template<>
-void convertVertex(const N2_VERTEX_VR& vs, Vertex& vd)
-{
-	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
-	SetEnvMapUV(vd);
-	glm::vec4 baseCol0 = unpackColor(vs.rgb.argb0);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1 = unpackColor(vs.rgb.argb1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
-}
-
-template<>
-void convertVertex(const N2_VERTEX_VU& vs, Vertex& vd)
-{
-	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
-	setUV(vs, vd);
-	glm::vec4 baseCol0(1);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1(1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
-}
-
-template<>
-void convertVertex(const N2_VERTEX_VUR& vs, Vertex& vd)
+// Returns the vertices of a polygon list converted with the current state
+static const ConvertedList& convertList(const ICHList *list)
 {
-	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
-	setUV(vs, vd);
-	glm::vec4 baseCol0 = unpackColor(vs.rgb.argb0);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1 = unpackColor(vs.rgb.argb1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
+	static ConvertedList converted;
+
+	vertexParams.setGmpSelect(curGmp);
+	const ConvertedList *prepared = listConverter.get(list, vertexParams);
+	if (prepared != nullptr)
+		return *prepared;
+	convertVertices(list, vertexParams, converted);
+	return converted;
 }
 
-template<>
-void convertVertex(const N2_VERTEX_VUB& vs, Vertex& vd)
+static bool isBetweenNearAndFar(const ConvertedList& list, bool& needNearClipping)
 {
-	setCoords(vd, vs.x, vs.y, vs.z);
-	setNormal(vd, vs);
-	setUV(vs, vd);
-	glm::vec4 baseCol0(1);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1(1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	// Stuff the bump map normals and parameters in the specular colors
-	vd.spc[0] = vs.bump.tangent.x;
-	vd.spc[1] = vs.bump.tangent.y;
-	vd.spc[2] = vs.bump.tangent.z;
-	vd.spc1[0] = vs.bump.bitangent.x;
-	vd.spc1[1] = vs.bump.bitangent.y;
-	vd.spc1[2] = vs.bump.bitangent.z;
-	vd.spc[3] = vs.bump.scaleFactor.bumpDegree; // always 255?
-	vd.spc1[3] = vs.bump.scaleFactor.fixedOffset; // always 0?
-//	int nx = (int8_t)vs.header.nx;
-//	int ny = (int8_t)vs.header.ny;
-//	int nz = (int8_t)vs.header.nz;
-//	printf("BumpMap vtx deg %d off %d normal %d %d %d tangent %d %d %d bitangent %d %d %d dot %d %d %d\n", vs.bump.scaleFactor.bumpDegree, vs.bump.scaleFactor.fixedOffset,
-//			nx, ny, nz,
-//			vs.bump.tangent.x, vs.bump.tangent.y, vs.bump.tangent.z, vs.bump.bitangent.x, vs.bump.bitangent.y, vs.bump.bitangent.z,
-//			nx * vs.bump.tangent.x + ny * vs.bump.tangent.y + nz * vs.bump.tangent.z,
-//			nx * vs.bump.bitangent.x + ny * vs.bump.bitangent.y + nz * vs.bump.bitangent.z,
-//			vs.bump.tangent.x * vs.bump.bitangent.x + vs.bump.tangent.y * vs.bump.bitangent.y + vs.bump.tangent.z * vs.bump.bitangent.z
-//			);
-}
-
-template <typename T>
-static void boundingBox(const T* vertices, u32 count, glm::vec3& min, glm::vec3& max)
-{
-	min = { 1e38f, 1e38f, 1e38f };
-	max = { -1e38f, -1e38f, -1e38f };
-	for (u32 i = 0; i < count; i++)
-	{
-		glm::vec3 pos{ vertices[i].x, vertices[i].y, vertices[i].z };
-		min = glm::min(min, pos);
-		max = glm::max(max, pos);
-	}
-	glm::vec4 center((min + max) / 2.f, 1);
-	glm::vec4 extents(max - glm::vec3(center), 0);
-	// transform
-	center = curMatrix * center;
-	glm::vec3 extentX = curMatrix * glm::vec4(extents.x, 0, 0, 0);
-	glm::vec3 extentY = curMatrix * glm::vec4(0, extents.y, 0, 0);
-	glm::vec3 extentZ = curMatrix * glm::vec4(0, 0, extents.z, 0);
-	// new AA extents
-	glm::vec3 newExtent = glm::abs(extentX) + glm::abs(extentY) + glm::abs(extentZ);
-
-	min = glm::vec3(center) - newExtent;
-	max = glm::vec3(center) + newExtent;
-}
-
-template <typename T>
-static bool isBetweenNearAndFar(const T* vertices, u32 count, bool& needNearClipping)
-{
-	glm::vec3 min;
-	glm::vec3 max;
-	boundingBox(vertices, count, min, max);
-	if (min.z > -nearPlane || max.z < -farPlane)
+	if (list.min.z > -nearPlane || list.max.z < -farPlane)
 		return false;
 
-	glm::vec4 pmin = projectionMatrix * glm::vec4(min, 1);
-	glm::vec4 pmax = projectionMatrix * glm::vec4(max, 1);
+	glm::vec4 pmin = projectionMatrix * glm::vec4(list.min, 1);
+	glm::vec4 pmax = projectionMatrix * glm::vec4(list.max, 1);
 	if (std::isnan(pmin.x) || std::isnan(pmin.y) || std::isnan(pmax.x) || std::isnan(pmax.y))
 		return false;
 
-	needNearClipping = max.z > -nearPlane;
+	needNearClipping = list.max.z > -nearPlane;
 
 	return true;
 }
@@ -766,12 +525,11 @@ class TriangleStripClipper
 public:
 	TriangleStripClipper(bool enabled) : enabled(enabled) {}
 
-	void add(const Vertex& vtx)
+	// dist is the view space distance to the near plane
+	void add(const Vertex& vtx, float dist)
 	{
 		if (enabled)
 		{
-			float z = vtx.x * curMatrix[0][2] + vtx.y * curMatrix[1][2] + vtx.z * curMatrix[2][2] + curMatrix[3][2];
-			float dist = -z - nearPlane;
 			clip(vtx, dist);
 			count++;
 		}
@@ -908,35 +666,34 @@ private:
 };
 
 template <typename T>
-static void sendVertices(const ICHList *list, const T* vtx, bool needClipping)
+static void sendVertices(const ICHList *list, const T* vtx, const ConvertedList& converted, bool needClipping)
 {
-	Vertex taVtx;
 	verify(list->vertexSize() > 0);
 
-	Vertex fanCenterVtx{};
-	Vertex fanLastVtx{};
+	const Vertex *vertices = converted.vertices.data();
+	const float *dist = converted.nearDist.data();
+	u32 fanCenter = 0;
+	u32 fanLast = 0;
 	bool stripStart = true;
 	int outStripIndex = 0;
 	TriangleStripClipper clipper(needClipping);
 
 	for (u32 i = 0; i < list->vtxCount; i++)
 	{
-		convertVertex(*vtx, taVtx);
-
 		if (stripStart)
 		{
 			// Center vertex if triangle fan
 			//verify(vtx->header.isFirstOrSecond()); This fails for some strips: strip=1 fan=0 (soul surfer)
-			fanCenterVtx = taVtx;
+			fanCenter = i;
 			if (outStripIndex > 0)
 			{
 				// use degenerate triangles to link strips
-				clipper.add(fanLastVtx);
-				clipper.add(taVtx);
+				clipper.add(vertices[fanLast], dist[fanLast]);
+				clipper.add(vertices[i], dist[i]);
 				outStripIndex += 2;
 				if (outStripIndex & 1)
 				{
-					clipper.add(taVtx);
+					clipper.add(vertices[i], dist[i]);
 					outStripIndex++;
 				}
 			}
@@ -945,22 +702,22 @@ static void sendVertices(const ICHList *list, const T* vtx, bool needClipping)
 		else if (vtx->header.isFan())
 		{
 			// use degenerate triangles to link strips
-			clipper.add(fanLastVtx);
-			clipper.add(fanCenterVtx);
+			clipper.add(vertices[fanLast], dist[fanLast]);
+			clipper.add(vertices[fanCenter], dist[fanCenter]);
 			outStripIndex += 2;
 			if (outStripIndex & 1)
 			{
-				clipper.add(fanCenterVtx);
+				clipper.add(vertices[fanCenter], dist[fanCenter]);
 				outStripIndex++;
 			}
 			// Triangle fan
-			clipper.add(fanCenterVtx);
-			clipper.add(fanLastVtx);
+			clipper.add(vertices[fanCenter], dist[fanCenter]);
+			clipper.add(vertices[fanLast], dist[fanLast]);
 			outStripIndex += 2;
 		}
-		clipper.add(taVtx);
+		clipper.add(vertices[i], dist[i]);
 		outStripIndex++;
-		fanLastVtx = taVtx;
+		fanLast = i;
 		if (vtx->header.endOfStrip)
 			stripStart = true;
 
@@ -1279,7 +1036,6 @@ static void setStateParams(PolyParam& pp, const ICHList *list)
 			pp.tsp.IgnoreTexA = 0;
 			pp.envMapping[0] = true;
 			pp.tcw = list->tcw0;
-			envMapping = true;
 		}
 		if (curGmp->paramSelect.e1)
 		{
@@ -1289,7 +1045,6 @@ static void setStateParams(PolyParam& pp, const ICHList *list)
 			pp.tsp1.IgnoreTexA = 0;
 			pp.envMapping[1] = true;
 			pp.tcw1 = list->tcw1;
-			envMapping = true;
 		}
 	}
 	pp.tsp.full ^= modelTSP.full;
@@ -1324,10 +1079,14 @@ static void sendPolygon(ICHList *list)
 			if (listType == -1)
 				listType = list->pcw.listType;
 			if (listType & 1)
+			{
+				listConverter.skip(list);
 				sendMVPolygon(list, vtx, true);
+			}
 			else
 			{
-				if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+				const ConvertedList& converted = convertList(list);
+				if (!isBetweenNearAndFar(converted, needClipping))
 					break;
 				PolyParam pp{};
 				pp.pcw.Shadow = list->pcw.shadow;
@@ -1341,7 +1100,7 @@ static void sendPolygon(ICHList *list)
 				setStateParams(pp, list);
 				ta_add_poly(pp);
 
-				sendVertices(list, vtx, needClipping);
+				sendVertices(list, vtx, converted, needClipping);
 			}
 		}
 		break;
@@ -1353,10 +1112,14 @@ static void sendPolygon(ICHList *list)
 			if (listType == -1)
 				listType = list->pcw.listType;
 			if (listType  & 1)
+			{
+				listConverter.skip(list);
 				sendMVPolygon(list, vtx, true);
+			}
 			else
 			{
-				if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+				const ConvertedList& converted = convertList(list);
+				if (!isBetweenNearAndFar(converted, needClipping))
 					break;
 				PolyParam pp{};
 				pp.pcw.Shadow = list->pcw.shadow;
@@ -1372,7 +1135,7 @@ static void sendPolygon(ICHList *list)
 				setStateParams(pp, list);
 				ta_add_poly(pp);
 
-				sendVertices(list, vtx, needClipping);
+				sendVertices(list, vtx, converted, needClipping);
 			}
 		}
 		break;
@@ -1380,7 +1143,8 @@ static void sendPolygon(ICHList *list)
 	case ICHList::VTX_TYPE_VUR:
 		{
 			N2_VERTEX_VUR *vtx = (N2_VERTEX_VUR *)((u8 *)list + sizeof(ICHList));
-			if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+			const ConvertedList& converted = convertList(list);
+			if (!isBetweenNearAndFar(converted, needClipping))
 				break;
 			PolyParam pp{};
 			pp.pcw.Shadow = list->pcw.shadow;
@@ -1396,14 +1160,15 @@ static void sendPolygon(ICHList *list)
 			setStateParams(pp, list);
 			ta_add_poly(pp);
 
-			sendVertices(list, vtx, needClipping);
+			sendVertices(list, vtx, converted, needClipping);
 		}
 		break;
 
 	case ICHList::VTX_TYPE_VR:
 		{
 			N2_VERTEX_VR *vtx = (N2_VERTEX_VR *)((u8 *)list + sizeof(ICHList));
-			if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+			const ConvertedList& converted = convertList(list);
+			if (!isBetweenNearAndFar(converted, needClipping))
 				break;
 			PolyParam pp{};
 			pp.pcw.Shadow = list->pcw.shadow;
@@ -1417,7 +1182,7 @@ static void sendPolygon(ICHList *list)
 			setStateParams(pp, list);
 			ta_add_poly(pp);
 
-			sendVertices(list, vtx, needClipping);
+			sendVertices(list, vtx, converted, needClipping);
 		}
 		break;
 
@@ -1426,7 +1191,8 @@ static void sendPolygon(ICHList *list)
 			// TODO
 			//printf("BUMP MAP fmt %d filter %d src select %d dst %d\n", list->tcw0.PixelFmt, list->tsp0.FilterMode, list->tsp0.SrcSelect, list->tsp0.DstSelect);
 			N2_VERTEX_VUB *vtx = (N2_VERTEX_VUB *)((u8 *)list + sizeof(ICHList));
-			if (!isBetweenNearAndFar(vtx, list->vtxCount, needClipping))
+			const ConvertedList& converted = convertList(list);
+			if (!isBetweenNearAndFar(converted, needClipping))
 				break;
 			PolyParam pp{};
 			pp.pcw.Shadow = list->pcw.shadow;
@@ -1442,7 +1208,7 @@ static void sendPolygon(ICHList *list)
 			setStateParams(pp, list);
 			ta_add_poly(pp);
 
-			sendVertices(list, vtx, needClipping);
+			sendVertices(list, vtx, converted, needClipping);
 		}
 		break;
 
@@ -1452,7 +1218,6 @@ static void sendPolygon(ICHList *list)
 		//die("Unsupported");
 		break;
 	}
-	envMapping = false;
 }
 
 [[noreturn]] static void raiseError()
@@ -1462,6 +1227,68 @@ static void sendPolygon(ICHList *list)
 	throw TAParserException();
 }
 
+// Returns the size of the TA data at the beginning of the given buffer, or -1 if it's invalid.
+// listType and vertexSize are updated as the TA parser would.
+static int skipTaData(const u8 *data, int size, int& listType, u32& vertexSize)
+{
+	int i = 0;
+	while (i < size)
+	{
+		PCW pcw = *(PCW *)&data[i];
+		if (pcw.naomi2 == 1)
+			break;
+		switch (pcw.paraType)
+		{
+		case ParamType_End_Of_List:
+			listType = -1;
+			i += 32;
+			break;
+		case ParamType_Object_List_Set:
+		case ParamType_User_Tile_Clip:
+			i += 32;
+			break;
+		case ParamType_Polygon_or_Modifier_Volume:
+			{
+				static const u32 * const PolyTypeLut = TaTypeLut::instance().table;
+
+				if (listType == -1)
+					listType = pcw.listType;
+				if (listType & 1)
+				{
+					// modifier volumes
+					vertexSize = 64;
+					i += 32;
+				}
+				else
+				{
+					u32 polyId = PolyTypeLut[pcw.objectControl];
+					u32 polySize = polyId >> 30;
+					u32 vertexType = (u8)polyId;
+					if (vertexType == 5 || vertexType == 6 || (vertexType >= 11 && vertexType <= 14))
+						vertexSize = 64;
+					else
+						vertexSize = 32;
+					i += polySize == SZ64 ? 64 : 32;
+				}
+			}
+			break;
+		case ParamType_Sprite:
+			if (listType == -1)
+				listType = pcw.listType;
+			vertexSize = 64;
+			i += 32;
+			break;
+		case ParamType_Vertex_Parameter:
+			i += vertexSize;
+			break;
+		default:
+			WARN_LOG(PVR, "Invalid param type %d", pcw.paraType);
+			return -1;
+		}
+	}
+	return i;
+}
+
 template<bool Active = true>
 static void executeCommand(u8 *data, int size)
 {
@@ -1675,67 +1502,145 @@ static void executeCommand(u8 *data, int size)
 			{
 				u32 vertexSize = 32;
 				int listType = ta_get_list_type();
-				int i = 0;
-				while (i < size)
+				const int taSize = skipTaData(data, size, listType, vertexSize);
+				if (taSize < 0)
+					raiseError();
+				size -= taSize;
+			}
+		}
+		data += oldSize - size;
+	}
+}
+
+// Walks a display list before it's executed and queues its polygon lists for conversion,
+// tracking the matrix and GMP changes that affect them.
+// Returns false if the walk had to stop early. The remaining lists are then converted when executed.
+static bool scanLists(u8 *data, int size, VertexParams& params, const GMP *&gmp, int& listType, u32& vertexSize, int depth)
+{
+	if (depth > 16)
+		return false;
+	while (size >= 32)
+	{
+		const int oldSize = size;
+		ElanBase *cmd = (ElanBase *)data;
+		if (!cmd->pcw.naomi2)
+		{
+			// TA data is sent to the TA parser as is
+			const int taSize = skipTaData(data, size, listType, vertexSize);
+			if (taSize < 0)
+				return false;
+			size -= taSize;
+			data += taSize;
+			continue;
+		}
+		switch (cmd->pcw.n2Command)
+		{
+		case PCW::null:
+			size -= 32;
+			break;
+
+		case PCW::projMatrix:
+			size -= sizeof(ProjMatrix);
+			break;
+
+		case PCW::matrixOrLight:
+			{
+				InstanceMatrix *instance = (InstanceMatrix *)data;
+				if (instance->isInstanceMatrix())
 				{
-					PCW pcw = *(PCW *)&data[i];
-					if (pcw.naomi2 == 1)
-						break;
-					switch (pcw.paraType)
-					{
-					case ParamType_End_Of_List:
-						listType = -1;
-						i += 32;
-						break;
-					case ParamType_Object_List_Set:
-					case ParamType_User_Tile_Clip:
-						i += 32;
-						break;
-					case ParamType_Polygon_or_Modifier_Volume:
-						{
-							static const u32 * const PolyTypeLut = TaTypeLut::instance().table;
+					params.setMatrix(State::elanRamAddress(data) == State::Null ? nullptr : instance);
+					size -= sizeof(InstanceMatrix);
+				}
+				else {
+					size -= sizeof(LightModel);
+				}
+			}
+			break;
 
-							if (listType == -1)
-								listType = pcw.listType;
-							if (listType & 1)
-							{
-								// modifier volumes
-								vertexSize = 64;
-								i += 32;
-							}
-							else
-							{
-								u32 polyId = PolyTypeLut[pcw.objectControl];
-								u32 polySize = polyId >> 30;
-								u32 vertexType = (u8)polyId;
-								if (vertexType == 5 || vertexType == 6 || (vertexType >= 11 && vertexType <= 14))
-									vertexSize = 64;
-								else
-									vertexSize = 32;
-								i += polySize == SZ64 ? 64 : 32;
-							}
-						}
-						break;
-					case ParamType_Sprite:
-						if (listType == -1)
-							listType = pcw.listType;
-						vertexSize = 64;
-						i += 32;
-						break;
-					case ParamType_Vertex_Parameter:
-						i += vertexSize;
-						break;
-					default:
-						WARN_LOG(PVR, "Invalid param type %d", pcw.paraType);
-						raiseError();
-						break;
-					}
+		case PCW::model:
+			{
+				Model *model = (Model *)data;
+				if (!scanLists(&RAM[model->offset & 0x1ffffff8], model->size, params, gmp, listType, vertexSize, depth + 1))
+					return false;
+				size -= sizeof(Model);
+			}
+			break;
+
+		case PCW::registerWait:
+			{
+				RegisterWait *wait = (RegisterWait *)data;
+				if (wait->offset != (u32)-1 && wait->mask != 0)
+				{
+					if (wait->mask != 0x80 && wait->mask != 0x100 && wait->mask != 0x200
+							&& wait->mask != 0x400 && wait->mask != 0x200000)
+						return false;
+					// the state is reset
+					params.setMatrix(nullptr);
+					gmp = nullptr;
+					params.setGmpColors(nullptr);
+				}
+				size -= sizeof(RegisterWait);
+			}
+			break;
+
+		case PCW::link:
+			{
+				Link *link = (Link *)data;
+				if (link->offset & 0xa0000000)
+				{
+					// texture DMA
+					if (link->size > VRAM_SIZE)
+						return false;
+				}
+				else if (!scanLists(&RAM[link->offset & ELAN_RAM_MASK], link->size, params, gmp, listType, vertexSize, depth + 1)) {
+					return false;
 				}
-				size -= i;
+				size -= sizeof(Link);
 			}
+			break;
+
+		case PCW::gmp:
+			gmp = State::elanRamAddress(data) == State::Null ? nullptr : (GMP *)data;
+			params.setGmpColors(gmp);
+			size -= sizeof(GMP);
+			break;
+
+		case PCW::ich:
+			{
+				ICHList *ich = (ICHList *)data;
+				switch (ich->flags)
+				{
+				case ICHList::VTX_TYPE_V:
+				case ICHList::VTX_TYPE_VU:
+				case ICHList::VTX_TYPE_VR:
+				case ICHList::VTX_TYPE_VUR:
+				case ICHList::VTX_TYPE_VUB:
+					params.setGmpSelect(gmp);
+					listConverter.add(ich, params);
+					break;
+				default:
+					break;
+				}
+				size -= sizeof(ICHList) + ich->vertexSize() * ich->vtxCount;
+			}
+			break;
+
+		default:
+			return false;
 		}
 		data += oldSize - size;
 	}
+	return true;
+}
+
+static void prepareLists(u8 *data, int size)
+{
+	VertexParams params = vertexParams;
+	const GMP *gmp = curGmp;
+	int listType = ta_get_list_type();
+	u32 vertexSize = 32;
+	scanLists(data, size, params, gmp, listType, vertexSize, 0);
+	listConverter.start();
 }
 
 static void DYNACALL write_elancmd(u32 addr, u32 data)
@@ -1748,13 +1653,18 @@ static void DYNACALL write_elancmd(u32 addr, u32 data)
 	{
 		try {
 			if (!ggpo::rollbacking())
+			{
+				prepareLists((u8 *)elanCmd, sizeof(elanCmd));
 				executeCommand<true>((u8 *)elanCmd, sizeof(elanCmd));
-			else
+			}
+			else {
 				executeCommand<false>((u8 *)elanCmd, sizeof(elanCmd));
+			}
 			if (!sh4_sched_is_scheduled(schedId))
 				reg74 |= 2;
 		} catch (const TAParserException& e) {
 		}
+		listConverter.finish();
 	}
 }
 
@@ -1795,6 +1705,7 @@ void reset(bool hard)
 
 void term()
 {
+	listConverter.term();
 	if (schedId != -1) {
 		sh4_sched_unregister(schedId);
 		schedId = -1;
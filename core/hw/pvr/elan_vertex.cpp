@@ -0,0 +1,419 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "elan_vertex.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+#include <algorithm>
+#include <type_traits>
+
+#if HOST_CPU == CPU_X64 || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ELAN_SSE2
+#endif
+
+namespace elan
+{
+
+// Below this number of vertices, lists are only converted when executed
+constexpr size_t MinParallelVertices = 512;
+
+void VertexParams::setMatrix(const InstanceMatrix *mat)
+{
+	if (mat == nullptr)
+	{
+		envMapU = 0.f;
+		envMapV = 0.f;
+		return;
+	}
+	matrix = glm::mat4x4{
+		-mat->tm00, mat->tm01, -mat->tm02, 0.f,
+		-mat->tm10, mat->tm11, -mat->tm12, 0.f,
+		-mat->tm20, mat->tm21, -mat->tm22, 0.f,
+		-mat->tm30, mat->tm31, -mat->tm32, 1.f
+	};
+	nearPlane = mat->_near;
+	envMapU = mat->envMapU;
+	envMapV = mat->envMapV;
+}
+
+void VertexParams::setGmpColors(const GMP *gmp)
+{
+	diffuseColor0 = gmp != nullptr && gmp->paramSelect.d0 ? packColor(gmp->diffuse0) : 0;
+	specularColor0 = gmp != nullptr && gmp->paramSelect.s0 ? packColor(gmp->specular0) : 0;
+	diffuseColor1 = gmp != nullptr && gmp->paramSelect.d1 ? packColor(gmp->diffuse1) : 0;
+	specularColor1 = gmp != nullptr && gmp->paramSelect.s1 ? packColor(gmp->specular1) : 0;
+}
+
+void VertexParams::setGmpSelect(const GMP *gmp)
+{
+	if (gmp == nullptr)
+	{
+		envMapping = diffuse0 = specular0 = diffuse1 = specular1 = false;
+		return;
+	}
+	envMapping = gmp->paramSelect.e0 || gmp->paramSelect.e1;
+	diffuse0 = gmp->paramSelect.d0;
+	specular0 = gmp->paramSelect.s0;
+	diffuse1 = gmp->paramSelect.d1;
+	specular1 = gmp->paramSelect.s1;
+}
+
+bool VertexParams::operator==(const VertexParams& other) const
+{
+	return matrix == other.matrix && nearPlane == other.nearPlane
+			&& envMapU == other.envMapU && envMapV == other.envMapV
+			&& bgra == other.bgra && envMapping == other.envMapping
+			&& diffuse0 == other.diffuse0 && specular0 == other.specular0
+			&& diffuse1 == other.diffuse1 && specular1 == other.specular1
+			&& diffuseColor0 == other.diffuseColor0 && specularColor0 == other.specularColor0
+			&& diffuseColor1 == other.diffuseColor1 && specularColor1 == other.specularColor1;
+}
+
+// Positions and normals, which are common to all vertex types, the view space bounding box
+// and the near plane distances. Vertices are processed 4 at a time with SSE2.
+static void convertPositions(const u8 *data, u32 stride, u32 count, const VertexParams& params, ConvertedList& out)
+{
+	const glm::mat4& m = params.matrix;
+	Vertex *vd = out.vertices.data();
+	float *dist = out.nearDist.data();
+	u32 i = 0;
+#ifdef ELAN_SSE2
+	// lane 0 holds the vertex header and is ignored
+	__m128 vmin = _mm_set1_ps(1e38f);
+	__m128 vmax = _mm_set1_ps(-1e38f);
+	const __m128 m02 = _mm_set1_ps(m[0][2]);
+	const __m128 m12 = _mm_set1_ps(m[1][2]);
+	const __m128 m22 = _mm_set1_ps(m[2][2]);
+	const __m128 m32 = _mm_set1_ps(m[3][2]);
+	const __m128 nearPlane = _mm_set1_ps(params.nearPlane);
+	const __m128 signMask = _mm_set1_ps(-0.f);
+	const __m128 normalScale = _mm_set1_ps(127.f);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 v0 = _mm_loadu_ps((const float *)&data[i * stride]);
+		__m128 v1 = _mm_loadu_ps((const float *)&data[(i + 1) * stride]);
+		__m128 v2 = _mm_loadu_ps((const float *)&data[(i + 2) * stride]);
+		__m128 v3 = _mm_loadu_ps((const float *)&data[(i + 3) * stride]);
+		vmin = _mm_min_ps(v0, vmin);
+		vmax = _mm_max_ps(v0, vmax);
+		vmin = _mm_min_ps(v1, vmin);
+		vmax = _mm_max_ps(v1, vmax);
+		vmin = _mm_min_ps(v2, vmin);
+		vmax = _mm_max_ps(v2, vmax);
+		vmin = _mm_min_ps(v3, vmin);
+		vmax = _mm_max_ps(v3, vmax);
+		// headers, x, y, z
+		_MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+
+		__m128 z = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v1, m02), _mm_mul_ps(v2, m12)), _mm_mul_ps(v3, m22)), m32);
+		_mm_storeu_ps(&dist[i], _mm_sub_ps(_mm_xor_ps(z, signMask), nearPlane));
+
+		// signed 8-bit normal components in the low 24 bits of the header
+		__m128i header = _mm_castps_si128(v0);
+		__m128 nx = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(header, 24), 24)), normalScale);
+		__m128 ny = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(header, 16), 24)), normalScale);
+		__m128 nz = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(header, 8), 24)), normalScale);
+		alignas(16) float pos[3][4];
+		alignas(16) float normal[3][4];
+		_mm_store_ps(pos[0], v1);
+		_mm_store_ps(pos[1], v2);
+		_mm_store_ps(pos[2], v3);
+		_mm_store_ps(normal[0], nx);
+		_mm_store_ps(normal[1], ny);
+		_mm_store_ps(normal[2], nz);
+		for (int j = 0; j < 4; j++)
+		{
+			Vertex& v = vd[i + j];
+			v.x = pos[0][j];
+			v.y = pos[1][j];
+			v.z = pos[2][j];
+			v.nx = normal[0][j];
+			v.ny = normal[1][j];
+			v.nz = normal[2][j];
+		}
+	}
+	alignas(16) float minv[4];
+	alignas(16) float maxv[4];
+	_mm_store_ps(minv, vmin);
+	_mm_store_ps(maxv, vmax);
+	glm::vec3 min(minv[1], minv[2], minv[3]);
+	glm::vec3 max(maxv[1], maxv[2], maxv[3]);
+#else
+	glm::vec3 min(1e38f);
+	glm::vec3 max(-1e38f);
+#endif
+	for (; i < count; i++)
+	{
+		const N2_VERTEX& vs = *(const N2_VERTEX *)&data[i * stride];
+		Vertex& v = vd[i];
+		v.x = vs.x;
+		v.y = vs.y;
+		v.z = vs.z;
+		v.nx = (int8_t)vs.header.nx / 127.f;
+		v.ny = (int8_t)vs.header.ny / 127.f;
+		v.nz = (int8_t)vs.header.nz / 127.f;
+		glm::vec3 pos{ vs.x, vs.y, vs.z };
+		min = glm::min(min, pos);
+		max = glm::max(max, pos);
+		const float z = vs.x * m[0][2] + vs.y * m[1][2] + vs.z * m[2][2] + m[3][2];
+		dist[i] = -z - params.nearPlane;
+	}
+
+	// transform the bounding box
+	glm::vec4 center((min + max) / 2.f, 1);
+	glm::vec4 extents(max - glm::vec3(center), 0);
+	center = m * center;
+	glm::vec3 extentX = m * glm::vec4(extents.x, 0, 0, 0);
+	glm::vec3 extentY = m * glm::vec4(0, extents.y, 0, 0);
+	glm::vec3 extentZ = m * glm::vec4(0, 0, extents.z, 0);
+	// new AA extents
+	glm::vec3 newExtent = glm::abs(extentX) + glm::abs(extentY) + glm::abs(extentZ);
+
+	out.min = glm::vec3(center) - newExtent;
+	out.max = glm::vec3(center) + newExtent;
+}
+
+template<typename T>
+static void convertAttributes(const T *vtx, u32 count, const VertexParams& params, Vertex *vd)
+{
+	constexpr bool Textured = std::is_same_v<T, N2_VERTEX_VU> || std::is_same_v<T, N2_VERTEX_VUR> || std::is_same_v<T, N2_VERTEX_VUB>;
+	constexpr bool Colored = std::is_same_v<T, N2_VERTEX_VR> || std::is_same_v<T, N2_VERTEX_VUR>;
+	constexpr bool BumpMapped = std::is_same_v<T, N2_VERTEX_VUB>;
+
+	const u32 baseColor0 = params.diffuse0 ? params.diffuseColor0 : 0xffffffff;
+	const u32 offsetColor0 = params.specular0 ? params.specularColor0 : 0;
+	const u32 baseColor1 = params.diffuse1 ? params.diffuseColor1 : 0xffffffff;
+	const u32 offsetColor1 = params.specular1 ? params.specularColor1 : 0;
+
+	for (u32 i = 0; i < count; i++, vd++)
+	{
+		const T& vs = vtx[i];
+		if constexpr (Textured)
+		{
+			if (!params.envMapping)
+			{
+				vd->u = vd->u1 = vs.uv.u;
+				vd->v = vd->v1 = vs.uv.v;
+			}
+			else
+			{
+				vd->u = vd->u1 = params.envMapU;
+				vd->v = vd->v1 = params.envMapV;
+			}
+		}
+		else
+		{
+			vd->u = vd->u1 = params.envMapping ? params.envMapU : 0.f;
+			vd->v = vd->v1 = params.envMapping ? params.envMapV : 0.f;
+		}
+		if constexpr (Colored)
+		{
+			*(u32 *)vd->col = params.diffuse0 ? baseColor0 : params.packColor(vs.rgb.argb0);
+			*(u32 *)vd->col1 = params.diffuse1 ? baseColor1 : params.packColor(vs.rgb.argb1);
+		}
+		else
+		{
+			*(u32 *)vd->col = baseColor0;
+			*(u32 *)vd->col1 = baseColor1;
+		}
+		if constexpr (BumpMapped)
+		{
+			// Stuff the bump map normals and parameters in the specular colors
+			vd->spc[0] = vs.bump.tangent.x;
+			vd->spc[1] = vs.bump.tangent.y;
+			vd->spc[2] = vs.bump.tangent.z;
+			vd->spc1[0] = vs.bump.bitangent.x;
+			vd->spc1[1] = vs.bump.bitangent.y;
+			vd->spc1[2] = vs.bump.bitangent.z;
+			vd->spc[3] = vs.bump.scaleFactor.bumpDegree;
+			vd->spc1[3] = vs.bump.scaleFactor.fixedOffset;
+		}
+		else
+		{
+			*(u32 *)vd->spc = offsetColor0;
+			*(u32 *)vd->spc1 = offsetColor1;
+		}
+	}
+}
+
+template<typename T>
+static void convert(const ICHList *list, const VertexParams& params, ConvertedList& out)
+{
+	const T *vtx = (const T *)((const u8 *)list + sizeof(ICHList));
+	out.vertices.resize(list->vtxCount);
+	out.nearDist.resize(list->vtxCount);
+	convertPositions((const u8 *)vtx, sizeof(T), list->vtxCount, params, out);
+	convertAttributes(vtx, list->vtxCount, params, out.vertices.data());
+}
+
+void convertVertices(const ICHList *list, const VertexParams& params, ConvertedList& out)
+{
+	switch (list->flags)
+	{
+	case ICHList::VTX_TYPE_V:
+		convert<N2_VERTEX>(list, params, out);
+		break;
+	case ICHList::VTX_TYPE_VU:
+		convert<N2_VERTEX_VU>(list, params, out);
+		break;
+	case ICHList::VTX_TYPE_VR:
+		convert<N2_VERTEX_VR>(list, params, out);
+		break;
+	case ICHList::VTX_TYPE_VUR:
+		convert<N2_VERTEX_VUR>(list, params, out);
+		break;
+	case ICHList::VTX_TYPE_VUB:
+		convert<N2_VERTEX_VUB>(list, params, out);
+		break;
+	default:
+		die("Unsupported vertex type");
+		break;
+	}
+}
+
+void ListConverter::add(const ICHList *list, const VertexParams& params)
+{
+	if (jobCount == jobs.size())
+		jobs.emplace_back();
+	Job& job = jobs[jobCount++];
+	job.list = list;
+	job.params = params;
+	job.state = Pending;
+	vertexCount += list->vtxCount;
+}
+
+void ListConverter::start()
+{
+	if (vertexCount < MinParallelVertices)
+		return;
+	std::lock_guard<std::mutex> _(mutex);
+	if (workers.empty())
+	{
+		const int threadCount = std::clamp((int)std::thread::hardware_concurrency() - 2, 1, std::max<int>(config::MaxThreads, 1));
+		for (int i = 0; i < threadCount; i++)
+			workers.emplace_back(&ListConverter::workerLoop, this);
+	}
+	startedJobs = jobCount;
+	cond.notify_all();
+}
+
+const ConvertedList *ListConverter::get(const ICHList *list, const VertexParams& params)
+{
+	if (cursor == jobCount || jobs[cursor].list != list)
+		return nullptr;
+	Job& job = jobs[cursor++];
+	if (cursor > startedJobs)
+	{
+		// not visible to the worker threads
+		if (job.params != params)
+			return nullptr;
+		convertVertices(job.list, job.params, job.result);
+		return &job.result;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	if (job.params != params)
+	{
+		if (job.state == Pending)
+			job.state = Done;
+		return nullptr;
+	}
+	if (job.state == Pending)
+	{
+		job.state = Running;
+		lock.unlock();
+		convertVertices(job.list, job.params, job.result);
+		lock.lock();
+		job.state = Done;
+	}
+	else
+	{
+		doneCond.wait(lock, [&job]() { return job.state == Done; });
+	}
+	return &job.result;
+}
+
+void ListConverter::skip(const ICHList *list)
+{
+	if (cursor == jobCount || jobs[cursor].list != list)
+		return;
+	Job& job = jobs[cursor++];
+	if (cursor <= startedJobs)
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		if (job.state == Pending)
+			job.state = Done;
+	}
+}
+
+void ListConverter::finish()
+{
+	if (startedJobs > 0)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		nextJob = startedJobs;
+		doneCond.wait(lock, [this]() { return running == 0; });
+		nextJob = 0;
+		startedJobs = 0;
+	}
+	jobCount = 0;
+	vertexCount = 0;
+	cursor = 0;
+}
+
+void ListConverter::workerLoop()
+{
+	ThreadName _("ElanConverter");
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		cond.wait(lock, [this]() { return stopping || nextJob < startedJobs; });
+		if (stopping)
+			break;
+		Job& job = jobs[nextJob++];
+		if (job.state != Pending)
+			continue;
+		job.state = Running;
+		running++;
+		lock.unlock();
+
+		convertVertices(job.list, job.params, job.result);
+
+		lock.lock();
+		job.state = Done;
+		running--;
+		doneCond.notify_all();
+	}
+}
+
+void ListConverter::term()
+{
+	finish();
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		stopping = true;
+	}
+	cond.notify_all();
+	for (std::thread& thread : workers)
+		thread.join();
+	workers.clear();
+	stopping = false;
+	jobs.clear();
+}
+
+}
@@ -0,0 +1,139 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+#include "ta_ctx.h"
+#include "elan_struct.h"
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace elan
+{
+
+// ELAN state used to convert the vertices of a polygon list.
+// It is passed explicitly so that lists can be converted ahead of time on worker threads.
+struct VertexParams
+{
+	glm::mat4 matrix { 1.f };
+	float nearPlane = 0.001f;
+	float envMapU = 0.f;
+	float envMapV = 0.f;
+	bool bgra = false;
+	bool envMapping = false;
+	// GMP colors replacing the vertex colors, and their packed value
+	bool diffuse0 = false;
+	bool specular0 = false;
+	bool diffuse1 = false;
+	bool specular1 = false;
+	u32 diffuseColor0 = 0;
+	u32 specularColor0 = 0;
+	u32 diffuseColor1 = 0;
+	u32 specularColor1 = 0;
+
+	// Converts an ARGB color to the renderer vertex color format
+	u32 packColor(u32 argb) const {
+		return bgra ? argb : (argb & 0xff00ff00) | ((argb >> 16) & 0xff) | ((argb & 0xff) << 16);
+	}
+
+	// Model view matrix, near plane and environment map offsets of an instance matrix, if any
+	void setMatrix(const InstanceMatrix *mat);
+	// GMP colors, cached when the GMP is set
+	void setGmpColors(const GMP *gmp);
+	// GMP parameter selection, read when polygons are sent
+	void setGmpSelect(const GMP *gmp);
+
+	bool operator==(const VertexParams& other) const;
+	bool operator!=(const VertexParams& other) const {
+		return !(*this == other);
+	}
+};
+
+struct ConvertedList
+{
+	std::vector<Vertex> vertices;
+	// View space distance of each vertex to the near plane. Negative if the vertex is clipped.
+	std::vector<float> nearDist;
+	// View space bounding box
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// Converts the vertices of a polygon list and computes their view space bounding box and near plane distance.
+// The list vertex type must be V, VU, VR, VUR or VUB.
+void convertVertices(const ICHList *list, const VertexParams& params, ConvertedList& out);
+
+//
+// Converts the polygon lists of a display list ahead of time.
+// Lists are added in execution order before the display list is executed, and are converted
+// by worker threads when there are enough vertices. When executing, each list is retrieved in the
+// same order and converted synchronously if no worker has started it yet.
+//
+class ListConverter
+{
+public:
+	~ListConverter() {
+		term();
+	}
+
+	void add(const ICHList *list, const VertexParams& params);
+	// Starts converting the lists added so far
+	void start();
+	// Returns the list converted with the given params, or nullptr if it wasn't prepared or with different params
+	const ConvertedList *get(const ICHList *list, const VertexParams& params);
+	// Discards the next list if it's the given one
+	void skip(const ICHList *list);
+	// Waits for the running conversions to finish and clears all lists
+	void finish();
+	// Stops the worker threads
+	void term();
+
+private:
+	enum JobState { Pending, Running, Done };
+	struct Job
+	{
+		const ICHList *list;
+		VertexParams params;
+		ConvertedList result;
+		JobState state;
+	};
+
+	void workerLoop();
+
+	std::vector<Job> jobs;
+	size_t jobCount = 0;
+	size_t vertexCount = 0;
+	// Next job to be picked by the worker threads
+	size_t nextJob = 0;
+	// Jobs that can be picked by the worker threads
+	size_t startedJobs = 0;
+	// Jobs being converted by the worker threads
+	u32 running = 0;
+	// Next job to be retrieved
+	size_t cursor = 0;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::condition_variable doneCond;
+	bool stopping = false;
+};
+
+}
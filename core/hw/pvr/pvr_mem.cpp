@@ -241,6 +241,33 @@ template void pvr_write32p<u16, true>(u32 addr, u16 data);
 template void pvr_write32p<u32, false>(u32 addr, u32 data);
 template void pvr_write32p<u32, true>(u32 addr, u32 data);
 
+void pvr_read32p_block(u32 addr, void *dst, u32 size)
+{
+	u8 *p = (u8 *)dst;
+	for (; (addr & 3) != 0 && size > 0; size--)
+		*p++ = vram[pvr_map32(addr++)];
+	for (; size >= 4; size -= 4, addr += 4, p += 4)
+		memcpy(p, &vram[pvr_map32(addr)], 4);
+	for (; size > 0; size--)
+		*p++ = vram[pvr_map32(addr++)];
+}
+
+void pvr_write32p_block(u32 addr, const void *src, u32 size)
+{
+	const u8 *p = (const u8 *)src;
+	for (; (addr & 3) != 0 && size > 0; size--)
+		pvr_write32p<u8, true>(addr++, *p++);
+	for (; size >= 4; size -= 4, addr += 4, p += 4)
+	{
+		u32 vaddr = addr & VRAM_MASK;
+		if (vaddr >= fb_watch_addr_start && vaddr < fb_watch_addr_end)
+			fb_dirty = true;
+		memcpy(&vram[pvr_map32(addr)], p, 4);
+	}
+	for (; size > 0; size--)
+		pvr_write32p<u8, true>(addr++, *p++);
+}
+
 void DYNACALL TAWrite(u32 address, const SQBuffer *data, u32 count)
 {
 	if ((address & 0x800000) == 0)
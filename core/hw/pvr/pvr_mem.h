@@ -21,6 +21,9 @@ void YUV_reset();
 // 32-bit vram path handlers
 template<typename T> T DYNACALL pvr_read32p(u32 addr);
 template<typename T, bool Internal = false> void DYNACALL pvr_write32p(u32 addr, T data);
+// Block transfers to and from the 32-bit vram path. Sub-word accesses are only used at the ends.
+void pvr_read32p_block(u32 addr, void *dst, u32 size);
+void pvr_write32p_block(u32 addr, const void *src, u32 size);
 // Area 4 handlers
 template<typename T, bool upper> T DYNACALL pvr_read_area4(u32 addr);
 template<typename T, bool upper> void DYNACALL pvr_write_area4(u32 addr, T data);
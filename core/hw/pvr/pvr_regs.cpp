@@ -6,6 +6,8 @@
 #include <map>
 
 bool pal_needs_update=true;
+// Palette banks of 16 entries modified since the last palette update
+u64 pal_dirty_banks;
 
 u8 pvr_regs[pvr_RegSize];
 
@@ -217,8 +219,11 @@ void pvr_WriteReg(u32 paddr,u32 data)
 		break;
 
 	default:
-		if (addr >= PALETTE_RAM_START_addr && PvrReg(addr,u32) != data)
-			pal_needs_update = true;
+		if (addr >= PALETTE_RAM_START_addr && addr <= PALETTE_RAM_END_addr)
+		{
+			if (PvrReg(addr,u32) != data)
+				pal_dirty_banks |= 1ull << ((addr - PALETTE_RAM_START_addr) / (16 * 4));
+		}
 		else if (addr >= FOG_TABLE_START_addr && addr <= FOG_TABLE_END_addr && PvrReg(addr,u32) != data)
 			rend_updateFogTable();
 		break;
@@ -7,6 +7,7 @@
 #include "network/ggpo.h"
 #include "hw/pvr/Renderer_if.h"
 #include "stdclass.h"
+#include "profiler/perf_counters.h"
 #include <array>
 
 #ifdef TEST_AUTOMATION
@@ -157,12 +158,13 @@ static int spg_line_sched(int tag, int cycles, int jitter, void *arg)
 			rend_vblank();
 
 			u64 now = getTimeMs();
+			float cpu_speed = 0.f;
 			cpu_time_idx = (cpu_time_idx + 1) % cpu_cycles.size();
 			if (cpu_cycles[cpu_time_idx] != 0)
 			{
 				u32 cycle_span = (u32)(sh4_sched_now64() - cpu_cycles[cpu_time_idx]);
 				u64 time_span = now - real_times[cpu_time_idx];
-				float cpu_speed = ((float)cycle_span / time_span) / (SH4_MAIN_CLOCK / 100000);
+				cpu_speed = ((float)cycle_span / time_span) / (SH4_MAIN_CLOCK / 100000);
 				SH4FastEnough = cpu_speed >= 85.f;
 			}
 			else {
@@ -170,6 +172,7 @@ static int spg_line_sched(int tag, int cycles, int jitter, void *arg)
 			}
 			cpu_cycles[cpu_time_idx] = sh4_sched_now64();
 			real_times[cpu_time_idx] = now;
+			perfcounters::vblank(cpu_speed);
 
 #ifdef TEST_AUTOMATION
 			replay_input();
@@ -37,34 +37,6 @@ struct simd256_t
 	Uses a state machine, with 3 bits state and 8 bits (PT:OBJ[6:2]) input
 */
 
-enum ta_state
-{
-	               // -> TAS_NS, TAS_PLV32, TAS_PLHV32, TAS_PLV64, TAS_PLHV64, TAS_MLV64
-	TAS_NS,        //
-
-	               // -> TAS_NS, TAS_PLV32, TAS_PLHV32, TAS_PLV64, TAS_PLHV64
-	TAS_PLV32,     //polygon list PMV<?>, V32
-	
-	               // -> TAS_NS, TAS_PLV32, TAS_PLHV32, TAS_PLV64, TAS_PLHV64
-	TAS_PLV64,     //polygon list PMV<?>, V64
-
-	               // -> TAS_NS, TAS_MLV64, TAS_MLV64_H
-	TAS_MLV64,     //mv list
-
-	               // -> TAS_PLV32
-	TAS_PLHV32,    //polygon list PMV<64> 2nd half -> V32
-
-	               // -> TAS_PLV64
-	TAS_PLHV64,    //polygon list PMV<64> 2nd half -> V64
-
-	               // -> TAS_PLV64_H
-	TAS_PLV64_H,   //polygon list V64 2nd half
-
-
-	               // -> TAS_MLV64
-	TAS_MLV64_H,   //mv list, 64 bit half
-};
-
 /* state | PTEOS | OBJ -> next, proc*/
 
 #define ta_cur_state  (ta_fsm[2048])
@@ -524,6 +496,25 @@ void ta_vtx_SoftReset()
 	ta_cur_state = TAS_NS;
 }
 
+void DYNACALL ta_process_param()
+{
+	// First byte is PCW
+	PCW pcw = *(const PCW *)(ta_tad.thd_data - 32);
+
+	// 32-byte vertices continuing a strip don't change the state
+	if (ta_cur_state == TAS_PLV32 && pcw.ParaType == ParamType_Vertex_Parameter)
+		return;
+
+	u32 state_in = (ta_cur_state << 8) | (pcw.ParaType << 5) | ((pcw.obj_ctrl >> 2) & 31);
+
+	u32 trans = ta_fsm[state_in];
+	ta_cur_state = (ta_state)trans;
+	bool must_handle = trans & 0xF0;
+
+	if (unlikely(must_handle))
+		ta_handle_cmd(trans);
+}
+
 static void DYNACALL ta_thd_data32_i(const simd256_t *data)
 {
 	if (ta_ctx == NULL)
@@ -539,31 +530,12 @@ static void DYNACALL ta_thd_data32_i(const simd256_t *data)
 	}
 
 	simd256_t* dst = (simd256_t*)ta_tad.thd_data;
-
-	// First byte is PCW
-	PCW pcw = *(const PCW*)data;
-	
 	// Copy the TA data
 	*dst = *data;
-
 	ta_tad.thd_data += 32;
 
 	//process TA state
-	u32 state_in = (ta_cur_state << 8) | (pcw.ParaType << 5) | ((pcw.obj_ctrl >> 2) & 31);
-
-	u32 trans = ta_fsm[state_in];
-	ta_cur_state = (ta_state)trans;
-	bool must_handle = trans & 0xF0;
-
-
-	if (likely(!must_handle))
-	{
-		return;
-	}
-	else
-	{
-		ta_handle_cmd(trans);
-	}
+	ta_process_param();
 }
 
 void DYNACALL ta_vtx_data32(const SQBuffer *data)
@@ -573,23 +545,29 @@ void DYNACALL ta_vtx_data32(const SQBuffer *data)
 
 void ta_vtx_data(const SQBuffer *data, u32 size)
 {
-	while (size >= 4)
+	if (ta_ctx == nullptr)
 	{
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		size -= 4;
+		INFO_LOG(PVR, "Warning: data sent to TA prior to ListInit. Ignored");
+		return;
 	}
-
-	while (size > 0)
+	if (ta_tad.End() - ta_tad.thd_root >= (ptrdiff_t)TA_DATA_SIZE)
 	{
-		ta_thd_data32_i((simd256_t *)data);
-		data++;
-		size--;
+		INFO_LOG(PVR, "Warning: TA data buffer overflow");
+		asic_RaiseInterrupt(holly_MATR_NOMEM);
+		return;
+	}
+	// Copy the whole batch at once, then run the state machine on each parameter
+	const u32 room = (TA_DATA_SIZE - (ta_tad.thd_data - ta_tad.thd_root)) / sizeof(SQBuffer);
+	const u32 count = std::min(size, room);
+	memcpy(ta_tad.thd_data, data, count * sizeof(SQBuffer));
+	for (u32 i = 0; i < count; i++)
+	{
+		ta_tad.thd_data += sizeof(SQBuffer);
+		ta_process_param();
+	}
+	if (count < size)
+	{
+		INFO_LOG(PVR, "Warning: TA data buffer overflow");
+		asic_RaiseInterrupt(holly_MATR_NOMEM);
 	}
 }
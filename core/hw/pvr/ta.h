@@ -14,6 +14,40 @@ void ta_vtx_SoftReset();
 void DYNACALL ta_vtx_data32(const SQBuffer *data);
 void ta_vtx_data(const SQBuffer *data, u32 size);
 
+enum ta_state
+{
+	               // -> TAS_NS, TAS_PLV32, TAS_PLHV32, TAS_PLV64, TAS_PLHV64, TAS_MLV64
+	TAS_NS,        //
+
+	               // -> TAS_NS, TAS_PLV32, TAS_PLHV32, TAS_PLV64, TAS_PLHV64
+	TAS_PLV32,     //polygon list PMV<?>, V32
+	
+	               // -> TAS_NS, TAS_PLV32, TAS_PLHV32, TAS_PLV64, TAS_PLHV64
+	TAS_PLV64,     //polygon list PMV<?>, V64
+
+	               // -> TAS_NS, TAS_MLV64, TAS_MLV64_H
+	TAS_MLV64,     //mv list
+
+	               // -> TAS_PLV32
+	TAS_PLHV32,    //polygon list PMV<64> 2nd half -> V32
+
+	               // -> TAS_PLV64
+	TAS_PLHV64,    //polygon list PMV<64> 2nd half -> V64
+
+	               // -> TAS_PLV64_H
+	TAS_PLV64_H,   //polygon list V64 2nd half
+
+
+	               // -> TAS_MLV64
+	TAS_MLV64_H,   //mv list, 64 bit half
+};
+
+// TA state machine. [2048] stores the current state
+extern u8 ta_fsm[2049];
+// Runs the state machine for the parameter that has just been copied at ta_tad.thd_data - 32.
+// Used by the dynarec store queue path.
+void DYNACALL ta_process_param();
+
 void ta_parse(TA_context *ctx, bool primRestart);
 
 class TaTypeLut
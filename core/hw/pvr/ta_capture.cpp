@@ -0,0 +1,306 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "ta_capture.h"
+#include "ta.h"
+#include "ta_ctx.h"
+#include "pvr_regs.h"
+#include "pvr_mem.h"
+#include "Renderer_if.h"
+#include "hw/mem/addrspace.h"
+#include "rend/texconv.h"
+#include "rend/transform_matrix.h"
+#include "oslib/oslib.h"
+#include "emulator.h"
+#include "stdclass.h"
+#include "profiler/perf_counters.h"
+#include <nowide/cstdio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+extern bool pal_needs_update;
+
+namespace tacapture
+{
+
+constexpr u32 Version = 1;
+
+struct FileHeader
+{
+	char magic[4];
+	u32 version;
+	u32 platform;
+	u32 vramSize;
+	u32 contextCount;
+};
+
+// rend_context fields set when the frame is started
+struct FrameParams
+{
+	bool isRTT;
+	bool clearFramebuffer;
+	u32 fb_W_SOF1;
+	FB_W_CTRL_type fb_W_CTRL;
+	TA_GLOB_TILE_CLIP_type ta_GLOB_TILE_CLIP;
+	SCALER_CTL_type scaler_ctl;
+	FB_X_CLIP_type fb_X_CLIP;
+	FB_Y_CLIP_type fb_Y_CLIP;
+	u32 fb_W_LINESTRIDE;
+	RGBAColor fog_clamp_min;
+	RGBAColor fog_clamp_max;
+};
+
+static std::atomic<bool> captureRequested;
+static std::string replayPath;
+static int replayIterations;
+
+void request() {
+	captureRequested = true;
+}
+
+static void write(FILE *f, const void *data, size_t size)
+{
+	if (std::fwrite(data, 1, size, f) != size)
+		throw FlycastException("Write error");
+}
+
+static void read(FILE *f, void *data, size_t size)
+{
+	if (std::fread(data, 1, size, f) != size)
+		throw FlycastException("Truncated capture file");
+}
+
+void onStartRender(TA_context *ctx)
+{
+	if (!captureRequested.exchange(false))
+		return;
+	if (settings.platform.isNaomi2())
+	{
+		// Naomi 2 polygons are sent by the ELAN directly and aren't in the TA data
+		os_notify("Naomi 2 frames can't be captured", 2000);
+		return;
+	}
+	std::string date = timeToISO8601(time(nullptr));
+	std::replace(date.begin(), date.end(), '/', '-');
+	std::replace(date.begin(), date.end(), ':', '-');
+	std::string gameId = settings.content.gameId.empty() ? "flycast" : settings.content.gameId;
+	for (char& c : gameId)
+		if (!isalnum((u8)c))
+			c = '_';
+	std::string path = get_writable_data_path(gameId + "-" + date + ".tac");
+
+	FILE *f = nowide::fopen(path.c_str(), "wb");
+	if (f == nullptr)
+	{
+		WARN_LOG(PVR, "Can't create TA capture file %s", path.c_str());
+		os_notify("Frame capture failed", 2000);
+		return;
+	}
+	try {
+		FileHeader header{ { 'F', 'C', 'T', 'A' }, Version, (u32)settings.platform.system, VRAM_SIZE, 0 };
+		for (TA_context *c = ctx; c != nullptr; c = c->nextContext)
+			header.contextCount++;
+		write(f, &header, sizeof(header));
+
+		const rend_context& rend = ctx->rend;
+		FrameParams params{ rend.isRTT, rend.clearFramebuffer, rend.fb_W_SOF1, rend.fb_W_CTRL,
+			rend.ta_GLOB_TILE_CLIP, rend.scaler_ctl, rend.fb_X_CLIP, rend.fb_Y_CLIP, rend.fb_W_LINESTRIDE,
+			rend.fog_clamp_min, rend.fog_clamp_max };
+		write(f, &params, sizeof(params));
+		// Includes the palette and fog table
+		write(f, pvr_regs, pvr_RegSize);
+		// Textures may be anywhere in vram and are only known once the TA data is parsed
+		write(f, &vram[0], VRAM_SIZE);
+
+		for (TA_context *c = ctx; c != nullptr; c = c->nextContext)
+		{
+			const u32 size = c->tad.End() - c->tad.thd_root;
+			write(f, &size, sizeof(size));
+			write(f, c->tad.thd_root, size);
+		}
+		std::fclose(f);
+		INFO_LOG(PVR, "TA frame captured to %s", path.c_str());
+		os_notify("Frame captured", 2000, path.c_str());
+	} catch (const FlycastException& e) {
+		std::fclose(f);
+		nowide::remove(path.c_str());
+		WARN_LOG(PVR, "TA capture to %s failed: %s", path.c_str(), e.what());
+		os_notify("Frame capture failed", 2000);
+	}
+}
+
+void setReplay(const std::string& path, int iterations)
+{
+	replayPath = path;
+	replayIterations = std::max(iterations, 1);
+}
+
+bool replayRequested() {
+	return !replayPath.empty();
+}
+
+struct Timing
+{
+	double first = 0;
+	double min = 1e30;
+	double max = 0;
+	double total = 0;
+	int count = 0;
+
+	void add(std::chrono::steady_clock::time_point start)
+	{
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (count == 0)
+			first = ms;
+		min = std::min(min, ms);
+		max = std::max(max, ms);
+		total += ms;
+		count++;
+	}
+
+	void print(const char *name) const
+	{
+		if (count == 0)
+			return;
+		printf("%-8s first %8.3f ms  min %8.3f ms  avg %8.3f ms  max %8.3f ms\n", name, first, min, total / count, max);
+	}
+};
+
+static void prepareFrame(TA_context *ctx, const FrameParams& params)
+{
+	for (TA_context *c = ctx; c != nullptr; c = c->nextContext)
+		c->rend.Clear();
+	FillBGP(ctx);
+
+	rend_context& rend = ctx->rend;
+	rend.isRTT = params.isRTT;
+	rend.clearFramebuffer = params.clearFramebuffer;
+	rend.fb_W_SOF1 = params.fb_W_SOF1;
+	rend.fb_W_CTRL = params.fb_W_CTRL;
+	rend.ta_GLOB_TILE_CLIP = params.ta_GLOB_TILE_CLIP;
+	rend.scaler_ctl = params.scaler_ctl;
+	rend.fb_X_CLIP = params.fb_X_CLIP;
+	rend.fb_Y_CLIP = params.fb_Y_CLIP;
+	rend.fb_W_LINESTRIDE = params.fb_W_LINESTRIDE;
+	rend.fog_clamp_min = params.fog_clamp_min;
+	rend.fog_clamp_max = params.fog_clamp_max;
+	if (!rend.isRTT)
+	{
+		int width, height;
+		getScaledFramebufferSize(rend, width, height);
+		rend.framebufferWidth = width;
+		rend.framebufferHeight = height;
+	}
+}
+
+bool replay()
+{
+	FILE *f = nowide::fopen(replayPath.c_str(), "rb");
+	if (f == nullptr)
+	{
+		ERROR_LOG(PVR, "Can't open TA capture file %s", replayPath.c_str());
+		return false;
+	}
+	std::vector<std::unique_ptr<TA_context>> contexts;
+	FrameParams params;
+	try {
+		FileHeader header;
+		read(f, &header, sizeof(header));
+		if (memcmp(header.magic, "FCTA", sizeof(header.magic)) != 0 || header.version != Version)
+			throw FlycastException("Invalid file format or version");
+		if (header.contextCount == 0 || header.contextCount > MAX_PASSES)
+			throw FlycastException("Invalid context count");
+		if (header.platform != DC_PLATFORM_DREAMCAST && header.platform != DC_PLATFORM_NAOMI
+				&& header.platform != DC_PLATFORM_ATOMISWAVE && header.platform != DC_PLATFORM_SYSTEMSP)
+			throw FlycastException("Unsupported platform");
+		emu.initPlatform(header.platform);
+		if (header.vramSize != VRAM_SIZE)
+			throw FlycastException("Unexpected vram size");
+
+		read(f, &params, sizeof(params));
+		read(f, pvr_regs, pvr_RegSize);
+		addrspace::unprotectVram(0, VRAM_SIZE);
+		read(f, &vram[0], VRAM_SIZE);
+
+		for (u32 i = 0; i < header.contextCount; i++)
+		{
+			contexts.emplace_back(new TA_context());
+			TA_context *ctx = contexts.back().get();
+			ctx->Alloc();
+			u32 size;
+			read(f, &size, sizeof(size));
+			if (size > TA_DATA_SIZE)
+				throw FlycastException("Invalid TA data size");
+			read(f, ctx->tad.thd_root, size);
+			ctx->tad.thd_data = ctx->tad.thd_root + size;
+			if (i > 0)
+				contexts[i - 1]->nextContext = ctx;
+		}
+		std::fclose(f);
+	} catch (const FlycastException& e) {
+		std::fclose(f);
+		ERROR_LOG(PVR, "Can't load TA capture file %s: %s", replayPath.c_str(), e.what());
+		return false;
+	}
+	TA_context *ctx = contexts[0].get();
+	pal_needs_update = true;
+	palette_update();
+
+	printf("Replaying %s: %d iteration(s)\n", replayPath.c_str(), replayIterations);
+	// TA data parsing, sorting and indexing only
+	Timing parse;
+	for (int i = 0; i < replayIterations; i++)
+	{
+		prepareFrame(ctx, params);
+		const auto start = std::chrono::steady_clock::now();
+		ta_parse(ctx, true);
+		parse.add(start);
+	}
+	// Renderer processing (parsing and texture upload) and rendering
+	Timing process;
+	Timing render;
+	const u64 descSetUpdates = perfcounters::counters[perfcounters::DescSetUpdates];
+	const u64 descSetBinds = perfcounters::counters[perfcounters::DescSetBinds];
+	_pvrrc = ctx;
+	for (int i = 0; i < replayIterations; i++)
+	{
+		prepareFrame(ctx, params);
+		auto start = std::chrono::steady_clock::now();
+		renderer->Process(ctx);
+		process.add(start);
+
+		start = std::chrono::steady_clock::now();
+		renderer->Render();
+		render.add(start);
+	}
+	_pvrrc = nullptr;
+
+	parse.print("parse");
+	process.print("process");
+	render.print("render");
+	if (perfcounters::counters[perfcounters::DescSetBinds] != descSetBinds)
+		printf("per-poly descriptor sets: %.1f updates  %.1f binds per frame\n",
+				(double)(perfcounters::counters[perfcounters::DescSetUpdates] - descSetUpdates) / replayIterations,
+				(double)(perfcounters::counters[perfcounters::DescSetBinds] - descSetBinds) / replayIterations);
+	return true;
+}
+
+}
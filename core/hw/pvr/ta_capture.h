@@ -0,0 +1,46 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+#include <string>
+
+struct TA_context;
+
+//
+// Capture of a TA frame (TA data, PVR registers and VRAM) to a file
+// and offline replay through the current renderer to benchmark it.
+//
+namespace tacapture
+{
+
+// Capture the next rendered frame. Can be called from any thread.
+void request();
+
+// Called by the emulator thread when a frame is about to be rendered
+void onStartRender(TA_context *ctx);
+
+// Set the capture file to replay and the number of iterations. Set from the command line.
+void setReplay(const std::string& path, int iterations);
+bool replayRequested();
+
+// Replay the capture file through the current renderer and print the timings.
+// Must be called from the rendering thread once the renderer is initialized.
+bool replay();
+
+}
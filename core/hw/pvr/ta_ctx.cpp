@@ -4,6 +4,7 @@
 #include "Renderer_if.h"
 #include "serialize.h"
 #include "stdclass.h"
+#include "profiler/perf_counters.h"
 
 #include <mutex>
 #include <vector>
@@ -68,7 +69,10 @@ bool QueueRender(TA_context* ctx)
 	{
 		tactx_Recycle(ctx);
 		if (rend_is_enabled())
+		{
 			fskip++;
+			perfcounters::add(perfcounters::FramesSkipped);
+		}
 		return false;
 	}
 	// disable net rollbacks until the render thread has processed the frame
@@ -84,7 +88,10 @@ bool QueueRender(TA_context* ctx)
 TA_context* DequeueRender()
 {
 	if (rqueue != nullptr)
+	{
 		FrameCount++;
+		perfcounters::add(perfcounters::FramesRendered);
+	}
 
 	return rqueue;
 }
@@ -431,6 +431,7 @@ void getRegionTileAddrAndSize(u32& address, u32& size);
 void sortTriangles(rend_context& ctx, RenderPass& pass, const RenderPass& previousPass);
 void sortPolyParams(std::vector<PolyParam>& polys, int first, int end, rend_context& ctx);
 void fix_texture_bleeding(const std::vector<PolyParam>& polys, int first, int end, rend_context& ctx);
+void groupPolyParams(std::vector<PolyParam>& polys, int first, int end, rend_context& ctx);
 void makeIndex(std::vector<PolyParam>& polys, int first, int end, bool merge, rend_context& ctx);
 void makePrimRestartIndex(std::vector<PolyParam>& polys, int first, int end, bool merge, rend_context& ctx);
 
@@ -318,6 +318,113 @@ int getTAContextAddresses(u32 *addresses)
 	return count;
 }
 
+//
+// Reorder polygons so that the ones with the same rendering state are consecutive and
+// can be merged into a single draw call by makeIndex.
+// A polygon is only moved before polygons that don't overlap it on screen, so the
+// result doesn't depend on the depth compare mode, depth writes or blending.
+//
+void groupPolyParams(std::vector<PolyParam>& polys, int first, int end, rend_context& ctx)
+{
+	if (end - first <= 2)
+		return;
+
+	struct Rect
+	{
+		float xmin = 1e38f;
+		float ymin = 1e38f;
+		float xmax = -1e38f;
+		float ymax = -1e38f;
+
+		void add(const Rect& other) {
+			xmin = std::min(xmin, other.xmin);
+			ymin = std::min(ymin, other.ymin);
+			xmax = std::max(xmax, other.xmax);
+			ymax = std::max(ymax, other.ymax);
+		}
+		bool intersects(const Rect& other) const {
+			return xmin <= other.xmax && other.xmin <= xmax
+				&& ymin <= other.ymax && other.ymin <= ymax;
+		}
+	};
+	struct Group
+	{
+		const PolyParam *head;
+		Rect bounds;
+		u32 count;
+	};
+	// Number of groups a polygon can move back. Limits the cost with long lists.
+	constexpr int MaxLookback = 16;
+
+	std::vector<Group> groups;
+	std::vector<u32> groupIds(end - first);
+	for (int i = first; i < end; i++)
+	{
+		const PolyParam& pp = polys[i];
+		Rect bounds;
+		if (pp.isNaomi2())
+		{
+			// The screen position of Naomi2 vertices is only known after transformation
+			bounds.xmin = bounds.ymin = -1e38f;
+			bounds.xmax = bounds.ymax = 1e38f;
+		}
+		else
+		{
+			for (u32 j = 0; j < pp.count; j++)
+			{
+				const Vertex& vtx = ctx.verts[pp.first + j];
+				if (is_vertex_inf(vtx))
+					continue;
+				bounds.xmin = std::min(bounds.xmin, vtx.x);
+				bounds.ymin = std::min(bounds.ymin, vtx.y);
+				bounds.xmax = std::max(bounds.xmax, vtx.x);
+				bounds.ymax = std::max(bounds.ymax, vtx.y);
+			}
+		}
+		int groupId = -1;
+		Rect later;
+		const int stop = std::max(0, (int)groups.size() - MaxLookback);
+		for (int g = (int)groups.size() - 1; g >= stop; g--)
+		{
+			if (groups[g].head->equivalentIgnoreCullingDirection(pp)) {
+				groupId = g;
+				break;
+			}
+			// the polygon would be drawn before the ones of this group
+			later.add(groups[g].bounds);
+			if (later.intersects(bounds))
+				break;
+		}
+		if (groupId == -1)
+		{
+			groupId = groups.size();
+			groups.push_back({ &pp, bounds, 1 });
+		}
+		else
+		{
+			groups[groupId].bounds.add(bounds);
+			groups[groupId].count++;
+		}
+		groupIds[i - first] = groupId;
+	}
+	if (groups.size() == groupIds.size())
+		// nothing to group
+		return;
+
+	// Stable counting sort by group
+	std::vector<u32> groupStart(groups.size());
+	u32 start = 0;
+	for (u32 g = 0; g < groups.size(); g++)
+	{
+		groupStart[g] = start;
+		start += groups[g].count;
+	}
+	std::vector<PolyParam> sorted(end - first);
+	for (int i = first; i < end; i++)
+		sorted[groupStart[groupIds[i - first]]++] = polys[i];
+	std::copy(sorted.begin(), sorted.end(), polys.begin() + first);
+}
+
 void fix_texture_bleeding(const std::vector<PolyParam>& polys, int first, int end, rend_context& ctx)
 {
 	auto pp_end = polys.begin() + end;
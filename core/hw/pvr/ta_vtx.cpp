@@ -9,6 +9,7 @@
 #include "pvr_mem.h"
 #include "Renderer_if.h"
 #include "cfg/option.h"
+#include "profiler/perf_counters.h"
 
 #include <algorithm>
 #include <utility>
@@ -1168,6 +1169,9 @@ static void parseRenderPass(RenderPass& pass, const RenderPass& previousPass, re
 		fix_texture_bleeding(ctx.global_param_pt, previousPass.pt_count, pass.pt_count, ctx);
 		fix_texture_bleeding(ctx.global_param_tr, previousPass.tr_count, pass.tr_count, ctx);
 	}
+	// Order doesn't matter between opaque or punch-through polygons that don't overlap
+	groupPolyParams(ctx.global_param_op, previousPass.op_count, pass.op_count, ctx);
+	groupPolyParams(ctx.global_param_pt, previousPass.pt_count, pass.pt_count, ctx);
 	if (primRestart)
 	{
 		makePrimRestartIndex(ctx.global_param_op, previousPass.op_count, pass.op_count, true, ctx);
@@ -1320,6 +1324,9 @@ void ta_parse(TA_context *ctx, bool primRestart)
 		ta_parse_naomi2(ctx, primRestart);
 	else
 		ta_parse_vdrc(ctx, primRestart);
+	perfcounters::add(perfcounters::TaVertices, ctx->rend.verts.size());
+	perfcounters::add(perfcounters::TaPolygons, ctx->rend.global_param_op.size()
+			+ ctx->rend.global_param_pt.size() + ctx->rend.global_param_tr.size());
 }
 
 //
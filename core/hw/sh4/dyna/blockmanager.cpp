@@ -15,7 +15,9 @@
 #include "hw/sh4/sh4_opcode_list.h"
 #include "hw/sh4/sh4_sched.h"
 #include "hw/sh4/modules/mmu.h"
+#include "hw/sh4/modules/shadowmmu.h"
 #include "oslib/virtmem.h"
+#include "profiler/perf_counters.h"
 
 #if defined(__unix__) && defined(DYNA_OPROF)
 #include <opagent.h>
@@ -178,6 +180,7 @@ void bm_AddBlock(RuntimeBlockInfo* blk)
 
 	verify((void*)bm_GetCode(block->addr) == (void*)ngen_FailedToFindBlock);
 	FPCA(block->addr) = (DynarecCodeEntryPtr)CC_RW2RX(block->code);
+	perfcounters::add(perfcounters::BlocksCompiled);
 
 #ifdef DYNA_OPROF
 	if (oprofHandle)
@@ -261,6 +264,7 @@ void bm_Reset()
 	{
 		virtmem::region_unlock(&mem_b[0], RAM_SIZE);
 	}
+	shadowmmu::unlockPage(0, RAM_SIZE);
 }
 
 void bm_LockPage(u32 addr, u32 size)
@@ -270,6 +274,7 @@ void bm_LockPage(u32 addr, u32 size)
 		virtmem::region_lock(addrspace::ram_base + 0x0C000000 + addr, size);
 	else
 		virtmem::region_lock(&mem_b[addr], size);
+	shadowmmu::lockPage(addr, size);
 }
 
 void bm_UnlockPage(u32 addr, u32 size)
@@ -279,10 +284,12 @@ void bm_UnlockPage(u32 addr, u32 size)
 		virtmem::region_unlock(addrspace::ram_base + 0x0C000000 + addr, size);
 	else
 		virtmem::region_unlock(&mem_b[addr], size);
+	shadowmmu::unlockPage(addr, size);
 }
 
 void bm_ResetCache()
 {
+	perfcounters::add(perfcounters::CacheResets);
 	sh4Dynarec->reset();
 	addrspace::bm_reset();
 
@@ -13,6 +13,7 @@
 #include "../sh4_cache.h"
 #include "debug/gdb_server.h"
 #include "../sh4_cycles.h"
+#include "profiler/guest_profiler.h"
 
 Sh4ICache icache;
 Sh4OCache ocache;
@@ -173,6 +174,8 @@ void Sh4Interpreter::ExecuteDelayslot_RTE()
 // every SH4_TIMESLICE cycles
 int UpdateSystem_INTC()
 {
+	if (unlikely(guestprof::active))
+		guestprof::sample(Sh4cntx.pc, Sh4cntx.pr);
 	Sh4cntx.sh4_sched_next -= SH4_TIMESLICE;
 	if (Sh4cntx.sh4_sched_next < 0)
 		sh4_sched_tick(SH4_TIMESLICE);
@@ -17,6 +17,7 @@
     along with reicast.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "mmu.h"
+#include "shadowmmu.h"
 #include "hw/sh4/sh4_if.h"
 #include "hw/sh4/sh4_core.h"
 #include "types.h"
@@ -25,6 +26,15 @@
 #ifdef FAST_MMU
 
 #include "hw/sh4/sh4_mem.h"
+#include "profiler/dc_profiler.h"
+#include <algorithm>
+#include <vector>
+
+#if DC_PROFILER
+#define MMU_PROFILE(counter) dc_prof.counters.mmu.counter++
+#else
+#define MMU_PROFILE(counter)
+#endif
 
 extern TLB_Entry UTLB[64];
 // Used when FullMMU is off
@@ -176,6 +186,131 @@ int main(int argc, char *argv[])
 }
 #endif
 
+// mmuAddressLUT is filled lazily by mmuDynarecLookup. Filled pages are tracked so that flushing only clears them.
+// WinCE maps the current process in slot 0 (first 32 MB), so slot 0 pages must be flushed on each process switch.
+// They're saved per ASID and restored when the process is scheduled again, unless a TLB entry in slot 0 was
+// loaded for this ASID (or a shared one) in the meantime.
+constexpr u32 SLOT0_PAGES = (32 * 1024 * 1024) >> 12;
+constexpr u32 USER_PAGES = std::size(mmuAddressLUT) / 2;
+constexpr size_t MAX_USER_PAGES = 65536;
+
+struct LutEntry
+{
+	u32 vpn;
+	u32 paddr;
+};
+// slot 0 pages filled for the current ASID
+static std::vector<u32> slot0Pages;
+// other user pages filled since the last full flush
+static std::vector<u32> userPages;
+static bool userPagesOverflow;
+// slot 0 pages of each ASID, valid if asidGeneration[asid] == slot0Generation
+static std::vector<LutEntry> asidPages[256];
+static u32 asidGeneration[256];
+static u32 slot0Generation = 1;
+// UTLB entries as of their last sync, to invalidate the translations of the entries they replace
+static TLB_Entry syncedUTLB[64];
+static bool utlbSynced[64];
+
+void mmuAddressLUTSet(u32 vaddr, u32 paddr)
+{
+	const u32 vpn = vaddr >> 12;
+	paddr &= ~0xfff;
+	if (mmuAddressLUT[vpn] == 0 && paddr != 0)
+	{
+		MMU_PROFILE(lut_fill);
+		if (vpn < SLOT0_PAGES)
+			slot0Pages.push_back(vpn);
+		else if (userPages.size() < MAX_USER_PAGES)
+			userPages.push_back(vpn);
+		else
+			userPagesOverflow = true;
+	}
+	mmuAddressLUT[vpn] = paddr;
+}
+
+static void flushSlot0()
+{
+	for (u32 vpn : slot0Pages)
+		mmuAddressLUT[vpn] = 0;
+	slot0Pages.clear();
+}
+
+void mmuAddressLUTSwitchAsid(u32 oldAsid, u32 newAsid)
+{
+	MMU_PROFILE(asid_switch);
+	std::vector<LutEntry>& saved = asidPages[oldAsid];
+	saved.clear();
+	for (u32 vpn : slot0Pages)
+		saved.push_back({ vpn, mmuAddressLUT[vpn] });
+	asidGeneration[oldAsid] = slot0Generation;
+	flushSlot0();
+	shadowmmu::switchAsid();
+
+	if (asidGeneration[newAsid] != slot0Generation)
+		return;
+	MMU_PROFILE(asid_restore);
+	for (const LutEntry& entry : asidPages[newAsid])
+	{
+		mmuAddressLUT[entry.vpn] = entry.paddr;
+		slot0Pages.push_back(entry.vpn);
+	}
+}
+
+static void flushAddressLUT()
+{
+	MMU_PROFILE(full_flush);
+	if (userPagesOverflow)
+		memset(mmuAddressLUT, 0, USER_PAGES * sizeof(u32));
+	else
+	{
+		for (u32 vpn : userPages)
+			mmuAddressLUT[vpn] = 0;
+		flushSlot0();
+	}
+	slot0Pages.clear();
+	userPages.clear();
+	userPagesOverflow = false;
+	slot0Generation++;
+	memset(utlbSynced, 0, sizeof(utlbSynced));
+}
+
+// Invalidates the slot 0 pages covered by a TLB entry that has been loaded or evicted
+static void invalidateSlot0Pages(const TLB_Entry& entry)
+{
+	const u32 sz = entry.Data.SZ1 * 2 + entry.Data.SZ0;
+	const u32 start = ((u32)entry.Address.VPN << 10) & mmu_mask[sz];
+	if (start >= SLOT0_PAGES << 12)
+		return;
+	if (entry.Data.SH == 1)
+		slot0Generation++;
+	else
+		asidGeneration[entry.Address.ASID] = 0;
+	if (entry.Data.SH == 1 || entry.Address.ASID == CCN_PTEH.ASID)
+	{
+		// pages of the current process are dropped from the LUT
+		const u32 end = std::min(start + ~mmu_mask[sz] + 1, SLOT0_PAGES << 12);
+		for (u32 vpn = start >> 12; vpn < (end + 0xfff) >> 12; vpn++)
+			mmuAddressLUT[vpn] = 0;
+	}
+}
+
+// Called when UTLB[index] has been written
+static void utlbEntryChanged(u32 index)
+{
+	const TLB_Entry& entry = UTLB[index];
+	if (utlbSynced[index])
+	{
+		// the evicted entry
+		invalidateSlot0Pages(syncedUTLB[index]);
+		shadowmmu::invalidate(syncedUTLB[index]);
+	}
+	invalidateSlot0Pages(entry);
+	shadowmmu::invalidate(entry);
+	syncedUTLB[index] = entry;
+	utlbSynced[index] = true;
+}
+
 bool UTLB_Sync(u32 entry)
 {
 	TLB_Entry& tlb_entry = UTLB[entry];
@@ -189,6 +324,7 @@ bool UTLB_Sync(u32 entry)
 	lru_address = tlb_entry.Address.VPN << 10;
 
 	cache_entry(tlb_entry);
+	utlbEntryChanged(entry);
 
 	if (!mmu_enabled() && (tlb_entry.Address.VPN & (0xFC000000 >> 10)) == (0xE0000000 >> 10))
 	{
@@ -214,6 +350,7 @@ MmuError mmu_full_lookup(u32 va, const TLB_Entry** tlb_entry_ret, u32& rv)
 						|| lru_entry->Data.SH == 1
 						/*|| (sr.MD == 1 && CCN_MMUCR.SV == 1)*/))	// SV=1 not handled
 		{
+			MMU_PROFILE(tlb_lru_hit);
 			//VPN->PPN | low bits
 			rv = (lru_entry->Data.PPN << 10) | (va & ~lru_mask);
 			if (tlb_entry_ret != nullptr)
@@ -228,6 +365,7 @@ MmuError mmu_full_lookup(u32 va, const TLB_Entry** tlb_entry_ret, u32& rv)
 
 	if (find_entry(va, tlb_entry_ret))
 	{
+		MMU_PROFILE(tlb_hit);
 		u32 mask = mmu_mask[(*tlb_entry_ret)->Data.SZ1 * 2 + (*tlb_entry_ret)->Data.SZ0];
 		rv = ((*tlb_entry_ret)->Data.PPN << 10) | (va & ~mask);
 		lru_entry = *tlb_entry_ret;
@@ -256,12 +394,14 @@ MmuError mmu_full_lookup(u32 va, const TLB_Entry** tlb_entry_ret, u32& rv)
 		rv = (entry.Data.PPN << 10) | (va & ~mmu_mask[sz]);
 
 		cache_entry(entry);
+		utlbEntryChanged(CCN_MMUCR.URC);
 
 		p_sh4rcb->cntx.cycle_counter -= 164;
 
 		return MmuError::NONE;
 	}
 #endif
+	MMU_PROFILE(tlb_miss);
 
 	return MmuError::TLB_MISS;
 }
@@ -321,6 +461,7 @@ void mmu_flush_table()
 {
 	lru_entry = nullptr;
 	flush_cache();
-	mmuAddressLUTFlush(true);
+	flushAddressLUT();
+	shadowmmu::flush();
 }
 #endif 	// FAST_MMU
@@ -1,4 +1,5 @@
 #include "mmu.h"
+#include "shadowmmu.h"
 #include "hw/mem/addrspace.h"
 #include "hw/sh4/sh4_if.h"
 #include "hw/sh4/sh4_interrupts.h"
@@ -457,6 +458,7 @@ void mmu_set_state()
 
 	SetMemoryHandlers();
 	setSqwHandler();
+	shadowmmu::setPrivileged(Sh4cntx.sr.MD);
 }
 
 #ifdef FAST_MMU
@@ -485,6 +487,7 @@ void MMU_init()
 	for (u32 vpn = std::size(mmuAddressLUT) / 2; vpn < std::size(mmuAddressLUT); vpn++)
 		mmuAddressLUT[vpn] = vpn << 12;
 #endif
+	shadowmmu::init();
 }
 
 
@@ -495,10 +498,12 @@ void MMU_reset()
 	mmu_set_state();
 	mmu_flush_table();
 	memset(sq_remap, 0, sizeof(sq_remap));
+	shadowmmu::reset();
 }
 
 void MMU_term()
 {
+	shadowmmu::term();
 }
 
 #ifndef FAST_MMU
@@ -120,16 +120,8 @@ void mmu_TranslateSQW(u32 adr, u32* out);
 // maps 4K virtual page number to physical address
 extern u32 mmuAddressLUT[0x100000];
 
-static inline void mmuAddressLUTFlush(bool full)
-{
-	if (full)
-		memset(mmuAddressLUT, 0, sizeof(mmuAddressLUT) / 2);	// flush user memory
-	else
-	{
-		constexpr u32 slotPages = (32 * 1024 * 1024) >> 12;
-		memset(mmuAddressLUT, 0, slotPages * sizeof(u32));		// flush slot 0
-	}
-}
+void mmuAddressLUTSet(u32 vaddr, u32 paddr);
+void mmuAddressLUTSwitchAsid(u32 oldAsid, u32 newAsid);
 #endif
 
 #if FEAT_SHREC == DYNAREC_JIT
@@ -154,7 +146,7 @@ static inline u32 DYNACALL mmuDynarecLookup(u32 vaddr, u32 write, u32 pc)
 	}
 #ifdef FAST_MMU
 	if (vaddr >> 31 == 0)
-		mmuAddressLUT[vaddr >> 12] = paddr & ~0xfff;
+		mmuAddressLUTSet(vaddr, paddr);
 #endif
 
 	return paddr;
@@ -0,0 +1,380 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "shadowmmu.h"
+
+#if defined(FAST_MMU) && HOST_CPU == CPU_X64 && FEAT_SHREC == DYNAREC_JIT
+#include "hw/mem/addrspace.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include "oslib/virtmem.h"
+#include "cfg/option.h"
+#include <algorithm>
+#include <vector>
+
+namespace shadowmmu
+{
+
+constexpr size_t SHADOW_SIZE = 4_GB;
+constexpr u32 SHADOW_PAGE_SIZE = 4_KB;
+// System RAM in P1 and P2
+constexpr u32 RAM_AREAS[] { 0x8C000000, 0xAC000000 };
+
+u8 *base;
+u8 *spaceBases[2];
+bool active;
+
+enum PageState : u8
+{
+	Unmapped,
+	ReadOnly,
+	ReadWrite
+};
+
+struct MappedPage
+{
+	u32 vpn;
+	u32 ramPage;
+	bool shared;
+	bool writable;	// writes allowed by the TLB entry
+};
+
+struct AddressSpace
+{
+	std::vector<u8> pageState;
+	std::vector<MappedPage> mappedPages;
+};
+// user and privileged address spaces
+static AddressSpace spaces[2];
+// system RAM pages holding compiled code
+static std::vector<bool> lockedPages;
+
+void init()
+{
+	if (PAGE_SIZE != SHADOW_PAGE_SIZE || !addrspace::virtmemEnabled())
+		return;
+	for (int i = 0; i < 2; i++)
+	{
+		spaceBases[i] = (u8 *)virtmem::reserve_shadow(SHADOW_SIZE);
+		if (spaceBases[i] == nullptr)
+		{
+			WARN_LOG(VMEM, "Shadow MMU address space reservation failed");
+			term();
+			return;
+		}
+		spaces[i].pageState.resize(SHADOW_SIZE / SHADOW_PAGE_SIZE);
+	}
+	base = spaceBases[1];
+	INFO_LOG(VMEM, "Shadow MMU address spaces at %p (user) and %p (privileged)", spaceBases[0], spaceBases[1]);
+}
+
+void term()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (spaceBases[i] != nullptr)
+			virtmem::release_shadow(spaceBases[i], SHADOW_SIZE);
+		spaceBases[i] = nullptr;
+		spaces[i].pageState.clear();
+		spaces[i].mappedPages.clear();
+	}
+	base = nullptr;
+	active = false;
+	lockedPages.clear();
+}
+
+void reset()
+{
+	if (base == nullptr)
+		return;
+	for (int i = 0; i < 2; i++)
+	{
+		virtmem::unmap_shadow(spaceBases[i], SHADOW_SIZE);
+		std::fill(spaces[i].pageState.begin(), spaces[i].pageState.end(), Unmapped);
+		spaces[i].mappedPages.clear();
+	}
+	lockedPages.assign(RAM_SIZE / SHADOW_PAGE_SIZE, false);
+	setPrivileged(Sh4cntx.sr.MD);
+
+	// Net rollback watches writes to the RAM mapping, which shadow mappings would bypass
+	active = config::ShadowMMU && !config::GGPOEnable;
+	if (!active)
+		return;
+	// P1 and P2 aren't translated: map system RAM and its mirrors in the privileged address space.
+	// System RAM is at the start of the memory file.
+	for (u32 area : RAM_AREAS)
+		for (u32 addr = area; addr < area + 0x04000000; addr += RAM_SIZE)
+			if (!virtmem::map_shadow(spaceBases[1] + addr, RAM_SIZE, 0, true))
+			{
+				WARN_LOG(VMEM, "Shadow MMU mapping failed");
+				active = false;
+				return;
+			}
+}
+
+static MmuError checkAccess(const TLB_Entry& entry, bool write)
+{
+	// privileged page accessed in user mode
+	if ((entry.Data.PR >> 1) == 0 && Sh4cntx.sr.MD == 0)
+		return MmuError::PROTECTED;
+	if (write)
+	{
+		if ((entry.Data.PR & 1) == 0)
+			return MmuError::PROTECTED;
+		if (entry.Data.D == 0)
+			return MmuError::FIRSTWRITE;
+	}
+	return MmuError::NONE;
+}
+
+MmuError translate(u32 vaddr, bool write, u32& paddr)
+{
+	if (write && (vaddr & 0xFC000000) == 0xE0000000)
+	{
+		// store queue writes aren't translated, only write backs are
+		paddr = vaddr;
+		return MmuError::NONE;
+	}
+	if (Sh4cntx.sr.MD == 0 && (vaddr & 0x80000000) != 0)
+		return MmuError::BADADDR;
+	if (!mmu_is_translated(vaddr, 1))
+	{
+		paddr = vaddr;
+		return MmuError::NONE;
+	}
+	const TLB_Entry *entry;
+	MmuError rv = mmu_full_lookup(vaddr, &entry, paddr);
+	if (rv == MmuError::NONE)
+		rv = checkAccess(*entry, write);
+	if (rv == MmuError::NONE && (paddr & 0x1C000000) == 0x1C000000)
+		// map 1C000000-1FFFFFFF to P4 memory-mapped registers
+		paddr |= 0xF0000000;
+
+	return rv;
+}
+
+MapResult mapPage(u32 vaddr, bool write)
+{
+	// P4 and the on-chip RAM area are never mapped
+	if (vaddr >= 0xE0000000 || (vaddr & 0xFC000000) == 0x7C000000)
+		return MapResult::NotRam;
+	const bool privileged = Sh4cntx.sr.MD == 1;
+	if (!privileged && vaddr >= 0x80000000)
+		// Address error. The same code may run in privileged mode so the access isn't patched.
+		return MapResult::Fault;
+	if (vaddr < 0xC0000000 && vaddr >= 0x80000000)
+	{
+		// System RAM is mapped in P1 and P2 so only writes to pages holding compiled code fault
+		if (write && (vaddr & 0x1C000000) == 0x0C000000 && lockedPages[(vaddr & RAM_MASK) / SHADOW_PAGE_SIZE])
+		{
+			bm_RamWriteAccess(vaddr);
+			return MapResult::Mapped;
+		}
+		return MapResult::NotRam;
+	}
+
+	const TLB_Entry *entry;
+	u32 paddr;
+	if (mmu_full_lookup(vaddr, &entry, paddr) != MmuError::NONE
+			|| checkAccess(*entry, write) != MmuError::NONE)
+		// let the slow path raise the exception. The page may be mapped later.
+		return MapResult::Fault;
+	// 1 KB pages are smaller than host pages
+	if (entry->Data.SZ0 == 0 && entry->Data.SZ1 == 0)
+		return MapResult::NotRam;
+	// Only system RAM (area 3) is mapped
+	if ((paddr & 0x1C000000) != 0x0C000000)
+		return MapResult::NotRam;
+
+	AddressSpace& space = spaces[privileged];
+	const u32 vpn = vaddr / SHADOW_PAGE_SIZE;
+	const u32 ramPage = (paddr & RAM_MASK) / SHADOW_PAGE_SIZE;
+	u8& state = space.pageState[vpn];
+	if (state == ReadWrite || (state == ReadOnly && !write))
+		// access crossing a page boundary
+		return MapResult::NotRam;
+	if (write && lockedPages[ramPage])
+		// discard the compiled code of this page, which unlocks it
+		bm_RamWriteAccess(paddr);
+	if (state == ReadWrite)
+		// mapping made writable by bm_RamWriteAccess
+		return MapResult::Mapped;
+	u8 *hostAddr = spaceBases[privileged] + (size_t)vpn * SHADOW_PAGE_SIZE;
+	if (state == ReadOnly)
+	{
+		if (!virtmem::region_unlock(hostAddr, SHADOW_PAGE_SIZE))
+			return MapResult::NotRam;
+		state = ReadWrite;
+		return MapResult::Mapped;
+	}
+	// Pages are read-only until the first write if the dirty bit isn't set
+	const bool writable = (entry->Data.PR & 1) == 1 && entry->Data.D == 1;
+	const bool readWrite = writable && !lockedPages[ramPage];
+	if (!virtmem::map_shadow(hostAddr, SHADOW_PAGE_SIZE, ramPage * SHADOW_PAGE_SIZE, readWrite))
+		return MapResult::NotRam;
+	state = readWrite ? ReadWrite : ReadOnly;
+	space.mappedPages.push_back({ vpn, ramPage, entry->Data.SH == 1, writable });
+
+	return MapResult::Mapped;
+}
+
+static void unmapPages(u8 *spaceBase, std::vector<u32>& vpns)
+{
+	// unmap contiguous pages together
+	std::sort(vpns.begin(), vpns.end());
+	for (size_t i = 0; i < vpns.size(); )
+	{
+		size_t j = i + 1;
+		while (j < vpns.size() && vpns[j] == vpns[j - 1] + 1)
+			j++;
+		virtmem::unmap_shadow(spaceBase + (size_t)vpns[i] * SHADOW_PAGE_SIZE, (j - i) * SHADOW_PAGE_SIZE);
+		i = j;
+	}
+}
+
+// Unmaps the pages of a TLB entry that has been loaded or evicted
+void invalidate(const TLB_Entry& entry)
+{
+	if (!active)
+		return;
+	const u32 sz = entry.Data.SZ1 * 2 + entry.Data.SZ0;
+	const u32 start = ((u32)entry.Address.VPN << 10) & mmu_mask[sz];
+	const u32 size = ~mmu_mask[sz] + 1;
+	if (!mmu_is_translated(start, size))
+		// P1 and P2 mappings aren't affected and P4 isn't mapped
+		return;
+	for (int i = 0; i < 2; i++)
+	{
+		AddressSpace& space = spaces[i];
+		if (space.mappedPages.empty())
+			continue;
+		bool unmapped = false;
+		for (u32 vpn = start / SHADOW_PAGE_SIZE; vpn <= (start + size - 1) / SHADOW_PAGE_SIZE; vpn++)
+			if (space.pageState[vpn] != Unmapped)
+			{
+				virtmem::unmap_shadow(spaceBases[i] + (size_t)vpn * SHADOW_PAGE_SIZE, SHADOW_PAGE_SIZE);
+				space.pageState[vpn] = Unmapped;
+				unmapped = true;
+			}
+		if (unmapped)
+			space.mappedPages.erase(std::remove_if(space.mappedPages.begin(), space.mappedPages.end(),
+					[&space](const MappedPage& page) { return space.pageState[page.vpn] == Unmapped; }),
+				space.mappedPages.end());
+	}
+}
+
+// Unmap the pages of the previous process. Pages of shared TLB entries are kept.
+void switchAsid()
+{
+	if (!active)
+		return;
+	for (int i = 0; i < 2; i++)
+	{
+		AddressSpace& space = spaces[i];
+		if (space.mappedPages.empty())
+			continue;
+		std::vector<u32> vpns;
+		std::vector<MappedPage> kept;
+		for (const MappedPage& page : space.mappedPages)
+		{
+			if (page.shared)
+			{
+				kept.push_back(page);
+			}
+			else
+			{
+				vpns.push_back(page.vpn);
+				space.pageState[page.vpn] = Unmapped;
+			}
+		}
+		unmapPages(spaceBases[i], vpns);
+		space.mappedPages = std::move(kept);
+	}
+}
+
+void flush()
+{
+	if (!active)
+		return;
+	for (int i = 0; i < 2; i++)
+	{
+		AddressSpace& space = spaces[i];
+		if (space.mappedPages.empty())
+			continue;
+		std::vector<u32> vpns;
+		for (const MappedPage& page : space.mappedPages)
+		{
+			vpns.push_back(page.vpn);
+			space.pageState[page.vpn] = Unmapped;
+		}
+		unmapPages(spaceBases[i], vpns);
+		space.mappedPages.clear();
+	}
+}
+
+// Changes the protection of the given system RAM range and of all its mappings
+static void protectRam(u32 addr, u32 size, bool locked)
+{
+	const u32 firstPage = addr / SHADOW_PAGE_SIZE;
+	const u32 lastPage = (addr + size - 1) / SHADOW_PAGE_SIZE;
+	for (u32 page = firstPage; page <= lastPage; page++)
+		lockedPages[page] = locked;
+
+	for (u32 area : RAM_AREAS)
+		for (u32 mirror = area; mirror < area + 0x04000000; mirror += RAM_SIZE)
+			if (locked)
+				virtmem::region_lock(spaceBases[1] + mirror + addr, size);
+			else
+				virtmem::region_unlock(spaceBases[1] + mirror + addr, size);
+
+	for (int i = 0; i < 2; i++)
+	{
+		AddressSpace& space = spaces[i];
+		for (const MappedPage& page : space.mappedPages)
+		{
+			if (page.ramPage < firstPage || page.ramPage > lastPage)
+				continue;
+			u8 *hostAddr = spaceBases[i] + (size_t)page.vpn * SHADOW_PAGE_SIZE;
+			if (locked && space.pageState[page.vpn] == ReadWrite)
+			{
+				virtmem::region_lock(hostAddr, SHADOW_PAGE_SIZE);
+				space.pageState[page.vpn] = ReadOnly;
+			}
+			else if (!locked && page.writable && space.pageState[page.vpn] == ReadOnly)
+			{
+				virtmem::region_unlock(hostAddr, SHADOW_PAGE_SIZE);
+				space.pageState[page.vpn] = ReadWrite;
+			}
+		}
+	}
+}
+
+void lockPage(u32 addr, u32 size)
+{
+	if (active)
+		protectRam(addr, size, true);
+}
+
+void unlockPage(u32 addr, u32 size)
+{
+	if (active)
+		protectRam(addr, size, false);
+}
+
+} // namespace shadowmmu
+
+#endif
@@ -0,0 +1,83 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+#include "mmu.h"
+
+// Experimental: the guest virtual address space is mirrored in a reserved host address space
+// so that the dynarec can access translated memory directly when the MMU is enabled.
+// There is one address space for user mode and one for privileged mode: P1-P4 and privileged pages
+// are only accessible in the latter.
+// System RAM pages are mapped on demand by the dynarec fault handler, read-only unless the TLB entry
+// allows writes and the page holds no compiled code. They're unmapped when the TLB or the current ASID change.
+namespace shadowmmu
+{
+#if defined(FAST_MMU) && HOST_CPU == CPU_X64 && FEAT_SHREC == DYNAREC_JIT
+
+// address space of the current processor mode
+extern u8 *base;
+extern u8 *spaceBases[2];
+extern bool active;
+
+void init();
+void reset();
+void term();
+
+enum class MapResult {
+	Mapped,		// the access can be retried
+	Fault,		// the access raises an exception or must go through the slow path this time
+	NotRam		// the access must always go through the slow path
+};
+MapResult mapPage(u32 vaddr, bool write);
+// Translates a virtual address with the access rights of the current processor mode
+MmuError translate(u32 vaddr, bool write, u32& paddr);
+void invalidate(const TLB_Entry& entry);
+void switchAsid();
+void flush();
+// Write-protects system RAM pages holding compiled code
+void lockPage(u32 addr, u32 size);
+void unlockPage(u32 addr, u32 size);
+
+// Called when SR.MD changes
+static inline void setPrivileged(bool privileged) {
+	base = spaceBases[privileged];
+}
+
+#else
+
+constexpr u8 *base = nullptr;
+constexpr bool active = false;
+
+static inline void init() {}
+static inline void reset() {}
+static inline void term() {}
+static inline void invalidate(const TLB_Entry& entry) {}
+static inline void switchAsid() {}
+static inline void flush() {}
+static inline void lockPage(u32 addr, u32 size) {}
+static inline void unlockPage(u32 addr, u32 size) {}
+static inline void setPrivileged(bool privileged) {}
+
+#endif
+
+static inline bool enabled() {
+	return active && mmu_enabled();
+}
+
+} // namespace shadowmmu
@@ -5,6 +5,7 @@
 #include "types.h"
 #include "sh4_core.h"
 #include "sh4_interrupts.h"
+#include "modules/shadowmmu.h"
 #if defined(__ANDROID__) && HOST_CPU == CPU_ARM
 #include <fenv.h>
 #endif
@@ -31,6 +32,7 @@ bool UpdateSR()
 			ChangeGPR();//switch
 	}
 
+	shadowmmu::setPrivileged(Sh4cntx.sr.MD);
 	Sh4cntx.old_sr.status = Sh4cntx.sr.status;
 	Sh4cntx.old_sr.RB &= Sh4cntx.sr.MD;
 
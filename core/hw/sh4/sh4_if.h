@@ -122,6 +122,8 @@ struct alignas(32) SQBuffer {
 void setSqwHandler();
 struct Sh4Context;
 typedef void DYNACALL SQWriteFunc(u32 dst, Sh4Context *ctx);
+// Store queue handler selected when QACR0 targets the TA and the MMU is off
+void DYNACALL sqWriteTA(u32 dst, Sh4Context *ctx);
 
 struct alignas(64) Sh4Context
 {
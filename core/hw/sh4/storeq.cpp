@@ -18,6 +18,7 @@
 #include "sh4_mem.h"
 #include "modules/mmu.h"
 #include "hw/pvr/pvr_mem.h"
+#include "hw/pvr/ta.h"
 
 static u32 CCN_QACR_TR[2];
 
@@ -66,9 +67,13 @@ static void DYNACALL sqWrite_nommu_area_3_nonvmem(u32 dest, Sh4Context *ctx)
 	memcpy((SQBuffer *)&pmem[dest & (RAM_MASK - 0x1F)], &ctx->sq_buffer[(dest >> 5) & 1], sizeof(SQBuffer));
 }
 
-static void DYNACALL sqWriteTA(u32 dest, Sh4Context *ctx)
+void DYNACALL sqWriteTA(u32 dest, Sh4Context *ctx)
 {
-	TAWriteSQ(dest, ctx->sq_buffer);
+	if (likely((dest & 0x01800000) == 0))
+		// TA polygon path
+		ta_vtx_data32(&ctx->sq_buffer[(dest >> 5) & 1]);
+	else
+		TAWriteSQ(dest, ctx->sq_buffer);
 }
 
 void setSqwHandler()
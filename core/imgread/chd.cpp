@@ -1,8 +1,20 @@
 #include "common.h"
 #include "stdclass.h"
 #include "oslib/storage.h"
+#include "cfg/option.h"
+#include "util/worker_thread.h"
 
 #include <libchdr/chd.h>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <future>
+
+struct CHDTrack;
 
 struct CHDDisc : Disc
 {
@@ -10,26 +22,87 @@ struct CHDDisc : Disc
 	static constexpr u32 CD_TRACK_PADDING = 4;
 	// lead out, lead in and pregap between 2 sessions of MIL-CDs
 	static constexpr u32 SESSION_GAP = 11400;
+	// max number of chd handles used to decompress hunks concurrently
+	static constexpr u32 MAX_DECODERS = 4;
+	// number of hunks decompressed ahead of a sequential stream
+	static constexpr u32 READ_AHEAD_HUNKS = 4;
 
 	chd_file *chd = nullptr;
 	FILE *fp = nullptr;
-	u8* hunk_mem = nullptr;
-	u32 old_hunk = 0;
 
 	u32 hunkbytes = 0;
+	u32 totalhunks = 0;
 	u32 sph = 0;
 
+	struct Stats
+	{
+		std::atomic<u64> hits { 0 };
+		std::atomic<u64> misses { 0 };
+		std::atomic<u64> readAhead { 0 };
+		std::atomic<u64> decompressed { 0 };
+		std::atomic<u64> decompressTimeUs { 0 };
+	} stats;
+
 	void tryOpen(const char* file);
+	bool readHunk(u32 hunk, u32 offset, u8 *dst, u32 size, u32& lastHunk, u32& sequentialCount);
+	u32 prefetch(u32 FAD, u32 count) override;
 
 	~CHDDisc() override
 	{
-		delete[] hunk_mem;
-
+		readAheadThread.stop();
+		if (stats.hits + stats.misses != 0)
+			INFO_LOG(GDROM, "chd: hunk cache hits %d%% (%" PRIu64 " hits, %" PRIu64 " misses), %" PRIu64 " read ahead, %" PRIu64 " hunks decompressed in %" PRIu64 " ms",
+					(int)(stats.hits * 100 / (stats.hits + stats.misses)), stats.hits.load(), stats.misses.load(),
+					stats.readAhead.load(), stats.decompressed.load(), stats.decompressTimeUs / 1000);
+		decoders.clear();
 		if (chd)
 			chd_close(chd);
 		if (fp)
 			std::fclose(fp);
 	}
+
+private:
+	// Each decoder has its own chd handle since libchdr handles aren't thread-safe
+	struct Decoder
+	{
+		chd_file *chd = nullptr;
+		FILE *fp = nullptr;
+
+		~Decoder() {
+			if (fp != nullptr)
+			{
+				chd_close(chd);
+				std::fclose(fp);
+			}
+		}
+	};
+	struct CachedHunk
+	{
+		u32 hunk;
+		std::unique_ptr<u8[]> data;
+	};
+
+	Decoder *acquireDecoder();
+	void releaseDecoder(Decoder *decoder);
+	std::unique_ptr<u8[]> decompress(u32 hunk);
+	void insertHunk(u32 hunk, std::unique_ptr<u8[]>&& data);
+	void readAhead(u32 hunk);
+
+	std::vector<std::unique_ptr<Decoder>> decoders;
+	std::vector<Decoder *> freeDecoders;
+	std::mutex decoderMutex;
+	std::condition_variable decoderAvailable;
+
+	// most recently used hunks first
+	std::list<CachedHunk> cache;
+	std::unordered_map<u32, std::list<CachedHunk>::iterator> cacheIndex;
+	// hunks being decompressed by another thread
+	std::unordered_set<u32> inFlight;
+	u32 cacheCapacity = 0;
+	std::mutex cacheMutex;
+	std::condition_variable hunkReady;
+
+	WorkerThread readAheadThread { "CHD read-ahead" };
 };
 
 struct CHDTrack : TrackFile
@@ -38,6 +111,10 @@ struct CHDTrack : TrackFile
 	s32 Offset;
 	u32 fmt;
 	bool swap_bytes;
+	// sequential access detection, per track so that CDDA streaming
+	// doesn't interfere with data reads
+	u32 lastHunk = ~0u;
+	u32 sequentialCount = 0;
 
 	CHDTrack(CHDDisc* disc, s32 Offset, u32 fmt, bool swap_bytes)
 	{
@@ -50,17 +127,11 @@ struct CHDTrack : TrackFile
 	bool Read(u32 FAD, u8* dst, SectorFormat* sector_type, u8* subcode, SubcodeFormat* subcode_type) override
 	{
 		u32 fad_offs = FAD + Offset;
-		u32 hunk=(fad_offs)/disc->sph;
-		if (disc->old_hunk!=hunk)
-		{
-			if (chd_read(disc->chd,hunk,disc->hunk_mem) != CHDERR_NONE)
-				return false;
-			disc->old_hunk = hunk;
-		}
-
-		u32 hunk_ofs = fad_offs%disc->sph;
+		u32 hunk = fad_offs / disc->sph;
+		u32 hunk_ofs = fad_offs % disc->sph;
 
-		memcpy(dst, disc->hunk_mem + hunk_ofs * (2352+96), fmt);
+		if (!disc->readHunk(hunk, hunk_ofs * (2352 + 96), dst, fmt, lastHunk, sequentialCount))
+			return false;
 
 		if (swap_bytes)
 		{
@@ -93,6 +164,190 @@ struct CHDTrack : TrackFile
 	}
 };
 
+CHDDisc::Decoder *CHDDisc::acquireDecoder()
+{
+	std::unique_lock<std::mutex> lock(decoderMutex);
+	decoderAvailable.wait(lock, [this]() { return !freeDecoders.empty(); });
+	Decoder *decoder = freeDecoders.back();
+	freeDecoders.pop_back();
+	return decoder;
+}
+
+void CHDDisc::releaseDecoder(Decoder *decoder)
+{
+	std::lock_guard<std::mutex> _(decoderMutex);
+	freeDecoders.push_back(decoder);
+	decoderAvailable.notify_one();
+}
+
+std::unique_ptr<u8[]> CHDDisc::decompress(u32 hunk)
+{
+	std::unique_ptr<u8[]> data = std::make_unique<u8[]>(hunkbytes);
+	Decoder *decoder = acquireDecoder();
+	auto start = std::chrono::steady_clock::now();
+	chd_error err = chd_read(decoder->chd, hunk, data.get());
+	auto duration = std::chrono::steady_clock::now() - start;
+	releaseDecoder(decoder);
+
+	if (err != CHDERR_NONE)
+	{
+		WARN_LOG(GDROM, "chd: error %d reading hunk %d", err, hunk);
+		return nullptr;
+	}
+	stats.decompressed++;
+	stats.decompressTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+
+	return data;
+}
+
+// cacheMutex must be held
+void CHDDisc::insertHunk(u32 hunk, std::unique_ptr<u8[]>&& data)
+{
+	if (cacheIndex.count(hunk) != 0)
+		return;
+	if (cache.size() >= cacheCapacity)
+	{
+		cacheIndex.erase(cache.back().hunk);
+		cache.pop_back();
+	}
+	cache.push_front({ hunk, std::move(data) });
+	cacheIndex[hunk] = cache.begin();
+}
+
+bool CHDDisc::readHunk(u32 hunk, u32 offset, u8 *dst, u32 size, u32& lastHunk, u32& sequentialCount)
+{
+	std::unique_lock<std::mutex> lock(cacheMutex);
+	hunkReady.wait(lock, [this, hunk]() { return inFlight.count(hunk) == 0; });
+
+	auto it = cacheIndex.find(hunk);
+	if (it != cacheIndex.end())
+	{
+		stats.hits++;
+		cache.splice(cache.begin(), cache, it->second);
+		memcpy(dst, it->second->data.get() + offset, size);
+	}
+	else
+	{
+		stats.misses++;
+		inFlight.insert(hunk);
+		lock.unlock();
+		std::unique_ptr<u8[]> data = decompress(hunk);
+		lock.lock();
+		inFlight.erase(hunk);
+		hunkReady.notify_all();
+		if (data == nullptr)
+			return false;
+		memcpy(dst, data.get() + offset, size);
+		insertHunk(hunk, std::move(data));
+	}
+	lock.unlock();
+
+	if (hunk != lastHunk)
+	{
+		if (hunk == lastHunk + 1)
+			sequentialCount++;
+		else
+			sequentialCount = 0;
+		lastHunk = hunk;
+		if (sequentialCount >= 2 && config::ChdReadAhead)
+			readAhead(hunk);
+	}
+	return true;
+}
+
+void CHDDisc::readAhead(u32 hunk)
+{
+	std::vector<u32> hunks;
+	{
+		std::lock_guard<std::mutex> _(cacheMutex);
+		u32 count = std::min(READ_AHEAD_HUNKS, cacheCapacity / 4);
+		for (u32 h = hunk + 1; h <= hunk + count && h < totalhunks; h++)
+		{
+			if (cacheIndex.count(h) != 0 || inFlight.count(h) != 0)
+				continue;
+			inFlight.insert(h);
+			hunks.push_back(h);
+		}
+	}
+	if (hunks.empty())
+		return;
+	readAheadThread.run([this, hunks]() {
+		for (u32 h : hunks)
+		{
+			std::unique_ptr<u8[]> data = decompress(h);
+			std::lock_guard<std::mutex> _(cacheMutex);
+			inFlight.erase(h);
+			if (data != nullptr)
+			{
+				stats.readAhead++;
+				insertHunk(h, std::move(data));
+			}
+			hunkReady.notify_all();
+		}
+	});
+}
+
+u32 CHDDisc::prefetch(u32 FAD, u32 count)
+{
+	if (decoders.size() < 2)
+		return count;
+	// Don't prefetch more than half the cache so that prefetched hunks aren't evicted before being read
+	u32 maxHunks = cacheCapacity / 2;
+	count = std::min(count, maxHunks * sph);
+
+	std::vector<u32> hunks;
+	{
+		std::lock_guard<std::mutex> _(cacheMutex);
+		for (const Track& track : tracks)
+		{
+			u32 start = std::max(FAD, track.StartFAD);
+			u32 end = std::min(FAD + count - 1, track.EndFAD);
+			if (start > end)
+				continue;
+			const s32 offset = ((CHDTrack *)track.file)->Offset;
+			for (u32 h = (start + offset) / sph; h <= (end + offset) / sph && h < totalhunks; h++)
+			{
+				if (cacheIndex.count(h) != 0 || inFlight.count(h) != 0)
+					continue;
+				inFlight.insert(h);
+				hunks.push_back(h);
+			}
+		}
+	}
+	if (hunks.size() < 2)
+	{
+		// nothing to gain
+		std::lock_guard<std::mutex> _(cacheMutex);
+		for (u32 h : hunks)
+			inFlight.erase(h);
+		hunkReady.notify_all();
+		return count;
+	}
+
+	// Decompress missing hunks in parallel
+	const size_t taskCount = std::min(hunks.size(), decoders.size());
+	std::vector<std::future<void>> tasks;
+	for (size_t i = 0; i < taskCount; i++)
+	{
+		tasks.push_back(std::async(std::launch::async, [this, &hunks, i, taskCount]() {
+			ThreadName _("CHD decompress");
+			for (size_t j = i; j < hunks.size(); j += taskCount)
+			{
+				std::unique_ptr<u8[]> data = decompress(hunks[j]);
+				std::lock_guard<std::mutex> lock(cacheMutex);
+				inFlight.erase(hunks[j]);
+				if (data != nullptr)
+					insertHunk(hunks[j], std::move(data));
+				hunkReady.notify_all();
+			}
+		}));
+	}
+	for (auto& task : tasks)
+		task.wait();
+
+	return count;
+}
+
 static u32 getSectorSize(const std::string& type)
 {
 	if (type == "AUDIO")
@@ -128,14 +383,42 @@ void CHDDisc::tryOpen(const char* file)
 	const chd_header* head = chd_get_header(chd);
 
 	hunkbytes = head->hunkbytes;
-	hunk_mem = new u8[hunkbytes];
-	old_hunk=0xFFFFFFF;
+	totalhunks = head->totalhunks;
 
 	sph = hunkbytes/(2352+96);
 
 	if (hunkbytes % (2352 + 96) != 0)
 		throw FlycastException(std::string("Invalid hunkbytes for CHD file ") + file);
 
+	cacheCapacity = std::max(config::ChdCacheHunks.get(), 4);
+
+	// Open additional handles for concurrent decompression
+	const u32 decoderCount = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_DECODERS);
+	for (u32 i = 0; i < decoderCount; i++)
+	{
+		std::unique_ptr<Decoder> decoder = std::make_unique<Decoder>();
+		decoder->fp = hostfs::storage().openFile(file, "rb");
+		if (decoder->fp == nullptr)
+			break;
+		if (chd_open_file(decoder->fp, CHD_OPEN_READ, 0, &decoder->chd) != CHDERR_NONE)
+		{
+			std::fclose(decoder->fp);
+			decoder->fp = nullptr;
+			break;
+		}
+		freeDecoders.push_back(decoder.get());
+		decoders.push_back(std::move(decoder));
+	}
+	if (decoders.empty())
+	{
+		// fall back to the main handle, which isn't owned by the decoder
+		std::unique_ptr<Decoder> decoder = std::make_unique<Decoder>();
+		decoder->chd = chd;
+		freeDecoders.push_back(decoder.get());
+		decoders.push_back(std::move(decoder));
+	}
+	DEBUG_LOG(GDROM, "chd: %d hunks of %d bytes, cache size %d hunks, %d decoders", totalhunks, hunkbytes, cacheCapacity, (int)decoders.size());
+
 	u32 tag;
 	u8 flags;
 	char temp[512];
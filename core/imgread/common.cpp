@@ -4,6 +4,10 @@
 #include "stdclass.h"
 #include "hw/sh4/sh4_sched.h"
 #include "serialize.h"
+#include "util/worker_thread.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 
 Disc* chd_parse(const char* file, std::vector<u8> *digest);
 Disc* gdi_parse(const char* file, std::vector<u8> *digest);
@@ -28,16 +32,16 @@ constexpr Disc* (*drivers[])(const char* path, std::vector<u8> *digest)
 
 static u8 q_subchannel[96];
 
-static bool convertSector(u8* in_buff , u8* out_buff , int from , int to,int sector)
+static bool convertSector(u8* in_buff , u8* out_buff , int from , int to,int sector, u8 *subcode)
 {
 	//get subchannel data, if any
 	if (from == 2448)
 	{
-		memcpy(q_subchannel, in_buff + 2352, 96);
+		memcpy(subcode, in_buff + 2352, 96);
 		from -= 96;
 	}
 	else
-		memset(q_subchannel, 0, sizeof(q_subchannel));
+		memset(subcode, 0, 96);
 
 	//if no conversion
 	if (to == from)
@@ -96,6 +100,160 @@ Disc* OpenDisc(const std::string& path, std::vector<u8> *digest)
 	throw FlycastException("Unknown disk format");
 }
 
+//
+// Reads sectors asynchronously ahead of the emulated drive.
+// Disc reads are serialized by a lock. Reads requested by the drive are done on the calling thread
+// and go ahead of queued prefetches, so a miss only waits for the prefetch read in progress, if any.
+//
+class SectorPrefetcher
+{
+public:
+	void prefetch(u32 fad, u32 count, u32 sectorSize)
+	{
+		if (count == 0 || disc == nullptr)
+			return;
+		for (const auto& req : requests)
+			if (req->sectorSize == sectorSize && fad >= req->fad && fad < req->fad + req->count)
+				// already requested
+				return;
+		if (requests.size() >= MAX_REQUESTS)
+		{
+			cancel(requests.front());
+			requests.pop_front();
+		}
+
+		auto req = std::make_shared<Request>();
+		req->fad = fad;
+		req->count = count;
+		req->sectorSize = sectorSize;
+		req->data.resize(count * sectorSize);
+		req->subcode.resize(count * 96);
+		req->done = ioThread.runFuture([this, req]() {
+			if (!lockDisc(req.get()))
+				return;
+			if (disc != nullptr)
+				req->result = disc->ReadSectors(req->fad, req->count, req->data.data(), req->sectorSize, true, nullptr, req->subcode.data());
+			unlockDisc();
+		});
+		requests.push_back(req);
+	}
+
+	u32 read(u8 *dst, u32 fad, u32 count, u32 sectorSize, bool stopOnMiss)
+	{
+		for (auto it = requests.begin(); it != requests.end(); ++it)
+		{
+			std::shared_ptr<Request> req = *it;
+			if (req->sectorSize != sectorSize || fad < req->fad || fad >= req->fad + req->count)
+				continue;
+			if (cancel(req))
+			{
+				// still queued: don't wait for the prefetches ahead of it
+				requests.erase(it);
+				break;
+			}
+			req->done.wait();
+			const u32 offset = fad - req->fad;
+			const u32 available = req->result > offset ? std::min(req->result - offset, count) : 0;
+			if (available < count && !stopOnMiss)
+				// partial read: do a regular read instead
+				break;
+			if (available > 0)
+			{
+				memcpy(dst, &req->data[offset * sectorSize], available * sectorSize);
+				memcpy(q_subchannel, &req->subcode[(offset + available - 1) * 96], sizeof(q_subchannel));
+			}
+			if (offset + count >= req->count)
+				requests.erase(it);
+			hits++;
+			return available;
+		}
+		misses++;
+		lockDisc(nullptr);
+		u32 rv = disc->ReadSectors(fad, count, dst, sectorSize, stopOnMiss);
+		unlockDisc();
+		return rv;
+	}
+
+	// Cancel queued reads, wait for the one in progress and discard all prefetched data
+	void flush()
+	{
+		for (const auto& req : requests)
+			cancel(req);
+		requests.clear();
+		ioThread.runFuture([]() {}).wait();
+		if (hits + misses != 0)
+			DEBUG_LOG(GDROM, "Sector prefetch: %d hits %d misses", hits, misses);
+		hits = misses = 0;
+	}
+
+private:
+	static constexpr size_t MAX_REQUESTS = 4;
+
+	struct Request
+	{
+		u32 fad;
+		u32 count;
+		u32 sectorSize;
+		u32 result = 0;
+		bool started = false;
+		bool cancelled = false;
+		std::vector<u8> data;
+		std::vector<u8> subcode;
+		std::future<void> done;
+	};
+
+	// Returns true if the request hadn't started yet. It won't read the disc.
+	bool cancel(const std::shared_ptr<Request>& req)
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		if (req->started)
+			return false;
+		req->cancelled = true;
+		return true;
+	}
+
+	// Waits until the disc is free. Prefetches also wait for pending drive reads.
+	// Returns false if the prefetch request was cancelled.
+	bool lockDisc(Request *req)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (req == nullptr)
+		{
+			driveReads++;
+			cond.wait(lock, [this]() { return !reading; });
+			driveReads--;
+		}
+		else
+		{
+			cond.wait(lock, [this]() { return !reading && driveReads == 0; });
+			if (req->cancelled)
+				return false;
+			req->started = true;
+		}
+		reading = true;
+		return true;
+	}
+
+	void unlockDisc()
+	{
+		{
+			std::lock_guard<std::mutex> _(mutex);
+			reading = false;
+		}
+		cond.notify_all();
+	}
+
+	std::deque<std::shared_ptr<Request>> requests;
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool reading = false;
+	int driveReads = 0;
+	WorkerThread ioThread { "GD-ROM I/O" };
+	int hits = 0;
+	int misses = 0;
+};
+static SectorPrefetcher prefetcher;
+
 namespace gdr {
 
 static bool loadDisk(const std::string& path)
@@ -171,6 +329,7 @@ static bool doDiscSwap(const std::string& path)
 void termDrive()
 {
 	sh4_sched_request(schedId, -1);
+	prefetcher.flush();
 	delete disc;
 	disc = nullptr;
 }
@@ -208,13 +367,24 @@ static u32 createTrackInfoFirstLast(const Track& track, u32 tracknum)
 u32 libGDR_ReadSector(u8 *buff, u32 startSector, u32 sectorCount, u32 sectorSize, bool stopOnMiss)
 {
 	if (disc != nullptr)
-		return disc->ReadSectors(startSector, sectorCount, buff, sectorSize, stopOnMiss);
+	{
+		if (config::GDRomPrefetch)
+			return prefetcher.read(buff, startSector, sectorCount, sectorSize, stopOnMiss);
+		else
+			return disc->ReadSectors(startSector, sectorCount, buff, sectorSize, stopOnMiss);
+	}
 	if (stopOnMiss)
 		return 0;
 	memset(buff, 0, sectorCount * sectorSize);
 	return sectorCount;
 }
 
+void libGDR_Prefetch(u32 startSector, u32 sectorCount, u32 sectorSize)
+{
+	if (config::GDRomPrefetch)
+		prefetcher.prefetch(startSector, sectorCount, sectorSize);
+}
+
 void libGDR_GetToc(u32* to, DiskArea area)
 {
 	memset(to, 0xFF, 102 * 4);
@@ -280,14 +450,17 @@ bool Disc::readSector(u32 FAD, u8 *dst, SectorFormat *sector_type, u8 *subcode,
 	return false;
 }
 
-u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, LoadProgress *progress)
+u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, LoadProgress *progress, u8 *subcode)
 {
 	u8 temp[2448];
 	SectorFormat secfmt;
 	SubcodeFormat subfmt;
+	u32 prefetched = 0;
 
 	for (u32 i = 0; i < count; i++)
 	{
+		if (i == prefetched)
+			prefetched = i + std::max(prefetch(FAD, count - i), 1u);
 		if (progress != nullptr)
 		{
 			if (progress->cancelled)
@@ -295,7 +468,13 @@ u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, Loa
 			progress->label = "Loading...";
 			progress->progress = (float)i / count;
 		}
-		if (!readSector(FAD, temp, &secfmt, q_subchannel, &subfmt))
+		u8 *subchannel = q_subchannel;
+		if (subcode != nullptr)
+		{
+			subchannel = subcode + i * 96;
+			memset(subchannel, 0, 96);
+		}
+		if (!readSector(FAD, temp, &secfmt, subchannel, &subfmt))
 		{
 			WARN_LOG(GDROM, "Sector Read miss FAD: %d", FAD);
 			if (stopOnMiss)
@@ -306,7 +485,7 @@ u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, Loa
 
 		//TODO: Proper sector conversions
 		if (secfmt == SECFMT_2352) {
-			convertSector(temp, dst, 2352, fmt, FAD);
+			convertSector(temp, dst, 2352, fmt, FAD, subchannel);
 		}
 		else if (fmt == 2048 && secfmt == SECFMT_2336_MODE2) {
 			memcpy(dst, temp + 8, 2048);
@@ -320,7 +499,7 @@ u32 Disc::ReadSectors(u32 FAD, u32 count, u8* dst, u32 fmt, bool stopOnMiss, Loa
 		}
 		else if (fmt == 2048 && secfmt == SECFMT_2448_MODE2) {
 			// Pier Solar and the Great Architects
-			convertSector(temp, dst, 2448, fmt, FAD);
+			convertSector(temp, dst, 2448, fmt, FAD, subchannel);
 		}
 		else {
 			WARN_LOG(GDROM, "ERROR: UNABLE TO CONVERT SECTOR. THIS IS FATAL. Format: %d Sector format: %d", fmt, secfmt);
@@ -398,6 +577,7 @@ void libGDR_serialize(Serializer& ser)
 }
 void libGDR_deserialize(Deserializer& deser)
 {
+	prefetcher.flush();
 	deser >> NullDriveDiscType;
 	deser >> q_subchannel;
 	if (deser.version() >= Deserializer::V46)
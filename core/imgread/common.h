@@ -118,7 +118,15 @@ struct Disc
 	DiscType type;
 	std::string catalog;
 
-	u32 ReadSectors(u32 FAD, u32 count, u8 *dst, u32 fmt, bool stopOnMiss = false, LoadProgress *progress = nullptr);
+	// subcode: if not null, receives the subchannel data of each sector read (count * 96 bytes)
+	// instead of updating the drive subchannel
+	u32 ReadSectors(u32 FAD, u32 count, u8 *dst, u32 fmt, bool stopOnMiss = false, LoadProgress *progress = nullptr, u8 *subcode = nullptr);
+
+	// Hint that sectors [FAD, FAD + count) are about to be read.
+	// Returns the number of sectors covered by the hint.
+	virtual u32 prefetch(u32 FAD, u32 count) {
+		return count;
+	}
 
 	virtual ~Disc() 
 	{
@@ -262,6 +270,8 @@ DiscType GuessDiscType(bool m1, bool m2, bool da);
 
 //IO
 u32 libGDR_ReadSector(u8 * buff, u32 StartSector, u32 SectorCount, u32 secsz, bool stopOnMiss = false);
+// Start reading sectors in the background so that a following libGDR_ReadSector doesn't block
+void libGDR_Prefetch(u32 StartSector, u32 SectorCount, u32 secsz);
 void libGDR_ReadSubChannel(u8 * buff, u32 len);
 void libGDR_GetToc(u32 *toc, DiskArea area);
 u32 libGDR_GetDiscType();
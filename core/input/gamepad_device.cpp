@@ -24,6 +24,7 @@
 #include "emulator.h"
 #include "hw/maple/maple_devs.h"
 #include "mouse.h"
+#include "hw/pvr/ta_capture.h"
 
 #include <algorithm>
 #include <mutex>
@@ -106,6 +107,10 @@ bool GamepadDevice::handleButtonInput(int port, DreamcastKey key, bool pressed)
 			if (pressed)
 				gui_takeScreenshot();
 			break;
+		case EMU_BTN_CAPTURE_FRAME:
+			if (pressed)
+				tacapture::request();
+			break;
 		case DC_AXIS_LT:
 			if (port >= 0)
 				lt[port] = pressed ? 0xffff : 0;
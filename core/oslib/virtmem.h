@@ -50,6 +50,15 @@ void release_jit_block(void *code_area, size_t size);
 // Release a jit block previously allocated by prepare_jit_block (with dual RW and RX areas)
 void release_jit_block(void *code_area1, void *code_area2, size_t size);
 
+// Reserves an inaccessible address range where parts of the memory file can be mapped.
+// Returns nullptr if not supported.
+void *reserve_shadow(size_t size);
+void release_shadow(void *base, size_t size);
+// Maps part of the memory file at the given address of a shadow range.
+bool map_shadow(void *dest, size_t size, size_t memoffset, bool allow_writes);
+// Makes part of a shadow range inaccessible again.
+void unmap_shadow(void *dest, size_t size);
+
 bool region_lock(void *start, std::size_t len);
 bool region_unlock(void *start, std::size_t len);
 bool region_set_exec(void *start, std::size_t len);
@@ -138,12 +138,36 @@ struct dc_profiler_cfg
 			}
 		} blkrun;
 
+		struct
+		{
+			u32 tlb_lru_hit;
+			u32 tlb_hit;
+			u32 tlb_miss;
+			u32 lut_fill;
+			u32 asid_switch;
+			u32 asid_restore;
+			u32 full_flush;
+
+			void print()
+			{
+				print_head("mmu");
+				print_elem("tlb_lru_hit",tlb_lru_hit);
+				print_elem("tlb_hit",tlb_hit);
+				print_elem("tlb_miss",tlb_miss);
+				print_elem("lut_fill",lut_fill);
+				print_elem("asid_switch",asid_switch);
+				print_elem("asid_restore",asid_restore);
+				print_elem("full_flush",full_flush);
+			}
+		} mmu;
+
 		void print()
 		{
 			shil.print();
 			ralloc.print();
 			bm.print();
 			blkrun.print();
+			mmu.print();
 		}
 	} counters;
 };
@@ -1,116 +1,339 @@
 #include "fc_profiler.h"
 #include "log/LogManager.h"
 #include "cfg/option.h"
+#include "stdclass.h"
+#include "util/periodic_thread.h"
 #include "imgui.h"
 #include "implot.h"
+#include <nowide/cstdio.hpp>
 #include <cassert>
+#include <cinttypes>
+#include <map>
+#include <thread>
 
 namespace fc_profiler
 {
-	thread_local ProfileThread* ProfileScope::s_thread = nullptr;
 	std::vector<ProfileThread*> ProfileThread::s_allThreads;
-	std::recursive_mutex ProfileThread::s_allThreadsLock;
+	std::mutex ProfileThread::s_allThreadsLock;
 
-	void startThread(const std::string& threadName)
+	static thread_local std::string s_threadName = "flycast";
+
+	// Marks the thread buffer as exited when the thread terminates so that it can be freed
+	struct ThreadHolder
+	{
+		~ThreadHolder() {
+			if (thread != nullptr)
+				thread->exited = true;
+		}
+		ProfileThread *thread = nullptr;
+	};
+	static thread_local ThreadHolder s_thread;
+	static u32 nextThreadId;
+
+	static u64 baseTicks;
+	static std::chrono::steady_clock::time_point baseTime;
+	static std::atomic<double> s_tickPeriod;
+
+	static void calibrate()
 	{
-		if (config::ProfilerEnabled)
+#if HOST_CPU == CPU_ARM64 && !defined(_MSC_VER)
+		u64 freq;
+		asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+		s_tickPeriod = 1.0 / freq;
+		baseTicks = now();
+#elif HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64
+		baseTicks = now();
+		baseTime = std::chrono::steady_clock::now();
+		// Initial estimate, refined later
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - baseTime).count();
+		s_tickPeriod = elapsed / (now() - baseTicks);
+#else
+		s_tickPeriod = (double)std::chrono::steady_clock::period::num / std::chrono::steady_clock::period::den;
+		baseTicks = now();
+#endif
+	}
+
+	double tickPeriod()
+	{
+#if HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64
+		// Refine the TSC period over a longer interval
+		static std::atomic<u64> lastUpdate;
+		u64 ticks = now();
+		if (ticks - lastUpdate > 1.0 / s_tickPeriod)
 		{
-			if (!ProfileScope::s_thread)
+			lastUpdate = ticks;
+			double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - baseTime).count();
+			s_tickPeriod = elapsed / (ticks - baseTicks);
+		}
+#endif
+		return s_tickPeriod;
+	}
+
+	ProfileThread::ProfileThread(const char *name, u32 id)
+		: id(id), threadName(name)
+	{
+	}
+
+	// Must be called with s_allThreadsLock held, by the trace writer or when it isn't running
+	static void freeExitedThreads()
+	{
+		auto& threads = ProfileThread::s_allThreads;
+		for (auto it = threads.begin(); it != threads.end(); )
+		{
+			ProfileThread *thread = *it;
+			if (thread->exited && (thread->head == thread->tail || !config::ProfilerEnabled || !config::ProfilerTrace))
 			{
-				std::unique_lock<std::recursive_mutex> lock(ProfileThread::s_allThreadsLock);
-				ProfileScope::s_thread = new ProfileThread();
-				ProfileThread::s_allThreads.push_back(ProfileScope::s_thread);
+				delete thread;
+				it = threads.erase(it);
+			}
+			else {
+				++it;
 			}
-
-			ProfileThread& profileThread = *ProfileScope::s_thread;
-			profileThread.scopes.clear();
-			profileThread.scopes.reserve(FC_PROFILE_SCOPE_RESERVE_SIZE);
-			profileThread.level = 0;
-			profileThread.startTicks = std::chrono::high_resolution_clock::now();
-			profileThread.threadName = threadName;
 		}
 	}
 
-	void endThread(double warningTime)
+	ProfileThread *currentThread()
+	{
+		if (!config::ProfilerEnabled)
+			return nullptr;
+		if (s_thread.thread != nullptr)
+			return s_thread.thread;
+
+		std::lock_guard<std::mutex> lock(ProfileThread::s_allThreadsLock);
+		if (nextThreadId == 0)
+			calibrate();
+		s_thread.thread = new ProfileThread(s_threadName.c_str(), ++nextThreadId);
+		ProfileThread::s_allThreads.push_back(s_thread.thread);
+
+		return s_thread.thread;
+	}
+
+	void setThreadName(const char *name)
 	{
-		if (config::ProfilerEnabled)
+		s_threadName = name;
+		if (s_thread.thread != nullptr)
 		{
-			std::unique_lock<std::recursive_mutex> lock(ProfileThread::s_allThreadsLock);
+			std::lock_guard<std::mutex> lock(ProfileThread::s_allThreadsLock);
+			s_thread.thread->threadName = name;
+		}
+	}
 
-			if (!ProfileScope::s_thread)
-				return;
-			ProfileThread& profileThread = *ProfileScope::s_thread;
+	static double toMicros(u64 ticks) {
+		return (double)(s64)(ticks - baseTicks) * tickPeriod() * 1000000.0;
+	}
 
-			std::chrono::high_resolution_clock::time_point endTicks = std::chrono::high_resolution_clock::now();
-			std::chrono::microseconds durationMicro = std::chrono::duration_cast<std::chrono::microseconds>(endTicks - profileThread.startTicks);
-			profileThread.cachedTime = (double)durationMicro.count() / 1000000;
+	// Streams the events of all threads to a Chrome/Perfetto trace file
+	class TraceWriter : public VPeriodicThread
+	{
+	public:
+		TraceWriter() : VPeriodicThread("ProfilerTrace", 100) {}
+		~TraceWriter() override {
+			stop();
+		}
 
-			if (profileThread.scopes.size() > 0)
+	protected:
+		void init() override
+		{
+			std::string path = get_writable_data_path("flycast_trace.json");
+			file = nowide::fopen(path.c_str(), "w");
+			if (file == nullptr) {
+				WARN_LOG(PROFILER, "Can't create trace file %s", path.c_str());
+				return;
+			}
+			INFO_LOG(PROFILER, "Writing trace to %s", path.c_str());
+			// JSON array format. The closing bracket is optional.
+			fputs("[\n", file);
+			std::lock_guard<std::mutex> lock(ProfileThread::s_allThreadsLock);
+			// discard events recorded before the trace started
+			for (ProfileThread *thread : ProfileThread::s_allThreads)
+				thread->tail.store(thread->head.load(std::memory_order_acquire), std::memory_order_release);
+			threadNames.clear();
+		}
+
+		void doWork() override
+		{
+			if (file == nullptr)
+				return;
+			// Threads are only freed by this thread so they can be accessed without holding the lock
+			std::vector<std::pair<ProfileThread *, std::string>> threads;
 			{
-				profileThread.cachedResultTree.clear();
-				profileThread.cachedResultTree.resize(1);
-				ProfileThread::ResultNode* node = &profileThread.cachedResultTree.back();
-				ProfileThread::ResultNode* parent = node;
+				std::lock_guard<std::mutex> lock(ProfileThread::s_allThreadsLock);
+				for (ProfileThread *thread : ProfileThread::s_allThreads)
+					threads.emplace_back(thread, thread->threadName);
+			}
+			for (const auto& [thread, name] : threads)
+				writeEvents(*thread, name);
+			fflush(file);
 
-				u32 currScope = 0;
+			std::lock_guard<std::mutex> lock(ProfileThread::s_allThreadsLock);
+			freeExitedThreads();
+		}
 
-				for (const ProfileSection& section : profileThread.scopes)
+		void term() override
+		{
+			doWork();
+			if (file != nullptr)
+				fclose(file);
+			file = nullptr;
+		}
+
+	private:
+		void writeEvents(ProfileThread& thread, const std::string& name)
+		{
+			auto it = threadNames.find(thread.id);
+			if (it == threadNames.end() || it->second != name)
+			{
+				fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+						thread.id, escape(name.c_str()).c_str());
+				threadNames[thread.id] = name;
+			}
+			const u32 head = thread.head.load(std::memory_order_acquire);
+			u32 tail = thread.tail.load(std::memory_order_relaxed);
+			for (; tail != head; tail++)
+			{
+				const Event& event = thread.events[tail & (FC_PROFILE_EVENT_BUFFER_SIZE - 1)];
+				const double ts = toMicros(event.ticks);
+				switch (event.type)
 				{
-					if (section.scope == currScope)
-					{
-						parent->children.push_back(ProfileThread::ResultNode());
-						node = &parent->children.back();
-						node->parent = parent;
-					}
-					else if (section.scope > currScope)
-					{
-						assert(node);
-						node->children.push_back(ProfileThread::ResultNode());
-						parent = node;
-						node = &node->children.back();
-						node->parent = parent;
-					}
-					else if (section.scope < currScope)
-					{
-						assert(parent);
-						parent->children.push_back(ProfileThread::ResultNode());
-						node = &parent->children.back();
-						parent = node->parent;
-						if (!parent)
-							parent = node;
-					}
-
-					currScope = section.scope;
-					node->section = section;
+				case EventType::Begin:
+					fprintf(file, "{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"file\":\"%s\",\"line\":%d}},\n",
+							escape(event.name).c_str(), ts, thread.id, escape(event.file).c_str(), (int)event.value);
+					break;
+				case EventType::End:
+					fprintf(file, "{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%d},\n", ts, thread.id);
+					break;
+				case EventType::Counter:
+					fprintf(file, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%" PRId64 "}},\n",
+							escape(event.name).c_str(), ts, thread.id, (int64_t)event.value);
+					break;
+				case EventType::Instant:
+					fprintf(file, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d},\n",
+							escape(event.name).c_str(), ts, thread.id);
+					break;
 				}
 			}
+			thread.tail.store(tail, std::memory_order_release);
+			u32 dropped = thread.dropped.exchange(0);
+			if (dropped != 0)
+				fprintf(file, "{\"name\":\"dropped events\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%d}},\n",
+						toMicros(now()), thread.id, dropped);
+		}
 
-			if (config::ProfilerOutputTTY && warningTime > 0.0f && profileThread.cachedTime > warningTime)
+		static std::string escape(const char *s)
+		{
+			std::string out;
+			if (s == nullptr)
+				return out;
+			for (; *s != '\0'; s++)
 			{
-				WARN_LOG(PROFILER, "=== Profiler =======================================================================================");
-				WARN_LOG(PROFILER, "Frame profile on thread \'%s\' exceeded warning time (duration = %.4fs, limit = %.4fs)", profileThread.threadName.c_str(), profileThread.cachedTime, warningTime);
-				WARN_LOG(PROFILER, "====================================================================================================");
+				if (*s == '"' || *s == '\\')
+					out += '\\';
+				out += *s;
+			}
+			return out;
+		}
 
-				outputTTY(profileThread.cachedResultTree);
+		FILE *file = nullptr;
+		std::map<u32, std::string> threadNames;
+	};
+	static TraceWriter traceWriter;
 
-				WARN_LOG(PROFILER, "====================================================================================================\n");
+	void startThread(const std::string& threadName)
+	{
+		if (config::ProfilerEnabled && config::ProfilerTrace)
+		{
+			traceWriter.start();
+		}
+		else
+		{
+			traceWriter.stop();
+			std::lock_guard<std::mutex> lock(ProfileThread::s_allThreadsLock);
+			freeExitedThreads();
+		}
+
+		ProfileThread *thread = currentThread();
+		if (thread == nullptr)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(ProfileThread::s_allThreadsLock);
+			thread->threadName = threadName;
+		}
+		const u32 head = thread->head.load(std::memory_order_relaxed);
+		if (!config::ProfilerTrace)
+			// nobody else reads the events
+			thread->tail.store(head, std::memory_order_release);
+		thread->frameStart = head;
+		thread->level = 0;
+		thread->startTicks = now();
+	}
+
+	void endThread(double warningTime)
+	{
+		ProfileThread *thread = currentThread();
+		if (thread == nullptr)
+			return;
+		std::lock_guard<std::mutex> lock(ProfileThread::s_allThreadsLock);
+		ProfileThread& profileThread = *thread;
+
+		const u64 endTicks = now();
+		profileThread.cachedTime = (endTicks - profileThread.startTicks) * tickPeriod();
+
+		const u32 head = profileThread.head.load(std::memory_order_relaxed);
+		profileThread.cachedResultTree.clear();
+		if (head != profileThread.frameStart && head - profileThread.frameStart <= FC_PROFILE_EVENT_BUFFER_SIZE)
+		{
+			profileThread.cachedResultTree.resize(1);
+			ProfileThread::ResultNode* parent = &profileThread.cachedResultTree.back();
+			u32 scope = 0;
+
+			for (u32 i = profileThread.frameStart; i != head; i++)
+			{
+				const Event& event = profileThread.events[i & (FC_PROFILE_EVENT_BUFFER_SIZE - 1)];
+				if (event.type == EventType::Begin)
+				{
+					parent->children.emplace_back();
+					ProfileThread::ResultNode* node = &parent->children.back();
+					node->parent = parent;
+					node->section.function = event.name;
+					node->section.file = event.file;
+					node->section.line = (u32)event.value;
+					node->section.scope = scope++;
+					node->section.start = event.ticks;
+					node->section.end = endTicks;
+					parent = node;
+				}
+				else if (event.type == EventType::End && parent->parent != nullptr)
+				{
+					parent->section.end = event.ticks;
+					parent = parent->parent;
+					scope--;
+				}
 			}
+		}
+
+		if (config::ProfilerOutputTTY && warningTime > 0.0f && profileThread.cachedTime > warningTime)
+		{
+			WARN_LOG(PROFILER, "=== Profiler =======================================================================================");
+			WARN_LOG(PROFILER, "Frame profile on thread \'%s\' exceeded warning time (duration = %.4fs, limit = %.4fs)", profileThread.threadName.c_str(), profileThread.cachedTime, warningTime);
+			WARN_LOG(PROFILER, "====================================================================================================");
 
-			profileThread.history[profileThread.historyIdx] = profileThread.cachedTime;
-			profileThread.historyIdx = (profileThread.historyIdx + 1) % FC_PROFILE_HISTORY_MAX_SIZE;
+			outputTTY(profileThread.cachedResultTree);
+
+			WARN_LOG(PROFILER, "====================================================================================================\n");
 		}
+
+		profileThread.history[profileThread.historyIdx] = profileThread.cachedTime;
+		profileThread.historyIdx = (profileThread.historyIdx + 1) % FC_PROFILE_HISTORY_MAX_SIZE;
 	}
 
 	void drawGUI(const std::vector<ProfileThread::ResultNode>& results)
 	{
-		std::unique_lock<std::recursive_mutex> lock(ProfileThread::s_allThreadsLock);
-
 		for (const ProfileThread::ResultNode& node : results)
 		{
 			if (node.section.function)
 			{
-				std::chrono::microseconds scopeTimeMicro = std::chrono::duration_cast<std::chrono::microseconds>(node.section.end - node.section.start);
-				double scopeTimeS = (double)scopeTimeMicro.count() / 1000000;
+				double scopeTimeS = (node.section.end - node.section.start) * tickPeriod();
 				char text[256];
 				std::snprintf(text, 256, "%.3f : %s (%s, %i)", (float)scopeTimeS, node.section.function, node.section.file, node.section.line);
 				ImGui::TreeNode(text);
@@ -124,13 +347,13 @@ namespace fc_profiler
 
 	void outputTTY(const std::vector<ProfileThread::ResultNode>& results)
 	{
-		std::unique_lock<std::recursive_mutex> lock(ProfileThread::s_allThreadsLock);
-
 		for (const ProfileThread::ResultNode& node : results)
 		{
-			std::chrono::microseconds scopeTimeMicro = std::chrono::duration_cast<std::chrono::microseconds>(node.section.end - node.section.start);
-			double scopeTimeS = (double)scopeTimeMicro.count() / 1000000;
-			WARN_LOG(PROFILER, "%.4f %*s%s (%s, %i)", scopeTimeS, node.section.scope, "", node.section.function, node.section.file, node.section.line);
+			if (node.section.function)
+			{
+				double scopeTimeS = (node.section.end - node.section.start) * tickPeriod();
+				WARN_LOG(PROFILER, "%.4f %*s%s (%s, %i)", scopeTimeS, node.section.scope, "", node.section.function, node.section.file, node.section.line);
+			}
 			outputTTY(node.children);
 		}
 	}
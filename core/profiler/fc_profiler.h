@@ -3,11 +3,18 @@
 #if FC_PROFILER
 
 #include "types.h"
+#include <atomic>
 #include <vector>
 #include <string>
-#include <chrono>
-#include <thread>
 #include <mutex>
+#include <chrono>
+#if HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
 
 #ifndef __PRETTY_FUNCTION__
 #ifdef _MSC_VER
@@ -17,102 +24,152 @@
 #endif
 #endif
 
-#define FC_PROFILE_SCOPE_RESERVE_SIZE 128
+#define FC_PROFILE_EVENT_BUFFER_SIZE 16384	// must be a power of 2
 #define FC_PROFILE_HISTORY_MAX_SIZE 512
 
 namespace fc_profiler
 {
-	struct ProfileSection
+	// Host timestamp in ticks: TSC on x86, virtual counter on arm64
+	static inline u64 now()
 	{
-		ProfileSection()
-			: function(nullptr)
-			, file(nullptr)
-			, line(0)
-			, scope(0)
-		{
-
-		}
+#if HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64
+		return __rdtsc();
+#elif HOST_CPU == CPU_ARM64 && !defined(_MSC_VER)
+		u64 ticks;
+		asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+		return ticks;
+#else
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+	// Duration of a tick in seconds
+	double tickPeriod();
 
-		ProfileSection(const char* _function, const char* _file, u32 _line, u32 _scope)
-			: function(_function)
-			, file(_file)
-			, line(_line)
-			, scope(_scope)
-		{
-		}
+	enum class EventType : u8
+	{
+		Begin,
+		End,
+		Counter,
+		Instant,
+	};
 
-		const char* function;
+	struct Event
+	{
+		u64 ticks;
+		const char* name;
 		const char* file;
-		u32 line;
-		u32 scope;
-		std::chrono::high_resolution_clock::time_point start;
-		std::chrono::high_resolution_clock::time_point end;
+		s64 value;	// line number for Begin events
+		EventType type;
 	};
 
+	struct ProfileSection
+	{
+		const char* function = nullptr;
+		const char* file = nullptr;
+		u32 line = 0;
+		u32 scope = 0;
+		u64 start = 0;
+		u64 end = 0;
+	};
+
+	// Per-thread event ring buffer.
+	// Events are written by the owning thread only and read by the trace writer thread without locking.
 	struct ProfileThread
 	{
-		ProfileThread()
+		ProfileThread(const char *name, u32 id);
+
+		bool push(EventType type, const char *name, const char *file, s64 value)
 		{
-			startTicks = std::chrono::high_resolution_clock::now();
-			level = 0;
-			historyIdx = 0;
-			cachedTime = 0.0;
-			scopes.reserve(FC_PROFILE_SCOPE_RESERVE_SIZE);
-			memset(history, 0, sizeof(history));
+			const u32 h = head.load(std::memory_order_relaxed);
+			if (h - tail.load(std::memory_order_acquire) >= FC_PROFILE_EVENT_BUFFER_SIZE)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			Event& event = events[h & (FC_PROFILE_EVENT_BUFFER_SIZE - 1)];
+			event.ticks = now();
+			event.name = name;
+			event.file = file;
+			event.value = value;
+			event.type = type;
+			head.store(h + 1, std::memory_order_release);
+			return true;
 		}
 
-		std::vector<ProfileSection> scopes;
-		std::chrono::high_resolution_clock::time_point startTicks;
-		std::chrono::high_resolution_clock::time_point endTicks;
-		double history[FC_PROFILE_HISTORY_MAX_SIZE];
-		u32 level;
-		u32 historyIdx;
-		std::thread::id threadId;
+		Event events[FC_PROFILE_EVENT_BUFFER_SIZE];
+		std::atomic<u32> head { 0 };
+		std::atomic<u32> tail { 0 };
+		std::atomic<u32> dropped { 0 };
+		std::atomic<bool> exited { false };
+		const u32 id;
 		std::string threadName;
 
+		// Frame profiling for threads calling startThread/endThread
+		u32 frameStart = 0;
+		u32 level = 0;
+		u64 startTicks = 0;
+		double history[FC_PROFILE_HISTORY_MAX_SIZE] {};
+		u32 historyIdx = 0;
+
 		struct ResultNode
 		{
-			ResultNode() : parent(nullptr) {}
 			ProfileSection section;
-			ResultNode* parent;
+			ResultNode* parent = nullptr;
 			std::vector<ResultNode> children;
 		};
 
-		double cachedTime;
+		double cachedTime = 0.0;
 		std::vector<ResultNode> cachedResultTree;
+
+		// Guards the thread list and the frame results
 		static std::vector<ProfileThread*> s_allThreads;
-		static std::recursive_mutex s_allThreadsLock;
+		static std::mutex s_allThreadsLock;
 	};
 
+	// Returns the profiler buffer of the current thread or nullptr if the profiler is disabled
+	ProfileThread *currentThread();
+
 	struct ProfileScope
 	{
 		ProfileScope(const char* function, const char* file, int line)
-			: sectionIdx(0)
 		{
-			if (s_thread)
-			{
-				ProfileSection section(function, file, line, s_thread->level++);
-				section.start = std::chrono::high_resolution_clock::now();
-				sectionIdx = s_thread->scopes.size();
-				s_thread->scopes.push_back(section);
-			}
+			thread = currentThread();
+			if (thread != nullptr && !thread->push(EventType::Begin, function, file, line))
+				thread = nullptr;
+			else if (thread != nullptr)
+				thread->level++;
 		}
 
 		~ProfileScope()
 		{
-			if (s_thread)
+			if (thread != nullptr)
 			{
-				s_thread->scopes[sectionIdx].end = std::chrono::high_resolution_clock::now();
-				s_thread->level--;
+				thread->level--;
+				thread->push(EventType::End, nullptr, nullptr, 0);
 			}
 		}
 
-		size_t sectionIdx;
-		static thread_local ProfileThread* s_thread;
+		ProfileThread *thread;
 	};
 
+	static inline void counter(const char *name, s64 value)
+	{
+		ProfileThread *thread = currentThread();
+		if (thread != nullptr)
+			thread->push(EventType::Counter, name, nullptr, value);
+	}
+
+	static inline void instant(const char *name)
+	{
+		ProfileThread *thread = currentThread();
+		if (thread != nullptr)
+			thread->push(EventType::Instant, name, nullptr, 0);
+	}
+
+	void setThreadName(const char *name);
 	void startThread(const std::string& threadName);
 	void endThread(double warningTime = 0.0);
+	// The following functions must be called with ProfileThread::s_allThreadsLock held
 	void drawGUI(const std::vector<ProfileThread::ResultNode>& results);
 	void drawGraph(const ProfileThread& profileThread);
 	void outputTTY(const std::vector<ProfileThread::ResultNode>& results);
@@ -124,15 +181,24 @@ namespace fc_profiler
 #define FC_PROFILE_SCOPE_NAMED(name) \
 	fc_profiler::ProfileScope __profile__scope(name, __FILE__, __LINE__);
 
+#define FC_PROFILE_COUNTER(name, value) \
+	fc_profiler::counter(name, value);
+
+#define FC_PROFILE_INSTANT(name) \
+	fc_profiler::instant(name);
+
 #else
 
 namespace fc_profiler
 {
+	inline static void setThreadName(const char *name) {}
 	inline static void startThread(const std::string& threadName) {}
 	inline static void endThread(float warningTime = 0.0) {}
 }
 
 #define FC_PROFILE_SCOPE
 #define FC_PROFILE_SCOPE_NAMED(name)
+#define FC_PROFILE_COUNTER(name, value)
+#define FC_PROFILE_INSTANT(name)
 
 #endif
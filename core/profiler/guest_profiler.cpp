@@ -0,0 +1,279 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "guest_profiler.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include "emulator.h"
+#include "oslib/oslib.h"
+#include "json.hpp"
+#include <nowide/cstdio.hpp>
+#include <algorithm>
+#include <cinttypes>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+using namespace nlohmann;
+
+namespace guestprof
+{
+
+bool active;
+
+struct BlockStats
+{
+	u64 entries = 0;
+	u32 cycles = 0;
+	u32 opcodes = 0;
+	u32 callTarget = 0;
+};
+
+struct MmioStats
+{
+	std::string name;
+	u64 reads = 0;
+	u64 writes = 0;
+};
+
+static bool resetPending;
+static u64 sampleCount;
+// key is (pr << 32) | pc
+static std::unordered_map<u64, u32> samples;
+// unordered_map nodes are stable so generated code can point to the counters
+static std::unordered_map<u32, BlockStats> blocks;
+static std::unordered_map<u32, u64> dynamicCalls;
+static std::map<u32, MmioStats> mmio;
+
+void start()
+{
+	samples.clear();
+	blocks.clear();
+	dynamicCalls.clear();
+	mmio.clear();
+	sampleCount = 0;
+	// blocks must be recompiled with entry counters
+	resetPending = true;
+	active = true;
+	INFO_LOG(DYNAREC, "Guest profiler started");
+}
+
+void sample(u32 pc, u32 pr)
+{
+	if (resetPending)
+	{
+		resetPending = false;
+		emu.getSh4Executor()->ResetCache();
+	}
+	samples[((u64)pr << 32) | pc]++;
+	sampleCount++;
+}
+
+u64 *blockCounter(const RuntimeBlockInfo *block)
+{
+	BlockStats& stats = blocks[block->vaddr];
+	stats.cycles = block->guest_cycles;
+	stats.opcodes = block->guest_opcodes;
+	if (block->BlockType == BET_StaticCall)
+		stats.callTarget = block->BranchBlock;
+	return &stats.entries;
+}
+
+void DYNACALL dynamicCall(u32 target)
+{
+	dynamicCalls[target]++;
+}
+
+void mmioAccess(u32 addr, bool write, const char *name)
+{
+	MmioStats& stats = mmio[addr];
+	if (stats.name.empty())
+		stats.name = name;
+	if (write)
+		stats.writes++;
+	else
+		stats.reads++;
+}
+
+class Frames
+{
+public:
+	int get(const std::string& name)
+	{
+		auto it = indices.find(name);
+		if (it != indices.end())
+			return it->second;
+		int idx = (int)frames.size();
+		frames.push_back({ { "name", name } });
+		indices[name] = idx;
+		return idx;
+	}
+
+	json frames = json::array();
+
+private:
+	std::unordered_map<std::string, int> indices;
+};
+
+static std::string hexName(const char *prefix, u32 addr)
+{
+	char s[32];
+	snprintf(s, sizeof(s), "%s%08x", prefix, addr);
+	return s;
+}
+
+static json sampledProfile(const char *name, json&& stacks, json&& weights, u64 total)
+{
+	return {
+		{ "type", "sampled" },
+		{ "name", name },
+		{ "unit", "none" },
+		{ "startValue", 0 },
+		{ "endValue", total },
+		{ "samples", std::move(stacks) },
+		{ "weights", std::move(weights) },
+	};
+}
+
+std::string stop()
+{
+	active = false;
+	resetPending = false;
+	// remove block counters
+	emu.getSh4Executor()->ResetCache();
+
+	// Known function entry points: static and dynamic call targets
+	std::set<u32> functions;
+	std::unordered_map<u32, u64> calls = dynamicCalls;
+	for (const auto& [vaddr, stats] : blocks)
+		if (stats.callTarget != 0)
+		{
+			functions.insert(stats.callTarget);
+			calls[stats.callTarget] += stats.entries;
+		}
+	for (const auto& [target, count] : dynamicCalls)
+		functions.insert(target);
+	auto functionName = [&functions](u32 addr) -> std::string {
+		auto it = functions.upper_bound(addr);
+		if (it == functions.begin())
+			return "unknown";
+		return hexName("sub_", *std::prev(it));
+	};
+
+	Frames frames;
+	json profiles = json::array();
+
+	// Hierarchical PC samples: caller function > current function > pc
+	{
+		json stacks = json::array();
+		json weights = json::array();
+		for (const auto& [key, count] : samples)
+		{
+			const u32 pc = (u32)key;
+			const u32 pr = (u32)(key >> 32);
+			stacks.push_back({ frames.get(functionName(pr - 4)), frames.get(functionName(pc)), frames.get(hexName("", pc)) });
+			weights.push_back(count);
+		}
+		profiles.push_back(sampledProfile("PC samples", std::move(stacks), std::move(weights), sampleCount));
+	}
+	// Block entries weighted by their cycle count
+	{
+		std::vector<std::pair<u32, const BlockStats *>> sorted;
+		for (const auto& [vaddr, stats] : blocks)
+			if (stats.entries != 0)
+				sorted.emplace_back(vaddr, &stats);
+		std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+			return (u64)a.second->entries * a.second->cycles > (u64)b.second->entries * b.second->cycles;
+		});
+		json stacks = json::array();
+		json weights = json::array();
+		u64 total = 0;
+		for (const auto& [vaddr, stats] : sorted)
+		{
+			stacks.push_back({ frames.get(functionName(vaddr)), frames.get(hexName("block_", vaddr)) });
+			weights.push_back(stats->entries * stats->cycles);
+			total += stats->entries * stats->cycles;
+		}
+		for (size_t i = 0; i < std::min<size_t>(sorted.size(), 10); i++)
+			INFO_LOG(DYNAREC, "Hot block %08x: %" PRIu64 " entries, %d cycles, %d opcodes", sorted[i].first,
+					sorted[i].second->entries, sorted[i].second->cycles, sorted[i].second->opcodes);
+		profiles.push_back(sampledProfile("Block cycles", std::move(stacks), std::move(weights), total));
+	}
+	// Function calls
+	{
+		json stacks = json::array();
+		json weights = json::array();
+		u64 total = 0;
+		for (const auto& [target, count] : calls)
+		{
+			stacks.push_back({ frames.get(hexName("sub_", target)) });
+			weights.push_back(count);
+			total += count;
+		}
+		profiles.push_back(sampledProfile("Calls", std::move(stacks), std::move(weights), total));
+	}
+	// Holly register accesses
+	{
+		json stacks = json::array();
+		json weights = json::array();
+		u64 total = 0;
+		for (const auto& [addr, stats] : mmio)
+		{
+			if (stats.reads != 0)
+			{
+				stacks.push_back({ frames.get(stats.name), frames.get(stats.name + " read") });
+				weights.push_back(stats.reads);
+			}
+			if (stats.writes != 0)
+			{
+				stacks.push_back({ frames.get(stats.name), frames.get(stats.name + " write") });
+				weights.push_back(stats.writes);
+			}
+			total += stats.reads + stats.writes;
+		}
+		profiles.push_back(sampledProfile("Holly registers", std::move(stacks), std::move(weights), total));
+	}
+
+	json root = {
+		{ "$schema", "https://www.speedscope.app/file-format-schema.json" },
+		{ "name", settings.content.title },
+		{ "exporter", "flycast" },
+		{ "shared", { { "frames", std::move(frames.frames) } } },
+		{ "profiles", std::move(profiles) },
+	};
+	samples.clear();
+	blocks.clear();
+	dynamicCalls.clear();
+	mmio.clear();
+
+	std::string path = get_writable_data_path("guest_profile.speedscope.json");
+	FILE *f = nowide::fopen(path.c_str(), "wb");
+	if (f == nullptr)
+	{
+		WARN_LOG(DYNAREC, "Can't save guest profile to %s", path.c_str());
+		return "";
+	}
+	std::string s = root.dump();
+	fwrite(s.data(), 1, s.size(), f);
+	fclose(f);
+	INFO_LOG(DYNAREC, "Guest profile saved to %s", path.c_str());
+
+	return path;
+}
+
+}
@@ -0,0 +1,48 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+#include <string>
+
+struct RuntimeBlockInfo;
+
+// Runtime SH4 guest profiler.
+// PC/PR samples are taken every timeslice, dynarec blocks compiled while the profiler is active
+// count their entries and dynamic call targets, and holly register accesses are counted.
+// The result is saved in speedscope format (https://www.speedscope.app)
+namespace guestprof
+{
+
+extern bool active;
+
+// Start profiling. Must be called while the emulator is paused or from the emulator thread.
+void start();
+// Stop profiling and save the profile. Returns the path of the saved file or an empty string on error.
+std::string stop();
+
+// Called by the cpu main loop every timeslice
+void sample(u32 pc, u32 pr);
+// Returns the entry counter of the given block
+u64 *blockCounter(const RuntimeBlockInfo *block);
+// Called by blocks ending with a dynamic call
+void DYNACALL dynamicCall(u32 target);
+// Called by holly register handlers
+void mmioAccess(u32 addr, bool write, const char *name);
+
+}
@@ -0,0 +1,254 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "perf_counters.h"
+#include "network/net_platform.h"
+#include "util/periodic_thread.h"
+#include "emulator.h"
+#include "cfg/option.h"
+#include "stdclass.h"
+#include <nowide/cstdio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace perfcounters
+{
+
+std::atomic<u64> counters[CounterCount];
+
+static const char * const counterNames[CounterCount] = {
+	"framesRendered",
+	"framesSkipped",
+	"blocksCompiled",
+	"cacheResets",
+	"textureUploads",
+	"vramFaults",
+	"audioUnderruns",
+	"taVertices",
+	"taPolygons",
+	"descSetUpdates",
+	"descSetBinds",
+};
+
+// Snapshot ring buffer. Written by the emulator thread only.
+// A reader copies a snapshot then checks that it hasn't been overwritten in the meantime.
+constexpr u32 SNAPSHOT_COUNT = 256;
+static Snapshot snapshots[SNAPSHOT_COUNT];
+static std::atomic<u64> snapshotHead;
+static std::chrono::steady_clock::time_point lastVblank;
+
+void vblank(float emuSpeed)
+{
+	if (!config::PerfCounters)
+		return;
+	const auto now = std::chrono::steady_clock::now();
+	const u64 head = snapshotHead.load(std::memory_order_relaxed);
+	Snapshot& snapshot = snapshots[head % SNAPSHOT_COUNT];
+	snapshot.frame = head;
+	snapshot.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	snapshot.frameTime = head == 0 ? 0 : (u32)std::chrono::duration_cast<std::chrono::microseconds>(now - lastVblank).count();
+	snapshot.emuSpeed = emuSpeed;
+	for (int i = 0; i < CounterCount; i++)
+		snapshot.counters[i] = counters[i].load(std::memory_order_relaxed);
+	lastVblank = now;
+	snapshotHead.store(head + 1, std::memory_order_release);
+}
+
+static bool readSnapshot(u64 index, Snapshot& snapshot)
+{
+	snapshot = snapshots[index % SNAPSHOT_COUNT];
+	std::atomic_thread_fence(std::memory_order_acquire);
+	// the slot is being rewritten once the head reaches index + SNAPSHOT_COUNT
+	return snapshotHead.load(std::memory_order_relaxed) - index < SNAPSHOT_COUNT;
+}
+
+// Sends snapshots as JSON lines to the clients connected to the local TCP port and/or to a file
+class Exporter : public VPeriodicThread
+{
+public:
+	Exporter() : VPeriodicThread("PerfCounters", 100)
+	{
+		EventManager::listen(Event::Resume, emuEventCallback, this);
+		EventManager::listen(Event::Terminate, emuEventCallback, this);
+	}
+
+	~Exporter() override
+	{
+		stop();
+		EventManager::unlisten(Event::Resume, emuEventCallback, this);
+		EventManager::unlisten(Event::Terminate, emuEventCallback, this);
+	}
+
+protected:
+	void init() override
+	{
+		tail = snapshotHead.load(std::memory_order_acquire);
+		if (config::PerfCountersPort != 0)
+			openServer();
+		if (config::PerfCountersFile)
+		{
+			std::string path = get_writable_data_path("perf_counters.jsonl");
+			file = nowide::fopen(path.c_str(), "a");
+			if (file == nullptr)
+				WARN_LOG(COMMON, "Can't open performance counter file %s", path.c_str());
+			else
+				INFO_LOG(COMMON, "Writing performance counters to %s", path.c_str());
+		}
+	}
+
+	void doWork() override
+	{
+		acceptConnections();
+		const u64 head = snapshotHead.load(std::memory_order_acquire);
+		if (head - tail > SNAPSHOT_COUNT)
+			tail = head - SNAPSHOT_COUNT;
+		if (tail == head || (clients.empty() && file == nullptr)) {
+			tail = head;
+			return;
+		}
+		std::string lines;
+		Snapshot snapshot;
+		for (; tail != head; tail++)
+			if (readSnapshot(tail, snapshot))
+				format(snapshot, lines);
+		if (file != nullptr) {
+			fputs(lines.c_str(), file);
+			fflush(file);
+		}
+		send(lines);
+	}
+
+	void term() override
+	{
+		for (sock_t sock : clients)
+			closesocket(sock);
+		clients.clear();
+		if (server != INVALID_SOCKET) {
+			closesocket(server);
+			server = INVALID_SOCKET;
+		}
+		if (file != nullptr) {
+			fclose(file);
+			file = nullptr;
+		}
+	}
+
+private:
+	static void emuEventCallback(Event event, void *param)
+	{
+		Exporter *exporter = (Exporter *)param;
+		if (event == Event::Resume && config::PerfCounters)
+			exporter->start();
+		else
+			// restarted on resume so that option changes are taken into account
+			exporter->stop();
+	}
+
+	void openServer()
+	{
+		server = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		int option = 1;
+		setsockopt(server, SOL_SOCKET, SO_REUSEADDR, (const char *)&option, sizeof(option));
+
+		sockaddr_in saddr{};
+		saddr.sin_family = AF_INET;
+		saddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		saddr.sin_port = htons((u16)config::PerfCountersPort);
+		if (::bind(server, (sockaddr *)&saddr, sizeof(saddr)) < 0 || listen(server, 5) < 0)
+		{
+			WARN_LOG(COMMON, "Performance counters: bind/listen failed: errno %d", get_last_error());
+			closesocket(server);
+			server = INVALID_SOCKET;
+			return;
+		}
+		set_non_blocking(server);
+		INFO_LOG(COMMON, "Performance counters available on port %d", (int)config::PerfCountersPort);
+	}
+
+	void acceptConnections()
+	{
+		if (server == INVALID_SOCKET)
+			return;
+		while (true)
+		{
+			sockaddr_in src_addr{};
+			socklen_t addr_len = sizeof(src_addr);
+			sock_t sockfd = accept(server, (sockaddr *)&src_addr, &addr_len);
+			if (sockfd == INVALID_SOCKET)
+				break;
+			set_non_blocking(sockfd);
+			clients.push_back(sockfd);
+		}
+	}
+
+	void send(const std::string& msg)
+	{
+		std::vector<sock_t> errorSockets;
+		for (sock_t sock : clients)
+		{
+			int rc = ::send(sock, msg.c_str(), msg.length(), MSG_NOSIGNAL);
+			if (rc < 0)
+			{
+				// slow clients lose data rather than blocking
+				int error = get_last_error();
+				if (error != L_EWOULDBLOCK && error != L_EAGAIN)
+					errorSockets.push_back(sock);
+			}
+			else if ((size_t)rc < msg.length()) {
+				// a truncated line can't be recovered from
+				errorSockets.push_back(sock);
+			}
+		}
+		for (sock_t sock : errorSockets)
+		{
+			closesocket(sock);
+			clients.erase(std::find(clients.begin(), clients.end(), sock));
+		}
+	}
+
+	static void format(const Snapshot& snapshot, std::string& out)
+	{
+		char buf[128];
+		snprintf(buf, sizeof(buf), "{\"frame\":%" PRIu64 ",\"time\":%" PRIu64 ",\"frameTime\":%u,\"emuSpeed\":%.1f",
+				snapshot.frame, snapshot.timestamp, snapshot.frameTime, snapshot.emuSpeed);
+		out += buf;
+		for (int i = 0; i < CounterCount; i++)
+		{
+			snprintf(buf, sizeof(buf), ",\"%s\":%" PRIu64, counterNames[i], snapshot.counters[i]);
+			out += buf;
+		}
+		out += "}\n";
+	}
+
+	sock_t server = INVALID_SOCKET;
+	std::vector<sock_t> clients;
+	FILE *file = nullptr;
+	u64 tail = 0;
+};
+
+static Exporter exporter;
+
+}
@@ -0,0 +1,63 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+#include <atomic>
+
+// Emulator performance counters.
+// Counters can be incremented from any thread. A snapshot is taken at each vblank
+// and exported as JSON lines to local TCP clients and/or a file.
+namespace perfcounters
+{
+
+enum Counter
+{
+	FramesRendered,
+	FramesSkipped,
+	BlocksCompiled,
+	CacheResets,
+	TextureUploads,
+	VramFaults,
+	AudioUnderruns,
+	TaVertices,
+	TaPolygons,
+	DescSetUpdates,		// Vulkan per-polygon descriptor sets
+	DescSetBinds,
+	CounterCount
+};
+
+struct Snapshot
+{
+	u64 frame;
+	u64 timestamp;		// microseconds since the epoch
+	u32 frameTime;		// microseconds since the previous vblank
+	float emuSpeed;		// percentage of the real SH4 speed
+	u64 counters[CounterCount];	// cumulative values
+};
+
+extern std::atomic<u64> counters[CounterCount];
+
+static inline void add(Counter counter, u64 value = 1) {
+	counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+// Called by the emulator thread at each vblank
+void vblank(float emuSpeed);
+
+}
@@ -44,6 +44,7 @@ using namespace vixl::aarch64;
 #include "hw/mem/addrspace.h"
 #include "oslib/virtmem.h"
 #include "emulator.h"
+#include "profiler/guest_profiler.h"
 
 struct DynaRBI : RuntimeBlockInfo
 {
@@ -260,6 +261,14 @@ public:
 		jitWriteProtect(codeBuffer, false);
 		this->block = block;
 		CheckBlock(force_checks, block);
+
+		if (guestprof::active)
+		{
+			Mov(x9, reinterpret_cast<uintptr_t>(guestprof::blockCounter(block)));
+			Ldr(x10, MemOperand(x9));
+			Add(x10, x10, 1);
+			Str(x10, MemOperand(x9));
+		}
 		
 		// run register allocator
 		regalloc.DoAlloc(block);
@@ -1285,6 +1294,11 @@ public:
 			// next_pc = *jdyn;
 
 			Str(w29, sh4_context_mem_operand(&sh4ctx.pc));
+			if (guestprof::active && block->BlockType == BET_DynamicCall)
+			{
+				Mov(w0, w29);
+				GenCall(guestprof::dynamicCall);
+			}
 			if (!mmu_enabled() && sh4ctx.CpuRunning)
 			{
 				ptrdiff_t start = GetBuffer()->GetCursorOffset();
@@ -2097,6 +2111,31 @@ private:
 			{
 				Ldr(x9, reinterpret_cast<uintptr_t>(ptr));
 
+				if (sz >= 32)
+				{
+					// Compare 16 bytes at a time and accumulate the differences so that there's a single branch
+					const s32 chunks = sz / 16;
+					for (s32 i = 0; i < chunks; i++)
+					{
+						Ldr(q0, MemOperand(x9, 16, PostIndex));
+						Ldr(q1, *(u64 *)(ptr + 8), *(u64 *)ptr);
+						if (i == 0)
+						{
+							Eor(v2.V16B(), v0.V16B(), v1.V16B());
+						}
+						else
+						{
+							Eor(v0.V16B(), v0.V16B(), v1.V16B());
+							Orr(v2.V16B(), v2.V16B(), v0.V16B());
+						}
+						sz -= 16;
+						ptr += 16;
+					}
+					Umaxv(s2, v2.V4S());
+					Fmov(w10, s2);
+					Cbnz(w10, &blockcheck_fail);
+				}
+
 				while (sz > 0)
 				{
 					if (sz >= 8)
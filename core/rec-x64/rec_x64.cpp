@@ -12,10 +12,13 @@ using namespace Xbyak::util;
 #include "hw/sh4/sh4_opcode_list.h"
 #include "hw/sh4/dyna/ngen.h"
 #include "hw/sh4/modules/mmu.h"
+#include "hw/sh4/modules/shadowmmu.h"
+#include "profiler/guest_profiler.h"
 #include "hw/sh4/sh4_interrupts.h"
 
 #include "hw/sh4/sh4_core.h"
 #include "hw/sh4/sh4_mem.h"
+#include "hw/pvr/ta.h"
 #include "x64_regalloc.h"
 #include "xbyak_base.h"
 #include "oslib/unwind_info.h"
@@ -48,6 +51,8 @@ namespace MemType {
 		Fast,
 		StoreQueue,
 		Slow,
+		Shadow,
+		ShadowSlow,
 		Count
 	};
 }
@@ -115,6 +120,40 @@ constexpr u32 STACK_ALIGN = 0x28;	// 32-byte shadow space + 8 byte alignment
 constexpr u32 STACK_ALIGN = 8;
 #endif
 
+// Shadow mmu slow path: translate the virtual address, raising an exception if needed
+static u32 shadowLookup(u32 vaddr, u32 write, u32 pc)
+{
+	u32 paddr;
+	MmuError rv = shadowmmu::translate(vaddr, write, paddr);
+	if (unlikely(rv != MmuError::NONE))
+	{
+		Sh4cntx.pc = pc;
+		DoMMUException(vaddr, rv, write ? MMU_TT_DWRITE : MMU_TT_DREAD);
+		host_context_t ctx;
+		sh4Dynarec->handleException(ctx);
+		((void (*)())ctx.pc)();
+		// not reached
+		return 0;
+	}
+	return paddr;
+}
+static u32 DYNACALL shadowRead8(u32 vaddr, u32, u32 pc) {
+	return (s32)(s8)addrspace::read8(shadowLookup(vaddr, 0, pc));
+}
+static u32 DYNACALL shadowRead16(u32 vaddr, u32, u32 pc) {
+	return (s32)(s16)addrspace::read16(shadowLookup(vaddr, 0, pc));
+}
+static u32 DYNACALL shadowRead32(u32 vaddr, u32, u32 pc) {
+	return addrspace::read32(shadowLookup(vaddr, 0, pc));
+}
+static u64 DYNACALL shadowRead64(u32 vaddr, u32, u32 pc) {
+	return addrspace::read64(shadowLookup(vaddr, 0, pc));
+}
+template<typename T>
+static void DYNACALL shadowWrite(u32 vaddr, T data, u32 pc) {
+	addrspace::writet<T>(shadowLookup(vaddr, 1, pc), data);
+}
+
 class BlockCompiler : public BaseXbyakRec<BlockCompiler, true>
 {
 public:
@@ -133,6 +172,12 @@ public:
 
 		sub(rsp, STACK_ALIGN);
 
+		if (guestprof::active)
+		{
+			mov(rax, (uintptr_t)guestprof::blockCounter(block));
+			add(qword[rax], 1);
+		}
+
 		if (mmu_enabled() && block->has_fpu_op)
 		{
 			Xbyak::Label fpu_enabled;
@@ -230,10 +275,17 @@ public:
 							add(call_regs[0], dword[rax]);
 						}
 					}
-					genMmuLookup(block, op, 0);
-
 					int size = op.size == 1 ? MemSize::S8 : op.size == 2 ? MemSize::S16 : op.size == 4 ? MemSize::S32 : MemSize::S64;
-					GenCall((void (*)())MemHandlers[optimise ? MemType::Fast : MemType::Slow][size][MemOp::R], mmu_enabled());
+					if (shadowmmu::enabled())
+					{
+						mov(call_regs[2], block->vaddr + op.guest_offs - (op.delay_slot ? 2 : 0));	// pc
+						GenCall((void (*)())MemHandlers[MemType::Shadow][size][MemOp::R], true);
+					}
+					else
+					{
+						genMmuLookup(block, op, 0);
+						GenCall((void (*)())MemHandlers[optimise ? MemType::Fast : MemType::Slow][size][MemOp::R], mmu_enabled());
+					}
 
 #if ALLOC_F64 == false
 					if (size == MemSize::S64)
@@ -267,7 +319,8 @@ public:
 							add(call_regs[0], dword[rax]);
 						}
 					}
-					genMmuLookup(block, op, 1);
+					if (!shadowmmu::enabled())
+						genMmuLookup(block, op, 1);
 
 #if ALLOC_F64 == false
 					if (op.size == 8)
@@ -280,7 +333,15 @@ public:
 						shil_param_to_host_reg(op.rs2, call_regs64[1]);
 
 					int size = op.size == 1 ? MemSize::S8 : op.size == 2 ? MemSize::S16 : op.size == 4 ? MemSize::S32 : MemSize::S64;
-					GenCall((void (*)())MemHandlers[optimise ? MemType::Fast : MemType::Slow][size][MemOp::W], mmu_enabled());
+					if (shadowmmu::enabled())
+					{
+						mov(call_regs[2], block->vaddr + op.guest_offs - (op.delay_slot ? 2 : 0));	// pc
+						GenCall((void (*)())MemHandlers[MemType::Shadow][size][MemOp::W], true);
+					}
+					else
+					{
+						GenCall((void (*)())MemHandlers[optimise ? MemType::Fast : MemType::Slow][size][MemOp::W], mmu_enabled());
+					}
 				}
 			}
 			break;
@@ -380,6 +441,52 @@ public:
 					}
 					else
 					{
+						Xbyak::Label slow_sqw;
+						Xbyak::Label run_fsm;
+						// setSqwHandler() selects sqWriteTA whenever QACR0 is written, so it's checked at run time
+						mov(rax, (size_t)&sh4ctx.doSqWrite);
+						mov(r10, (uintptr_t)&sqWriteTA);
+						cmp(qword[rax], r10);
+						jne(slow_sqw);
+						// polygon data: copy the burst to the TA buffer
+						test(call_regs[0], 0x01800000);
+						jnz(slow_sqw);
+						mov(rax, (uintptr_t)&ta_ctx);
+						cmp(qword[rax], 0);
+						je(slow_sqw);
+						mov(rax, (uintptr_t)&ta_tad);
+						mov(r10, qword[rax + offsetof(tad_context, thd_data)]);
+						sub(r10, qword[rax + offsetof(tad_context, thd_root)]);
+						// an empty buffer may still hold the previous pass data, see tad_context::End()
+						jz(slow_sqw);
+						cmp(r10, (u32)TA_DATA_SIZE);
+						jae(slow_sqw);
+
+						mov(r11d, call_regs[0]);
+						and_(r11d, 0x20);
+						mov(rax, (uintptr_t)sh4ctx.sq_buffer);
+						add(r11, rax);
+						movaps(xmm0, xword[r11]);
+						movaps(xmm1, xword[r11 + 16]);
+						mov(rax, (uintptr_t)&ta_tad.thd_data);
+						mov(r10, qword[rax]);
+						movaps(xword[r10], xmm0);
+						movaps(xword[r10 + 16], xmm1);
+						add(qword[rax], (u32)sizeof(SQBuffer));
+
+						// 32-byte vertices continuing a strip don't change the TA state
+						mov(rax, (uintptr_t)&ta_fsm[2048]);
+						cmp(byte[rax], TAS_PLV32);
+						jne(run_fsm);
+						mov(r10d, dword[r11]);
+						shr(r10d, 29);		// PCW.ParaType
+						cmp(r10d, ParamType_Vertex_Parameter);
+						je(no_sqw);
+						L(run_fsm);
+						GenCall(ta_process_param);
+						jmp(no_sqw);
+
+						L(slow_sqw);
 						mov(rax, (size_t)&sh4ctx.doSqWrite);
 						saveXmmRegisters();
 						call(qword[rax]);
@@ -512,6 +619,11 @@ public:
 			mov(rdx, (size_t)&sh4ctx.jdyn);
 			mov(edx, dword[rdx]);
 			mov(dword[rax], edx);
+			if (guestprof::active && block->BlockType == BET_DynamicCall)
+			{
+				mov(call_regs[0], edx);
+				GenCall(guestprof::dynamicCall);
+			}
 			break;
 
 		case BET_DynamicIntr:
@@ -776,6 +888,8 @@ public:
 		{
 			for (int op = 0; op < MemOp::Count; op++)
 			{
+				if (shadowmmu::base != nullptr && (void *)MemHandlers[MemType::Shadow][size][op] == ca)
+					return rewriteShadowAccess(context, retAddr, size, op);
 				if ((void *)MemHandlers[MemType::Fast][size][op] != ca)
 					continue;
 
@@ -810,6 +924,41 @@ public:
 	}
 
 private:
+	bool rewriteShadowAccess(host_context_t &context, u8 *retAddr, int size, int op)
+	{
+		const u32 vaddr = context.r9;
+		switch (shadowmmu::mapPage(vaddr, op == MemOp::W))
+		{
+		case shadowmmu::MapResult::Mapped:
+			// retry
+			return true;
+
+		case shadowmmu::MapResult::Fault:
+			// Let the slow path raise the exception. The page may be mapped later so the call isn't patched.
+			context.pc = (uintptr_t)MemHandlers[MemType::ShadowSlow][size][op];
+			break;
+
+		case shadowmmu::MapResult::NotRam:
+			{
+				const u8 *start = getCurr();
+				call(MemHandlers[MemType::ShadowSlow][size][op]);
+				verify(getCurr() - start == 5);
+				ready();
+
+				context.pc = (uintptr_t)(retAddr - 5);
+				// remove the call from the stack
+				context.rsp += 8;
+			}
+			break;
+		}
+#ifdef _WIN32
+		context.rcx = vaddr;
+#else
+		context.rdi = vaddr;
+#endif
+		return true;
+	}
+
 	void genMmuLookup(const RuntimeBlockInfo* block, const shil_opcode& op, u32 write)
 	{
 		if (mmu_enabled())
@@ -1074,8 +1223,20 @@ private:
 		s32 sz=block->sh4_code_size;
 		u32 sa=block->addr;
 
+		// Large blocks are compared 16 or 32 bytes at a time against a constant pool
+		if (sz >= 32)
+		{
+			u8 *code = GetMemPtr(sa, sz);
+			if (code != nullptr)
+			{
+				s32 done = CheckBlockSimd(code, sz);
+				sz -= done;
+				sa += done;
+			}
+		}
+
 		void* ptr = (void*)GetMemPtr(sa, sz > 8 ? 8 : sz);
-		if (ptr)
+		if (ptr && sz > 0)
 		{
 			while (sz > 0)
 			{
@@ -1106,6 +1267,61 @@ private:
 		}
 	}
 
+	// Compares the block code in 16-byte (or 32-byte with AVX2) chunks and returns the number of bytes checked.
+	// The comparison results are and'ed together so that there's a single branch to the failure handler.
+	s32 CheckBlockSimd(const u8 *code, s32 sz)
+	{
+		const bool avx2 = cpu.has(Cpu::tAVX2) && sz >= 64;
+		const s32 chunkSize = avx2 ? 32 : 16;
+		const s32 chunks = sz / chunkSize;
+		Xbyak::Label pool;
+		Xbyak::Label poolEnd;
+
+		mov(rax, (uintptr_t)code);
+		for (s32 i = 0; i < chunks; i++)
+		{
+			if (avx2)
+			{
+				vmovdqu(ymm1, yword[rax + i * chunkSize]);
+				vpcmpeqb(ymm1, ymm1, yword[rip + pool + i * chunkSize]);
+				if (i == 0)
+					vmovdqa(ymm0, ymm1);
+				else
+					vpand(ymm0, ymm0, ymm1);
+			}
+			else
+			{
+				movdqu(xmm1, xword[rax + i * chunkSize]);
+				pcmpeqb(xmm1, xword[rip + pool + i * chunkSize]);
+				if (i == 0)
+					movdqa(xmm0, xmm1);
+				else
+					pand(xmm0, xmm1);
+			}
+		}
+		if (avx2)
+		{
+			vpmovmskb(edx, ymm0);
+			vzeroupper();
+			cmp(edx, -1);
+		}
+		else
+		{
+			pmovmskb(edx, xmm0);
+			cmp(edx, 0xffff);
+		}
+		jne(reinterpret_cast<const void*>(CC_RX2RW(&ngen_blockcheckfail)));
+		jmp(poolEnd, T_NEAR);
+
+		align(avx2 ? 32 : 16);
+		L(pool);
+		for (s32 i = 0; i < chunks * chunkSize; i++)
+			db(code[i]);
+		L(poolEnd);
+
+		return chunks * chunkSize;
+	}
+
 	void genMemHandlers()
 	{
 		// make sure the memory handlers are set
@@ -1118,12 +1334,24 @@ private:
 			{
 				for (int op = 0; op < MemOp::Count; op++)
 				{
+					if ((type == MemType::Shadow || type == MemType::ShadowSlow) && shadowmmu::base == nullptr)
+						continue;
 					MemHandlers[type][size][op] = getCurr();
-					if (type == MemType::Fast && addrspace::virtmemEnabled())
+					if ((type == MemType::Fast && addrspace::virtmemEnabled()) || type == MemType::Shadow)
 					{
-						mov(rax, (uintptr_t)addrspace::ram_base);
-						mov(r9, call_regs64[0]);
-						and_(call_regs[0], 0x1FFFFFFF);
+						if (type == MemType::Shadow)
+						{
+							// host mirror of the 4 GB virtual address space of the current processor mode
+							mov(rax, (uintptr_t)&shadowmmu::base);
+							mov(rax, qword[rax]);
+							mov(r9, call_regs64[0]);
+						}
+						else
+						{
+							mov(rax, (uintptr_t)addrspace::ram_base);
+							mov(r9, call_regs64[0]);
+							and_(call_regs[0], 0x1FFFFFFF);
+						}
 
 						switch (size)
 						{
@@ -1181,6 +1409,45 @@ private:
 							jmp((const void *)addrspace::write64);	// tail call
 						continue;
 					}
+					else if (type == MemType::ShadowSlow)
+					{
+						// tail calls
+						if (op == MemOp::R)
+						{
+							switch (size) {
+							case MemSize::S8:
+								jmp((const void *)shadowRead8);
+								break;
+							case MemSize::S16:
+								jmp((const void *)shadowRead16);
+								break;
+							case MemSize::S32:
+								jmp((const void *)shadowRead32);
+								break;
+							case MemSize::S64:
+								jmp((const void *)shadowRead64);
+								break;
+							}
+						}
+						else
+						{
+							switch (size) {
+							case MemSize::S8:
+								jmp((const void *)shadowWrite<u8>);
+								break;
+							case MemSize::S16:
+								jmp((const void *)shadowWrite<u16>);
+								break;
+							case MemSize::S32:
+								jmp((const void *)shadowWrite<u32>);
+								break;
+							case MemSize::S64:
+								jmp((const void *)shadowWrite<u64>);
+								break;
+							}
+						}
+						continue;
+					}
 					else
 					{
 						// Slow path
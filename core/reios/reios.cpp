@@ -427,6 +427,7 @@ static void reios_setup_state(u32 boot_addr)
 	}
 
 	// Set up AICA interrupt masks
+	aica::sync();
 	aica::writeAicaReg(SCIEB_addr, (u16)0x48);
 	aica::writeAicaReg(SCILV0_addr, (u8)0x18);
 	aica::writeAicaReg(SCILV1_addr, (u8)0x50);
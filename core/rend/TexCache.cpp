@@ -15,9 +15,11 @@
     along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
 */
 #include "TexCache.h"
+#include "fb_convert.h"
 #include "deps/xbrz/xbrz.h"
 #include "hw/pvr/pvr_mem.h"
 #include "hw/mem/addrspace.h"
+#include "profiler/perf_counters.h"
 
 #include <mutex>
 #include <xxhash.h>
@@ -86,6 +88,7 @@ bool VramLockedWriteOffset(size_t offset)
 
 	size_t addr_hash = offset / PAGE_SIZE;
 	std::vector<vram_block *>& list = VramLocks[addr_hash];
+	perfcounters::add(perfcounters::VramFaults);
 
 	{
 		std::lock_guard<std::mutex> lockguard(vramlist_lock);
@@ -276,10 +279,14 @@ void BaseTextureCacheData::protectVRam()
 
 void BaseTextureCacheData::unprotectVRam()
 {
-	std::lock_guard<std::mutex> lock(vramlist_lock);
-	if (lock_block)
-		libCore_vramlock_Unlock_block_wb(lock_block);
-	lock_block = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(vramlist_lock);
+		if (lock_block)
+			libCore_vramlock_Unlock_block_wb(lock_block);
+		lock_block = nullptr;
+	}
+	// The texture is being deleted or replaced by a render-to-texture
+	cancelUpscaling();
 }
 
 bool BaseTextureCacheData::Delete()
@@ -439,6 +446,7 @@ bool BaseTextureCacheData::Update()
 {
 	//texture state tracking stuff
 	Updates++;
+	perfcounters::add(perfcounters::TextureUploads);
 	dirty = 0;
 	gpuPalette = false;
 	tex_type = tex->type;
@@ -525,6 +533,7 @@ bool BaseTextureCacheData::Update()
 		custom_texture.loadCustomTextureAsync(this);
 	}
 	is_custom_replaced = false;
+	cancelUpscaling();
 
 	void *temp_tex_buffer = NULL;
 	u32 upscaled_w = width;
@@ -598,16 +607,24 @@ bool BaseTextureCacheData::Update()
 			// xBRZ scaling
 			if (textureUpscaling)
 			{
-				PixelBuffer<u32> tmp_buf;
-				tmp_buf.init(width * config::TextureUpscale, height * config::TextureUpscale);
-
 				if (tcw.PixelFmt == Pixel1555 || tcw.PixelFmt == Pixel4444)
 					// Alpha channel formats. Palettes with alpha are already handled
 					has_alpha = true;
-				UpscalexBRZ(config::TextureUpscale, pb32.data(), tmp_buf.data(), width, height, has_alpha);
-				pb32.steal_data(tmp_buf);
-				upscaled_w *= config::TextureUpscale;
-				upscaled_h *= config::TextureUpscale;
+				if (config::DumpTextures)
+				{
+					// Dumped textures must be upscaled
+					PixelBuffer<u32> tmp_buf;
+					tmp_buf.init(width * config::TextureUpscale, height * config::TextureUpscale);
+					UpscalexBRZ(config::TextureUpscale, pb32.data(), tmp_buf.data(), width, height, has_alpha);
+					pb32.steal_data(tmp_buf);
+					upscaled_w *= config::TextureUpscale;
+					upscaled_h *= config::TextureUpscale;
+				}
+				else
+				{
+					// The original texture is used until the upscaled one is ready
+					upscaleJob = textureUpscaler.upscale(pb32.data(), width, height, config::TextureUpscale, has_alpha);
+				}
 			}
 		}
 		temp_tex_buffer = pb32.data();
@@ -679,7 +696,11 @@ bool BaseTextureCacheData::Update()
 	//lock the texture to detect changes in it
 	protectVRam();
 
-	UploadToGPU(upscaled_w, upscaled_h, (const u8 *)temp_tex_buffer, IsMipmapped(), mipmapped);
+	if (upscaleJob != nullptr && upscaleJob->isDone())
+		// Found in the upscaled texture cache
+		CheckUpscaledTexture();
+	else
+		UploadToGPU(upscaled_w, upscaled_h, (const u8 *)temp_tex_buffer, IsMipmapped(), mipmapped);
 	if (config::DumpTextures)
 	{
 		ComputeHash();
@@ -703,6 +724,25 @@ void BaseTextureCacheData::CheckCustomTexture()
 		UploadToGPU(custom_width, custom_height, custom_image_data, IsMipmapped(), false);
 		free(custom_image_data);
 		custom_image_data = nullptr;
+		cancelUpscaling();
+	}
+}
+
+void BaseTextureCacheData::cancelUpscaling()
+{
+	if (upscaleJob != nullptr)
+	{
+		textureUpscaler.cancel(upscaleJob);
+		upscaleJob.reset();
+	}
+}
+
+void BaseTextureCacheData::CheckUpscaledTexture()
+{
+	if (IsUpscaledTextureAvailable())
+	{
+		UploadToGPU(upscaleJob->getWidth(), upscaleJob->getHeight(), (const u8 *)upscaleJob->data(), IsMipmapped(), false);
+		upscaleJob.reset();
 	}
 }
 
@@ -759,77 +799,46 @@ void ReadFramebuffer(const FramebufferInfo& info, PixelBuffer<u32>& pb, int& wid
 	pb.init(width, height);
 	u32 *dst = (u32 *)pb.data();
 	const u32 fb_concat = info.fb_r_ctrl.fb_concat;
+	std::vector<u32> line;
 
 	switch (info.fb_r_ctrl.fb_depth)
 	{
 		case fbde_0555:    // 555 RGB
+		case fbde_565:     // 565 RGB
+			line.resize((width + 1) / 2);
 			for (int y = 0; y < height; y++)
 			{
-				for (int i = 0; i < width; i++)
-				{
-					u16 src = pvr_read32p<u16>(addr);
-					*dst++ = Packer::pack(
-							(((src >> 10) & 0x1F) << 3) | fb_concat,
-							(((src >> 5) & 0x1F) << 3) | fb_concat,
-							(((src >> 0) & 0x1F) << 3) | fb_concat,
-							0xff);
-					addr += bpp;
-				}
-				addr += modulus * bpp;
-			}
-			break;
-
-		case fbde_565:    // 565 RGB
-			for (int y = 0; y < height; y++)
-			{
-				for (int i = 0; i < width; i++)
-				{
-					u16 src = pvr_read32p<u16>(addr);
-					*dst++ = Packer::pack(
-							(((src >> 11) & 0x1F) << 3) | fb_concat,
-							(((src >> 5) & 0x3F) << 2) | (fb_concat & 3),
-							(((src >> 0) & 0x1F) << 3) | fb_concat,
-							0xFF);
-					addr += bpp;
-				}
-				addr += modulus * bpp;
+				pvr_read32p_block(addr & ~1, line.data(), width * bpp);
+				if (info.fb_r_ctrl.fb_depth == fbde_0555)
+					fbconv::unpack0555<Packer>((const u16 *)line.data(), dst, width, fb_concat);
+				else
+					fbconv::unpack565<Packer>((const u16 *)line.data(), dst, width, fb_concat);
+				dst += width;
+				addr += (width + modulus) * bpp;
 			}
 			break;
 		case fbde_888:		// 888 RGB
-			for (int y = 0; y < height; y++)
 			{
-				for (int i = 0; i < width; i += 4)
+				// Whole words are read, 3 for each group of 4 pixels
+				const u32 words = (width * 3 + 3) / 4;
+				line.resize(words);
+				for (int y = 0; y < height; y++)
 				{
-					u32 src = pvr_read32p<u32>(addr);
-					*dst++ = Packer::pack(src >> 16, src >> 8, src, 0xff);
-					addr += 4;
-					if (i + 1 >= width)
-						break;
-					u32 src2 = pvr_read32p<u32>(addr);
-					*dst++ = Packer::pack(src2 >> 8, src2, src >> 24, 0xff);
-					addr += 4;
-					if (i + 2 >= width)
-						break;
-					u32 src3 = pvr_read32p<u32>(addr);
-					*dst++ = Packer::pack(src3, src2 >> 24, src2 >> 16, 0xff);
-					addr += 4;
-					if (i + 3 >= width)
-						break;
-					*dst++ = Packer::pack(src3 >> 24, src3 >> 16, src3 >> 8, 0xff);
+					pvr_read32p_block(addr & ~3, line.data(), words * 4);
+					fbconv::unpack888<Packer>(line.data(), dst, width);
+					dst += width;
+					addr += words * 4 + modulus * bpp;
 				}
-				addr += modulus * bpp;
 			}
 			break;
 		case fbde_C888:     // 0888 RGB
+			line.resize(width);
 			for (int y = 0; y < height; y++)
 			{
-				for (int i = 0; i < width; i++)
-				{
-					u32 src = pvr_read32p<u32>(addr);
-					*dst++ = Packer::pack(src >> 16, src >> 8, src, 0xff);
-					addr += bpp;
-				}
-				addr += modulus * bpp;
+				pvr_read32p_block(addr & ~3, line.data(), width * bpp);
+				fbconv::unpack0888<Packer>(line.data(), dst, width);
+				dst += width;
+				addr += (width + modulus) * bpp;
 			}
 			break;
 	}
@@ -837,25 +846,26 @@ void ReadFramebuffer(const FramebufferInfo& info, PixelBuffer<u32>& pb, int& wid
 template void ReadFramebuffer<RGBAPacker>(const FramebufferInfo& info, PixelBuffer<u32>& pb, int& width, int& height);
 template void ReadFramebuffer<BGRAPacker>(const FramebufferInfo& info, PixelBuffer<u32>& pb, int& width, int& height);
 
-template<int bits>
-static inline u8 roundColor(u8 in)
-{
-	u8 out = in >> (8 - bits);
-	if (out != 0xffu >> (8 - bits))
-		out += (in >> (8 - bits - 1)) & 1;
-	return out;
-}
-
 // write to 32-bit vram area (framebuffer)
 class FBPixelWriter
 {
 public:
 	FBPixelWriter(u32 dstAddr) : dstAddr(dstAddr) {}
 
+	// Returns a buffer for count pixels of type T to be written with commit()
 	template<typename T>
-	void write(T pixel) {
-		pvr_write32p<T, true>(dstAddr, pixel);
-		dstAddr += sizeof(T);
+	T *getBuffer(int count)
+	{
+		line.resize((count * sizeof(T) + 3) / 4);
+		alignMask = ~(u32)(sizeof(T) - 1);
+		return (T *)line.data();
+	}
+
+	void commit(int bytes)
+	{
+		// pixels are written at their natural alignment
+		pvr_write32p_block(dstAddr & alignMask, line.data(), bytes);
+		dstAddr += bytes;
 	}
 
 	void advance(int bytes) {
@@ -864,24 +874,31 @@ public:
 
 private:
 	u32 dstAddr;
+	u32 alignMask = ~0u;
+	std::vector<u32> line;
 };
 
 // write to 64-bit vram area (render to texture)
 class TexPixelWriter
 {
 public:
-	TexPixelWriter(u16 *dest) : dest(dest) {}
+	TexPixelWriter(u16 *dest) : dest((u8 *)dest) {}
+
+	template<typename T>
+	T *getBuffer(int count) {
+		return (T *)dest;
+	}
 
-	void write(u16 pixel) {
-		*dest++ = pixel;
+	void commit(int bytes) {
+		dest += bytes;
 	}
 
 	void advance(int bytes) {
-		(u8 *&)dest += bytes;
+		dest += bytes;
 	}
 
 private:
-	u16 *dest;
+	u8 *dest;
 };
 
 // 0555 KRGB 16 bit  (default)	Bit 15 is the value of fb_kval[7].
@@ -895,24 +912,12 @@ public:
 
 	void write(int xmin, int xmax, const u8 *& pixel, int y)
 	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			u8 red, green, blue;
-			if constexpr (Round)
-			{
-				red = roundColor<5>(pixel[Red]);
-				green = roundColor<5>(pixel[Green]);
-				blue = roundColor<5>(pixel[Blue]);
-			}
-			else
-			{
-				red = pixel[Red] >> 3;
-				green = pixel[Green] >> 3;
-				blue = pixel[Blue] >> 3;
-			}
-			pixWriter.write((u16)((red << 10) | (green << 5) | blue | kval_bit));
-			pixel += 4;
-		}
+		if (xmax <= xmin)
+			return;
+		const int count = xmax - xmin;
+		fbconv::pack0555<Red, Green, Blue, Alpha, Round>(pixel, pixWriter.template getBuffer<u16>(count), count, kval_bit);
+		pixWriter.commit(count * BytesPerPixel);
+		pixel += count * 4;
 	}
 
 	static constexpr int BytesPerPixel = 2;
@@ -931,24 +936,12 @@ public:
 
 	void write(int xmin, int xmax, const u8 *& pixel, int y)
 	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			u8 red, green, blue;
-			if constexpr (Round)
-			{
-				red = roundColor<5>(pixel[Red]);
-				green = roundColor<6>(pixel[Green]);
-				blue = roundColor<5>(pixel[Blue]);
-			}
-			else
-			{
-				red = pixel[Red] >> 3;
-				green = pixel[Green] >> 2;
-				blue = pixel[Blue] >> 3;
-			}
-			pixWriter.write((u16)((red << 11) | (green << 5) | blue));
-			pixel += 4;
-		}
+		if (xmax <= xmin)
+			return;
+		const int count = xmax - xmin;
+		fbconv::pack565<Red, Green, Blue, Alpha, Round>(pixel, pixWriter.template getBuffer<u16>(count), count);
+		pixWriter.commit(count * BytesPerPixel);
+		pixel += count * 4;
 	}
 
 	static constexpr int BytesPerPixel = 2;
@@ -966,26 +959,12 @@ public:
 
 	void write(int xmin, int xmax, const u8 *& pixel, int y)
 	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			u8 red, green, blue, alpha;
-			if constexpr (Round)
-			{
-				red = roundColor<4>(pixel[Red]);
-				green = roundColor<4>(pixel[Green]);
-				blue = roundColor<4>(pixel[Blue]);
-				alpha = roundColor<4>(pixel[Alpha]);
-			}
-			else
-			{
-				red = pixel[Red] >> 4;
-				green = pixel[Green] >> 4;
-				blue = pixel[Blue] >> 4;
-				alpha = pixel[Alpha] >> 4;
-			}
-			pixWriter.write((u16)((red << 8) | (green << 4) | blue | (alpha << 12)));
-			pixel += 4;
-		}
+		if (xmax <= xmin)
+			return;
+		const int count = xmax - xmin;
+		fbconv::pack4444<Red, Green, Blue, Alpha, Round>(pixel, pixWriter.template getBuffer<u16>(count), count);
+		pixWriter.commit(count * BytesPerPixel);
+		pixel += count * 4;
 	}
 
 	static constexpr int BytesPerPixel = 2;
@@ -1005,25 +984,12 @@ public:
 
 	void write(int xmin, int xmax, const u8 *& pixel, int y)
 	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			u8 red, green, blue;
-			if constexpr (Round)
-			{
-				red = roundColor<5>(pixel[Red]);
-				green = roundColor<5>(pixel[Green]);
-				blue = roundColor<5>(pixel[Blue]);
-			}
-			else
-			{
-				red = pixel[Red] >> 3;
-				green = pixel[Green] >> 3;
-				blue = pixel[Blue] >> 3;
-			}
-			pixWriter.write((u16)((red << 10) | (green << 5) | blue
-					| (pixel[Alpha] >= fb_alpha_threshold ? 0x8000 : 0)));
-			pixel += 4;
-		}
+		if (xmax <= xmin)
+			return;
+		const int count = xmax - xmin;
+		fbconv::pack1555<Red, Green, Blue, Alpha, Round>(pixel, pixWriter.template getBuffer<u16>(count), count, fb_alpha_threshold);
+		pixWriter.commit(count * BytesPerPixel);
+		pixel += count * 4;
 	}
 
 	static constexpr int BytesPerPixel = 2;
@@ -1042,13 +1008,12 @@ public:
 
 	void write(int xmin, int xmax, const u8 *& pixel, int y)
 	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			pixWriter.write(pixel[Blue]);
-			pixWriter.write(pixel[Green]);
-			pixWriter.write(pixel[Red]);
-			pixel += 4;
-		}
+		if (xmax <= xmin)
+			return;
+		const int count = xmax - xmin;
+		fbconv::pack888<Red, Green, Blue, Alpha>(pixel, pixWriter.template getBuffer<u8>(count * BytesPerPixel), count);
+		pixWriter.commit(count * BytesPerPixel);
+		pixel += count * 4;
 	}
 
 	static constexpr int BytesPerPixel = 3;
@@ -1068,11 +1033,12 @@ public:
 
 	void write(int xmin, int xmax, const u8 *& pixel, int y)
 	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			pixWriter.write((u32)((pixel[Red] << 16) | (pixel[Green] << 8) | pixel[Blue] | fb_kval));
-			pixel += 4;
-		}
+		if (xmax <= xmin)
+			return;
+		const int count = xmax - xmin;
+		fbconv::pack0888<Red, Green, Blue, Alpha>(pixel, pixWriter.template getBuffer<u32>(count), count, fb_kval);
+		pixWriter.commit(count * BytesPerPixel);
+		pixel += count * 4;
 	}
 
 	static constexpr int BytesPerPixel = 4;
@@ -1091,11 +1057,12 @@ public:
 
 	void write(int xmin, int xmax, const u8 *& pixel, int y)
 	{
-		for (int c = xmin; c < xmax; c++)
-		{
-			pixWriter.write((u32)((pixel[Red] << 16) | (pixel[Green] << 8) | pixel[Blue] | (pixel[Alpha] << 24)));
-			pixel += 4;
-		}
+		if (xmax <= xmin)
+			return;
+		const int count = xmax - xmin;
+		fbconv::pack8888<Red, Green, Blue, Alpha>(pixel, pixWriter.template getBuffer<u32>(count), count);
+		pixWriter.commit(count * BytesPerPixel);
+		pixel += count * 4;
 	}
 
 	static constexpr int BytesPerPixel = 4;
@@ -20,6 +20,7 @@
 #include "cfg/option.h"
 #include "texconv.h"
 #include "CustomTexture.h"
+#include "texture_upscaler.h"
 
 #include <algorithm>
 #include <array>
@@ -75,6 +76,7 @@ public:
 		custom_width = other.custom_width;
 		custom_height = other.custom_height;
 		custom_load_in_progress = 0;
+		upscaleJob = std::move(other.upscaleJob);
 		gpuPalette = other.gpuPalette;
 		area = other.area;
 	}
@@ -110,6 +112,7 @@ public:
 	u32 custom_height;
 	std::atomic_int custom_load_in_progress;
 	bool is_custom_replaced;	// True if the texture currently on the GPU is the custom replacement
+	std::shared_ptr<UpscaleJob> upscaleJob;	// pending xBRZ upscaling of the texture
 	bool gpuPalette;
 	u8 area;
 
@@ -146,11 +149,23 @@ public:
 		return custom_load_in_progress == 0 && custom_image_data != NULL;
 	}
 
+	// Also gives priority to the pending upscaling of textures used in the current frame
+	bool IsUpscaledTextureAvailable()
+	{
+		if (upscaleJob == nullptr)
+			return false;
+		if (upscaleJob->isDone())
+			return true;
+		textureUpscaler.touch(upscaleJob);
+		return false;
+	}
+
 	void ComputeHash();
 	bool Update();
 	virtual void UploadToGPU(int width, int height, const u8 *temp_tex_buffer, bool mipmapped, bool mipmapsIncluded = false) = 0;
 	virtual bool Force32BitTexture(TextureType type) const { return false; }
 	void CheckCustomTexture();
+	void CheckUpscaledTexture();
 	//true if : dirty or paletted texture and hashes don't match
 	bool NeedsUpdate();
 	virtual bool Delete();
@@ -158,18 +173,18 @@ public:
 	void protectVRam();
 	void unprotectVRam();
 	void invalidate();
+	void cancelUpscaling();
 
 	static bool IsGpuHandledPaletted(TSP tsp, TCW tcw, int area)
 	{
 		// Some palette textures are handled on the GPU
-		// This is currently limited to textures using nearest or bilinear filtering and not mipmapped.
+		// This is currently limited to textures that aren't mipmapped. Trilinear filtering is then the same as bilinear.
 		// In 2-volume mode, only area 0 can be handled on the gpu.
 		// Enabling texture upscaling or dumping also disables this mode.
 		return (tcw.PixelFmt == PixelPal4 || tcw.PixelFmt == PixelPal8)
 				&& config::TextureUpscale == 1
 				&& !config::DumpTextures
 				&& !custom_texture.enabled()
-				&& tsp.FilterMode <= 1
 				&& !tcw.MipMapped
 				&& !tcw.VQ_Comp
 				&& area == 0;
@@ -313,6 +313,13 @@ BaseTextureCacheData *DX11Renderer::GetTexture(TSP tsp, TCW tcw, int area)
 		// FIXME textureView
 		tf->loadCustomTexture();
 	}
+	else if (tf->IsUpscaledTextureAvailable())
+	{
+		texCache.DeleteLater(tf->texture);
+		tf->texture.reset();
+		tf->textureView.reset();
+		tf->CheckUpscaledTexture();
+	}
 	return tf;
 }
 
@@ -637,7 +644,7 @@ void DX11Renderer::setRenderState(const PolyParam *gp)
 	TileClipping clipmode = setTileClip(gp->tileclip, clip_rect);
 	DX11Texture *texture = (DX11Texture *)gp->texture;
 	int gpuPalette = texture == nullptr || !texture->gpuPalette ? 0
-			: gp->tsp.FilterMode + 1;
+			: gp->tsp.FilterMode == 0 ? 1 : 2;
 	if (gpuPalette != 0)
 	{
 		if (config::TextureFiltering == 1)
@@ -181,7 +181,7 @@ struct DX11OITRenderer : public DX11Renderer
 		int clip_rect[4] = {};
 		TileClipping clipmode = setTileClip(gp->tileclip, clip_rect);
 		int gpuPalette = gp->texture == nullptr || !gp->texture->gpuPalette ? 0
-				: gp->tsp.FilterMode + 1;
+				: gp->tsp.FilterMode == 0 ? 1 : 2;
 		if (gpuPalette != 0)
 		{
 			if (config::TextureFiltering == 1)
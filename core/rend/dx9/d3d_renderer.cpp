@@ -230,6 +230,12 @@ BaseTextureCacheData *D3DRenderer::GetTexture(TSP tsp, TCW tcw, int area)
 		tf->texture.reset();
 		tf->loadCustomTexture();
 	}
+	else if (tf->IsUpscaledTextureAvailable())
+	{
+		texCache.DeleteLater(tf->texture);
+		tf->texture.reset();
+		tf->CheckUpscaledTexture();
+	}
 	return tf;
 }
 
@@ -378,7 +384,7 @@ void D3DRenderer::setGPState(const PolyParam *gp)
 	TileClipping clipmode = setTileClip(gp->tileclip, clip_rect);
 	D3DTexture *texture = (D3DTexture *)gp->texture;
 	int gpuPalette = texture == nullptr || !texture->gpuPalette ? 0
-			: gp->tsp.FilterMode + 1;
+			: gp->tsp.FilterMode == 0 ? 1 : 2;
 	if (gpuPalette != 0)
 	{
 		if (config::TextureFiltering == 1)
@@ -56,6 +56,14 @@ void D3DTexture::UploadToGPU(int width, int height, const u8* temp_tex_buffer, b
 		}
 	}
 
+	if (texture != nullptr)
+	{
+		// Recreate the texture if its dimensions or format have changed
+		D3DSURFACE_DESC desc;
+		texture->GetLevelDesc(0, &desc);
+		if (desc.Width != (UINT)width || desc.Height != (UINT)height || desc.Format != d3dFormat)
+			texture.reset();
+	}
 	D3DLOCKED_RECT rect;
 	while (true)
 	{
@@ -0,0 +1,398 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+#include "texconv.h"
+#include <algorithm>
+#include <type_traits>
+
+#if HOST_CPU == CPU_X64 || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FBCONV_SSE2
+#endif
+
+//
+// Framebuffer pixel line conversions between 32-bit RGBA host pixels and the PVR framebuffer formats.
+// Red, Green, Blue and Alpha are the byte indexes of each component in the host pixels.
+// Lines are converted 8 pixels at a time with SSE2 when available. The remaining pixels,
+// and all pixels on other architectures, use the scalar code which the compiler may vectorize.
+//
+namespace fbconv
+{
+
+namespace detail
+{
+
+// Reduces an 8-bit component to the given number of bits, either by truncating or rounding
+template<int Bits, bool Round>
+inline u32 reduce(u32 in)
+{
+	if constexpr (Round)
+		return std::min((in + (1u << (7 - Bits))) >> (8 - Bits), 0xffu >> (8 - Bits));
+	else
+		return in >> (8 - Bits);
+}
+
+template<typename Packer>
+constexpr bool isBGRA = std::is_same_v<Packer, BGRAPacker>;
+
+#ifdef FBCONV_SSE2
+template<int Component>
+inline __m128i component(__m128i pixels)
+{
+	if constexpr (Component == 3)
+		return _mm_srli_epi32(pixels, 24);
+	else
+		return _mm_and_si128(_mm_srli_epi32(pixels, Component * 8), _mm_set1_epi32(0xff));
+}
+
+template<int Bits, bool Round>
+inline __m128i reduce(__m128i in)
+{
+	if constexpr (Round)
+	{
+		__m128i out = _mm_srli_epi32(_mm_add_epi32(in, _mm_set1_epi32(1 << (7 - Bits))), 8 - Bits);
+		// values are less than 0x8000 so the high 16 bits stay zero
+		return _mm_min_epi16(out, _mm_set1_epi32(0xff >> (8 - Bits)));
+	}
+	else {
+		return _mm_srli_epi32(in, 8 - Bits);
+	}
+}
+
+// Packs the low 16 bits of each 32-bit lane
+inline __m128i packLow16(__m128i lo, __m128i hi)
+{
+	// sign-extend so that the signed saturation doesn't alter the values
+	lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+	hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+	return _mm_packs_epi32(lo, hi);
+}
+#endif
+
+template<typename Format>
+void pack16(const u8 *src, u16 *dst, u32 count, const Format& format)
+{
+	u32 i = 0;
+#ifdef FBCONV_SSE2
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i lo = _mm_loadu_si128((const __m128i *)&src[i * 4]);
+		__m128i hi = _mm_loadu_si128((const __m128i *)&src[i * 4 + 16]);
+		_mm_storeu_si128((__m128i *)&dst[i], packLow16(format(lo), format(hi)));
+	}
+#endif
+	for (; i < count; i++)
+		dst[i] = (u16)format(&src[i * 4]);
+}
+
+template<typename Format>
+void pack32(const u8 *src, u32 *dst, u32 count, const Format& format)
+{
+	u32 i = 0;
+#ifdef FBCONV_SSE2
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128((__m128i *)&dst[i], format(_mm_loadu_si128((const __m128i *)&src[i * 4])));
+#endif
+	for (; i < count; i++)
+		dst[i] = format(&src[i * 4]);
+}
+
+template<typename Format>
+void unpack16(const u16 *src, u32 *dst, u32 count, const Format& format)
+{
+	u32 i = 0;
+#ifdef FBCONV_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i pixels = _mm_loadu_si128((const __m128i *)&src[i]);
+		_mm_storeu_si128((__m128i *)&dst[i], format(_mm_unpacklo_epi16(pixels, zero)));
+		_mm_storeu_si128((__m128i *)&dst[i + 4], format(_mm_unpackhi_epi16(pixels, zero)));
+	}
+#endif
+	for (; i < count; i++)
+		dst[i] = format(src[i]);
+}
+
+// 0555 KRGB
+template<int Red, int Green, int Blue, bool Round>
+struct Format0555
+{
+	u32 kval;
+
+	u32 operator()(const u8 *p) const {
+		return (reduce<5, Round>(p[Red]) << 10) | (reduce<5, Round>(p[Green]) << 5) | reduce<5, Round>(p[Blue]) | kval;
+	}
+#ifdef FBCONV_SSE2
+	__m128i operator()(__m128i p) const
+	{
+		__m128i v = _mm_slli_epi32(reduce<5, Round>(component<Red>(p)), 10);
+		v = _mm_or_si128(v, _mm_slli_epi32(reduce<5, Round>(component<Green>(p)), 5));
+		v = _mm_or_si128(v, reduce<5, Round>(component<Blue>(p)));
+		return _mm_or_si128(v, _mm_set1_epi32(kval));
+	}
+#endif
+};
+
+// 565 RGB
+template<int Red, int Green, int Blue, bool Round>
+struct Format565
+{
+	u32 operator()(const u8 *p) const {
+		return (reduce<5, Round>(p[Red]) << 11) | (reduce<6, Round>(p[Green]) << 5) | reduce<5, Round>(p[Blue]);
+	}
+#ifdef FBCONV_SSE2
+	__m128i operator()(__m128i p) const
+	{
+		__m128i v = _mm_slli_epi32(reduce<5, Round>(component<Red>(p)), 11);
+		v = _mm_or_si128(v, _mm_slli_epi32(reduce<6, Round>(component<Green>(p)), 5));
+		return _mm_or_si128(v, reduce<5, Round>(component<Blue>(p)));
+	}
+#endif
+};
+
+// 4444 ARGB
+template<int Red, int Green, int Blue, int Alpha, bool Round>
+struct Format4444
+{
+	u32 operator()(const u8 *p) const {
+		return (reduce<4, Round>(p[Alpha]) << 12) | (reduce<4, Round>(p[Red]) << 8)
+				| (reduce<4, Round>(p[Green]) << 4) | reduce<4, Round>(p[Blue]);
+	}
+#ifdef FBCONV_SSE2
+	__m128i operator()(__m128i p) const
+	{
+		__m128i v = _mm_slli_epi32(reduce<4, Round>(component<Alpha>(p)), 12);
+		v = _mm_or_si128(v, _mm_slli_epi32(reduce<4, Round>(component<Red>(p)), 8));
+		v = _mm_or_si128(v, _mm_slli_epi32(reduce<4, Round>(component<Green>(p)), 4));
+		return _mm_or_si128(v, reduce<4, Round>(component<Blue>(p)));
+	}
+#endif
+};
+
+// 1555 ARGB. Alpha is set if the source alpha is greater or equal to the threshold.
+template<int Red, int Green, int Blue, int Alpha, bool Round>
+struct Format1555
+{
+	u32 alphaThreshold;
+
+	u32 operator()(const u8 *p) const {
+		return (reduce<5, Round>(p[Red]) << 10) | (reduce<5, Round>(p[Green]) << 5) | reduce<5, Round>(p[Blue])
+				| (p[Alpha] >= alphaThreshold ? 0x8000 : 0);
+	}
+#ifdef FBCONV_SSE2
+	__m128i operator()(__m128i p) const
+	{
+		__m128i v = _mm_slli_epi32(reduce<5, Round>(component<Red>(p)), 10);
+		v = _mm_or_si128(v, _mm_slli_epi32(reduce<5, Round>(component<Green>(p)), 5));
+		v = _mm_or_si128(v, reduce<5, Round>(component<Blue>(p)));
+		__m128i alpha = _mm_cmpgt_epi32(component<Alpha>(p), _mm_set1_epi32((int)alphaThreshold - 1));
+		return _mm_or_si128(v, _mm_and_si128(alpha, _mm_set1_epi32(0x8000)));
+	}
+#endif
+};
+
+// 0888 KRGB and 8888 ARGB. The alpha or K value is or'ed.
+template<int Red, int Green, int Blue, int Alpha, bool UseAlpha>
+struct Format8888
+{
+	u32 kval;
+
+	u32 operator()(const u8 *p) const
+	{
+		u32 v = (p[Red] << 16) | (p[Green] << 8) | p[Blue] | kval;
+		if constexpr (UseAlpha)
+			v |= p[Alpha] << 24;
+		return v;
+	}
+#ifdef FBCONV_SSE2
+	__m128i operator()(__m128i p) const
+	{
+		__m128i v = _mm_slli_epi32(component<Red>(p), 16);
+		v = _mm_or_si128(v, _mm_slli_epi32(component<Green>(p), 8));
+		v = _mm_or_si128(v, component<Blue>(p));
+		if constexpr (UseAlpha)
+			v = _mm_or_si128(v, _mm_slli_epi32(component<Alpha>(p), 24));
+		return _mm_or_si128(v, _mm_set1_epi32(kval));
+	}
+#endif
+};
+
+// Host pixel from 8-bit components in the lowest byte of each lane
+template<typename Packer>
+struct HostPixel
+{
+#ifdef FBCONV_SSE2
+	static __m128i pack(__m128i r, __m128i g, __m128i b)
+	{
+		__m128i v = _mm_or_si128(_mm_slli_epi32(g, 8), _mm_set1_epi32(0xff000000));
+		if constexpr (isBGRA<Packer>)
+			return _mm_or_si128(v, _mm_or_si128(_mm_slli_epi32(r, 16), b));
+		else
+			return _mm_or_si128(v, _mm_or_si128(r, _mm_slli_epi32(b, 16)));
+	}
+#endif
+};
+
+// 0555 RGB to host
+template<typename Packer>
+struct Read0555
+{
+	u32 concat;
+
+	u32 operator()(u16 s) const {
+		return Packer::pack((((s >> 10) & 0x1F) << 3) | concat, (((s >> 5) & 0x1F) << 3) | concat, ((s & 0x1F) << 3) | concat, 0xff);
+	}
+#ifdef FBCONV_SSE2
+	__m128i operator()(__m128i s) const
+	{
+		const __m128i mask = _mm_set1_epi32(0x1f << 3);
+		const __m128i c = _mm_set1_epi32(concat);
+		__m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(s, 7), mask), c);
+		__m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(s, 2), mask), c);
+		__m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(s, 3), mask), c);
+		return HostPixel<Packer>::pack(r, g, b);
+	}
+#endif
+};
+
+// 565 RGB to host
+template<typename Packer>
+struct Read565
+{
+	u32 concat;
+
+	u32 operator()(u16 s) const {
+		return Packer::pack((((s >> 11) & 0x1F) << 3) | concat, (((s >> 5) & 0x3F) << 2) | (concat & 3), ((s & 0x1F) << 3) | concat, 0xff);
+	}
+#ifdef FBCONV_SSE2
+	__m128i operator()(__m128i s) const
+	{
+		const __m128i mask = _mm_set1_epi32(0x1f << 3);
+		const __m128i c = _mm_set1_epi32(concat);
+		__m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(s, 8), mask), c);
+		__m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(s, 3), _mm_set1_epi32(0x3f << 2)), _mm_set1_epi32(concat & 3));
+		__m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(s, 3), mask), c);
+		return HostPixel<Packer>::pack(r, g, b);
+	}
+#endif
+};
+
+// 0888 KRGB to host
+template<typename Packer>
+struct Read0888
+{
+	u32 operator()(u32 s) const {
+		return Packer::pack(s >> 16, s >> 8, s, 0xff);
+	}
+#ifdef FBCONV_SSE2
+	__m128i operator()(__m128i s) const {
+		return HostPixel<Packer>::pack(component<2>(s), component<1>(s), component<0>(s));
+	}
+#endif
+};
+
+}	// namespace detail
+
+// Conversions from host pixels. Round is true to round the components, false to truncate them.
+
+template<int Red, int Green, int Blue, int Alpha, bool Round>
+void pack0555(const u8 *src, u16 *dst, u32 count, u16 kvalBit) {
+	detail::pack16(src, dst, count, detail::Format0555<Red, Green, Blue, Round>{ kvalBit });
+}
+
+template<int Red, int Green, int Blue, int Alpha, bool Round>
+void pack565(const u8 *src, u16 *dst, u32 count) {
+	detail::pack16(src, dst, count, detail::Format565<Red, Green, Blue, Round>{});
+}
+
+template<int Red, int Green, int Blue, int Alpha, bool Round>
+void pack4444(const u8 *src, u16 *dst, u32 count) {
+	detail::pack16(src, dst, count, detail::Format4444<Red, Green, Blue, Alpha, Round>{});
+}
+
+template<int Red, int Green, int Blue, int Alpha, bool Round>
+void pack1555(const u8 *src, u16 *dst, u32 count, u8 alphaThreshold) {
+	detail::pack16(src, dst, count, detail::Format1555<Red, Green, Blue, Alpha, Round>{ alphaThreshold });
+}
+
+// 24-bit packed, blue first
+template<int Red, int Green, int Blue, int Alpha>
+void pack888(const u8 *src, u8 *dst, u32 count)
+{
+	for (u32 i = 0; i < count; i++)
+	{
+		dst[0] = src[Blue];
+		dst[1] = src[Green];
+		dst[2] = src[Red];
+		src += 4;
+		dst += 3;
+	}
+}
+
+// kval is the K value already shifted in the upper byte
+template<int Red, int Green, int Blue, int Alpha>
+void pack0888(const u8 *src, u32 *dst, u32 count, u32 kval) {
+	detail::pack32(src, dst, count, detail::Format8888<Red, Green, Blue, Alpha, false>{ kval });
+}
+
+template<int Red, int Green, int Blue, int Alpha>
+void pack8888(const u8 *src, u32 *dst, u32 count) {
+	detail::pack32(src, dst, count, detail::Format8888<Red, Green, Blue, Alpha, true>{ 0 });
+}
+
+// Conversions to host pixels. fb_concat is or'ed to the low bits of the components.
+
+template<typename Packer>
+void unpack0555(const u16 *src, u32 *dst, u32 count, u32 concat) {
+	detail::unpack16(src, dst, count, detail::Read0555<Packer>{ concat });
+}
+
+template<typename Packer>
+void unpack565(const u16 *src, u32 *dst, u32 count, u32 concat) {
+	detail::unpack16(src, dst, count, detail::Read565<Packer>{ concat });
+}
+
+template<typename Packer>
+void unpack0888(const u32 *src, u32 *dst, u32 count)
+{
+	const detail::Read0888<Packer> format;
+	u32 i = 0;
+#ifdef FBCONV_SSE2
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128((__m128i *)&dst[i], format(_mm_loadu_si128((const __m128i *)&src[i])));
+#endif
+	for (; i < count; i++)
+		dst[i] = format(src[i]);
+}
+
+// 24-bit packed, blue first. Reads (count * 3 + 3) / 4 words.
+template<typename Packer>
+void unpack888(const u32 *src, u32 *dst, u32 count)
+{
+	const u8 *p = (const u8 *)src;
+	for (u32 i = 0; i < count; i++)
+	{
+		dst[i] = Packer::pack(p[2], p[1], p[0], 0xff);
+		p += 3;
+	}
+}
+
+}	// namespace fbconv
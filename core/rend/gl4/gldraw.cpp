@@ -115,7 +115,7 @@ static void SetGPState(const PolyParam* gp)
 	int clip_rect[4] = {};
 	TileClipping clipmode = GetTileClip(gp->tileclip, ViewportMatrix, clip_rect);
 	int gpuPalette = gp->texture == nullptr || !gp->texture->gpuPalette ? 0
-			: gp->tsp.FilterMode + 1;
+			: gp->tsp.FilterMode == 0 ? 1 : 2;
 	if (gpuPalette != 0)
 	{
 		if (config::TextureFiltering == 1)
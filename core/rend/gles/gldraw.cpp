@@ -141,7 +141,7 @@ void SetGPState(const PolyParam* gp,u32 cflip=0)
 	TileClipping clipmode = setTileClip(gp->tileclip, clip_rect);
 	TextureCacheData *texture = (TextureCacheData *)gp->texture;
 	int gpuPalette = texture == nullptr || !texture->gpuPalette ? 0
-			: gp->tsp.FilterMode + 1;
+			: gp->tsp.FilterMode == 0 ? 1 : 2;
 	if (gpuPalette != 0)
 	{
 		if (config::TextureFiltering == 1)
@@ -12,11 +12,13 @@
 #include "wsi/gl_context.h"
 #include "emulator.h"
 #include "naomi2.h"
+#include "rend/pipeline_keys.h"
 
 #ifdef TEST_AUTOMATION
 #include "cfg/cfg.h"
 #endif
 
+#include <chrono>
 #include <cmath>
 #include <memory>
 
@@ -444,8 +446,15 @@ void do_swap_automation()
 
 #endif
 
+// Programs used by the current game. Saved when the renderer is terminated.
+static PipelineKeyStore programKeys("gl", 1);
+// Programs used the last time the game ran that haven't been compiled yet
+static std::vector<u32> programsToPrecompile;
+
 static void gl_delete_shaders()
 {
+	programKeys.save();
+	programsToPrecompile.clear();
 	for (const auto& it : gl.shaders)
 	{
 		if (it.second.program != 0)
@@ -750,11 +759,32 @@ PipelineShader *GetProgram(bool cp_AlphaTest, bool pp_InsideClipping,
 		shader->divPosZ = !settings.platform.isNaomi2() && config::NativeDepthInterpolation;
 		shader->dithering = dithering;
 		CompilePipelineShader(shader);
+		programKeys.add(rv);
 	}
 
 	return shader;
 }
 
+// Compile some of the programs used by the game the last time it ran.
+// Shared contexts aren't available on all platforms so this is done on the render thread within a time budget.
+static void precompilePrograms()
+{
+	using the_clock = std::chrono::steady_clock;
+	const auto deadline = the_clock::now() + std::chrono::milliseconds(2);
+	const u32 divPosZ = !settings.platform.isNaomi2() && config::NativeDepthInterpolation;
+	while (!programsToPrecompile.empty() && the_clock::now() < deadline)
+	{
+		const u32 key = programsToPrecompile.back();
+		programsToPrecompile.pop_back();
+		if (((key >> 1) & 1) != divPosZ)
+			continue;
+		GetProgram((key >> 17) & 1, (key >> 18) & 1,
+				(key >> 16) & 1, (key >> 15) & 1, (key >> 14) & 1, (key >> 12) & 3, (key >> 11) & 1,
+				(key >> 9) & 3, (key >> 8) & 1, (key >> 7) & 1, (key >> 6) & 1, (key >> 5) & 1,
+				(key >> 3) & 3, (key >> 2) & 1, key & 1);
+	}
+}
+
 class VertexSource : public OpenGlSource
 {
 public:
@@ -986,6 +1016,12 @@ bool OpenGLRenderer::Init()
 	TextureCacheData::SetDirectXColorOrder(false);
 	TextureCacheData::setUploadToGPUFlavor();
 
+	programsToPrecompile.clear();
+	for (u64 key : programKeys.load())
+		programsToPrecompile.push_back((u32)key);
+	if (!programsToPrecompile.empty())
+		INFO_LOG(RENDERER, "Precompiling %d shader programs", (int)programsToPrecompile.size());
+
 	return true;
 }
 
@@ -1093,6 +1129,8 @@ bool OpenGLRenderer::renderFrame(int width, int height)
 {
 	if (!config::EmulateFramebuffer)
 		initVideoRoutingFrameBuffer();
+	// before the per-frame uniforms are set
+	precompilePrograms();
 	
 	bool is_rtt = pvrrc.isRTT;
 
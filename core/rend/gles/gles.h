@@ -452,6 +452,10 @@ public:
 	}
 	TextureCacheData(TextureCacheData&& other) : BaseTextureCacheData(std::move(other)) {
 		std::swap(texID, other.texID);
+		storageWidth = other.storageWidth;
+		storageHeight = other.storageHeight;
+		storageFormat = other.storageFormat;
+		storageLevels = other.storageLevels;
 	}
 
 	GLuint texID = 0;   //gl texture
@@ -466,6 +470,12 @@ private:
 	void UploadToGPUGl4(int width, int height, const u8 *temp_tex_buffer, bool mipmapped, bool mipmapsIncluded);
 
 	static void (TextureCacheData::*uploadToGpu)(int, int, const u8 *, bool, bool);
+
+	// Immutable storage of texID (GL 4.2 / GLES 3)
+	int storageWidth = 0;
+	int storageHeight = 0;
+	GLuint storageFormat = 0;
+	int storageLevels = 0;
 };
 
 class GlTextureCache final : public BaseTextureCache<TextureCacheData>
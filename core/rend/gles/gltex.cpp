@@ -94,11 +94,22 @@ void TextureCacheData::UploadToGPUGl4(int width, int height, const u8 *temp_tex_
 			dim >>= 1;
 		}
 	}
+	if (texID != 0 && (width != storageWidth || height != storageHeight
+			|| internalFormat != storageFormat || mipmapLevels != storageLevels))
+	{
+		// Texture storage is immutable and must be recreated if the texture size or format have changed
+		TexCache.DeleteLater(texID);
+		texID = 0;
+	}
 	if (texID == 0)
 	{
 		texID = glcache.GenTexture();
 		glcache.BindTexture(GL_TEXTURE_2D, texID);
 		glTexStorage2D(GL_TEXTURE_2D, mipmapLevels, internalFormat, width, height);
+		storageWidth = width;
+		storageHeight = height;
+		storageFormat = internalFormat;
+		storageLevels = mipmapLevels;
 	}
 	else {
 		glcache.BindTexture(GL_TEXTURE_2D, texID);
@@ -288,6 +299,12 @@ BaseTextureCacheData *OpenGLRenderer::GetTexture(TSP tsp, TCW tcw, int area)
 		tf->texID = 0;
 		tf->CheckCustomTexture();
 	}
+	else if (tf->IsUpscaledTextureAvailable())
+	{
+		TexCache.DeleteLater(tf->texID);
+		tf->texID = 0;
+		tf->CheckUpscaledTexture();
+	}
 
 	return tf;
 }
@@ -0,0 +1,72 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "pipeline_keys.h"
+#include "oslib/oslib.h"
+#include <nowide/cstdio.hpp>
+#include <cctype>
+#include <cinttypes>
+
+std::vector<u64> PipelineKeyStore::load()
+{
+	save();
+	keys.clear();
+	path.clear();
+	if (settings.content.gameId.empty())
+		return {};
+	std::string gameId = settings.content.gameId;
+	for (char& c : gameId)
+		if (!isalnum((u8)c))
+			c = '_';
+	path = hostfs::getShaderCachePath(gameId + "." + name + ".keys");
+
+	FILE *f = nowide::fopen(path.c_str(), "r");
+	if (f == nullptr)
+		return {};
+	int fileVersion = -1;
+	if (fscanf(f, "v%d", &fileVersion) == 1 && fileVersion == version)
+	{
+		u64 key;
+		while (fscanf(f, " %" SCNx64, &key) == 1)
+			keys.insert(key);
+		INFO_LOG(RENDERER, "Loaded %d pipeline keys from %s", (int)keys.size(), path.c_str());
+	}
+	else {
+		INFO_LOG(RENDERER, "Ignoring outdated pipeline keys file %s", path.c_str());
+	}
+	std::fclose(f);
+
+	return getKeys();
+}
+
+void PipelineKeyStore::save()
+{
+	if (!dirty || path.empty())
+		return;
+	dirty = false;
+	FILE *f = nowide::fopen(path.c_str(), "w");
+	if (f == nullptr)
+	{
+		WARN_LOG(RENDERER, "Can't save pipeline keys to %s", path.c_str());
+		return;
+	}
+	fprintf(f, "v%d\n", version);
+	for (u64 key : keys)
+		fprintf(f, "%" PRIx64 "\n", key);
+	std::fclose(f);
+}
@@ -0,0 +1,61 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+//
+// Per-game set of the pipeline/shader keys used by a renderer.
+// They are saved in the shader cache directory and precompiled when the game is started again.
+//
+class PipelineKeyStore
+{
+public:
+	// name identifies the renderer and version the format of its keys
+	PipelineKeyStore(const char *name, int version)
+		: name(name), version(version) {}
+
+	~PipelineKeyStore() {
+		save();
+	}
+
+	// Loads the keys of the current game. Returns the loaded keys.
+	std::vector<u64> load();
+
+	void add(u64 key)
+	{
+		if (!path.empty() && keys.insert(key).second)
+			dirty = true;
+	}
+
+	std::vector<u64> getKeys() const {
+		return std::vector<u64>(keys.begin(), keys.end());
+	}
+
+	void save();
+
+private:
+	const char * const name;
+	const int version;
+	std::string path;
+	std::unordered_set<u64> keys;
+	bool dirty = false;
+};
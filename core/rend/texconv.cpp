@@ -27,6 +27,7 @@ u32 palette32_ram[1024];
 u32 pal_hash_256[4];
 u32 pal_hash_16[64];
 extern bool pal_needs_update;
+extern u64 pal_dirty_banks;
 
 u32 detwiddle[2][11][1024];
 //input : address in the yyyyyxxxxx format
@@ -78,40 +79,35 @@ static OnLoad _([]() {
 	}
 });
 
-void palette_update()
+static void convertPalette(int first, int end)
 {
-	if (!pal_needs_update)
-		return;
-	pal_needs_update = false;
-	rend_updatePalette();
-
 	if (!isDirectX(config::RendererType))
 	{
 		switch (PAL_RAM_CTRL & 3)
 		{
 		case 0:
-			for (int i = 0; i < 1024; i++) {
+			for (int i = first; i < end; i++) {
 				palette16_ram[i] = Unpacker1555::unpack(PALETTE_RAM[i]);
 				palette32_ram[i] = Unpacker1555_32<RGBAPacker>::unpack(PALETTE_RAM[i]);
 			}
 			break;
 
 		case 1:
-			for (int i = 0; i < 1024; i++) {
+			for (int i = first; i < end; i++) {
 				palette16_ram[i] = UnpackerNop<u16>::unpack(PALETTE_RAM[i]);
 				palette32_ram[i] = Unpacker565_32<RGBAPacker>::unpack(PALETTE_RAM[i]);
 			}
 			break;
 
 		case 2:
-			for (int i = 0; i < 1024; i++) {
+			for (int i = first; i < end; i++) {
 				palette16_ram[i] = Unpacker4444::unpack(PALETTE_RAM[i]);
 				palette32_ram[i] = Unpacker4444_32<RGBAPacker>::unpack(PALETTE_RAM[i]);
 			}
 			break;
 
 		case 3:
-			for (int i = 0; i < 1024; i++)
+			for (int i = first; i < end; i++)
 				palette32_ram[i] = Unpacker8888<RGBAPacker>::unpack(PALETTE_RAM[i]);
 			break;
 		}
@@ -121,36 +117,61 @@ void palette_update()
 		switch (PAL_RAM_CTRL & 3)
 		{
 		case 0:
-			for (int i = 0; i < 1024; i++) {
+			for (int i = first; i < end; i++) {
 				palette16_ram[i] = UnpackerNop<u16>::unpack(PALETTE_RAM[i]);
 				palette32_ram[i] = Unpacker1555_32<BGRAPacker>::unpack(PALETTE_RAM[i]);
 			}
 			break;
 
 		case 1:
-			for (int i = 0; i < 1024; i++) {
+			for (int i = first; i < end; i++) {
 				palette16_ram[i] = UnpackerNop<u16>::unpack(PALETTE_RAM[i]);
 				palette32_ram[i] = Unpacker565_32<BGRAPacker>::unpack(PALETTE_RAM[i]);
 			}
 			break;
 
 		case 2:
-			for (int i = 0; i < 1024; i++) {
+			for (int i = first; i < end; i++) {
 				palette16_ram[i] = UnpackerNop<u16>::unpack(PALETTE_RAM[i]);
 				palette32_ram[i] = Unpacker4444_32<BGRAPacker>::unpack(PALETTE_RAM[i]);
 			}
 			break;
 
 		case 3:
-			for (int i = 0; i < 1024; i++)
+			for (int i = first; i < end; i++)
 				palette32_ram[i] = UnpackerNop<u32>::unpack(PALETTE_RAM[i]);
 			break;
 		}
 	}
-	for (std::size_t i = 0; i < std::size(pal_hash_16); i++)
-		pal_hash_16[i] = XXH32(&PALETTE_RAM[i << 4], 16 * 4, 7);
+}
+
+void palette_update()
+{
+	// A full update is needed when the palette format changes
+	const u64 dirtyBanks = pal_needs_update ? ~0ull : pal_dirty_banks;
+	if (dirtyBanks == 0)
+		return;
+	pal_needs_update = false;
+	pal_dirty_banks = 0;
+	rend_updatePalette();
+
+	for (u32 bank = 0; bank < std::size(pal_hash_16); )
+	{
+		if ((dirtyBanks & (1ull << bank)) == 0) {
+			bank++;
+			continue;
+		}
+		// convert consecutive dirty banks at once
+		u32 end = bank + 1;
+		while (end < std::size(pal_hash_16) && (dirtyBanks & (1ull << end)) != 0)
+			end++;
+		convertPalette(bank << 4, end << 4);
+		for (; bank < end; bank++)
+			pal_hash_16[bank] = XXH32(&PALETTE_RAM[bank << 4], 16 * 4, 7);
+	}
 	for (std::size_t i = 0; i < std::size(pal_hash_256); i++)
-		pal_hash_256[i] = XXH32(&PALETTE_RAM[i << 8], 256 * 4, 7);
+		if ((dirtyBanks >> (i * 16)) & 0xffff)
+			pal_hash_256[i] = XXH32(&PALETTE_RAM[i << 8], 256 * 4, 7);
 }
 
 template<typename Packer>
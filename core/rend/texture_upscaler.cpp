@@ -0,0 +1,174 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "texture_upscaler.h"
+#include "deps/xbrz/xbrz.h"
+#include "hw/pvr/Renderer_if.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+
+#include <algorithm>
+#include <xxhash.h>
+
+TextureUpscaler textureUpscaler;
+
+// Max number of textures waiting to be upscaled
+constexpr size_t MaxQueuedJobs = 64;
+// Max size of the upscaled textures kept in cache
+constexpr size_t MaxCacheSize = 64_MB;
+
+static const xbrz::ScalerCfg xbrzConfig;
+
+UpscaleJob::UpscaleJob(const u32 *pixels, int width, int height, int factor, bool hasAlpha)
+	: width(width), height(height), factor(factor), hasAlpha(hasAlpha), lastUsed(FrameCount)
+{
+	const u64 seed = (u64)width | ((u64)height << 16) | ((u64)factor << 32) | ((u64)hasAlpha << 40);
+	hash = XXH64(pixels, width * height * sizeof(u32), seed);
+}
+
+std::shared_ptr<UpscaleJob> TextureUpscaler::upscale(const u32 *pixels, int width, int height, int factor, bool hasAlpha)
+{
+	std::shared_ptr<UpscaleJob> job = std::make_shared<UpscaleJob>(pixels, width, height, factor, hasAlpha);
+	std::lock_guard<std::mutex> _(mutex);
+	auto it = cache.find(job->hash);
+	if (it != cache.end())
+	{
+		cacheList.splice(cacheList.begin(), cacheList, it->second);
+		job->result = it->second->second;
+		job->state = UpscaleJob::Done;
+		return job;
+	}
+	job->source.assign(pixels, pixels + width * height);
+	enqueue(job);
+
+	return job;
+}
+
+void TextureUpscaler::enqueue(const std::shared_ptr<UpscaleJob>& job)
+{
+	if (workers.empty())
+	{
+		const int threadCount = std::clamp((int)std::thread::hardware_concurrency() - 1, 1, std::max<int>(config::MaxThreads, 1));
+		for (int i = 0; i < threadCount; i++)
+			workers.push_back(std::make_unique<WorkerThread>("TexUpscaler"));
+	}
+	if (queue.size() >= MaxQueuedJobs)
+	{
+		// Drop the least recently used texture
+		auto it = std::min_element(queue.begin(), queue.end(), [](const auto& a, const auto& b) {
+			return a->lastUsed < b->lastUsed || (a->lastUsed == b->lastUsed && a->seq > b->seq);
+		});
+		(*it)->state = UpscaleJob::Dropped;
+		queue.erase(it);
+	}
+	job->seq = nextSeq++;
+	job->state = UpscaleJob::Queued;
+	queue.push_back(job);
+	// Each task upscales the best queued job when it runs
+	workers[nextWorker]->run([this]() {
+		processJob();
+	});
+	nextWorker = (nextWorker + 1) % workers.size();
+}
+
+void TextureUpscaler::touch(const std::shared_ptr<UpscaleJob>& job)
+{
+	job->lastUsed = FrameCount;
+	if (job->state != UpscaleJob::Dropped)
+		return;
+	std::lock_guard<std::mutex> _(mutex);
+	if (job->state == UpscaleJob::Dropped)
+		enqueue(job);
+}
+
+void TextureUpscaler::cancel(const std::shared_ptr<UpscaleJob>& job)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	job->state = UpscaleJob::Cancelled;
+	auto it = std::find(queue.begin(), queue.end(), job);
+	if (it != queue.end())
+		queue.erase(it);
+}
+
+void TextureUpscaler::processJob()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (queue.empty())
+		// dropped or cancelled jobs
+		return;
+	// Textures used in the most recent frame first, then in submission order
+	auto it = std::max_element(queue.begin(), queue.end(), [](const auto& a, const auto& b) {
+		return a->lastUsed < b->lastUsed || (a->lastUsed == b->lastUsed && a->seq > b->seq);
+	});
+	std::shared_ptr<UpscaleJob> job = *it;
+	queue.erase(it);
+	job->state = UpscaleJob::Running;
+	lock.unlock();
+
+	auto pixels = std::make_shared<std::vector<u32>>((size_t)job->getWidth() * job->getHeight());
+	xbrz::scale(job->factor, job->source.data(), pixels->data(), job->width, job->height,
+			job->hasAlpha ? xbrz::ColorFormat::ARGB : xbrz::ColorFormat::RGB, xbrzConfig);
+
+	lock.lock();
+	addToCache(job->hash, pixels);
+	if (job->state == UpscaleJob::Running)
+	{
+		job->source = {};
+		job->result = std::move(pixels);
+		job->state = UpscaleJob::Done;
+	}
+}
+
+void TextureUpscaler::addToCache(u64 hash, const std::shared_ptr<const std::vector<u32>>& pixels)
+{
+	auto it = cache.find(hash);
+	if (it != cache.end())
+	{
+		cacheList.splice(cacheList.begin(), cacheList, it->second);
+		return;
+	}
+	cacheList.emplace_front(hash, pixels);
+	cache[hash] = cacheList.begin();
+	cacheSize += pixels->size() * sizeof(u32);
+	while (cacheSize > MaxCacheSize && cacheList.size() > 1)
+	{
+		cacheSize -= cacheList.back().second->size() * sizeof(u32);
+		cache.erase(cacheList.back().first);
+		cacheList.pop_back();
+	}
+}
+
+void TextureUpscaler::term()
+{
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		for (auto& job : queue)
+			job->state = UpscaleJob::Cancelled;
+		queue.clear();
+	}
+	// pending tasks find an empty queue
+	for (auto& worker : workers)
+		worker->stop();
+	workers.clear();
+	nextWorker = 0;
+
+	std::lock_guard<std::mutex> _(mutex);
+	cacheList.clear();
+	cache.clear();
+	cacheSize = 0;
+}
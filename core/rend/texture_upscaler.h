@@ -0,0 +1,107 @@
+/*
+	Copyright 2025 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+#include "util/worker_thread.h"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+//
+// Asynchronous xBRZ texture upscaling.
+// Textures are upscaled by a pool of worker threads, one texture per thread.
+// Pending jobs are processed most recently used first and the least recently used ones
+// are dropped when the queue is full. Upscaled textures are kept in a cache indexed by
+// the hash of their source pixels so that reloaded textures are available immediately.
+//
+class UpscaleJob
+{
+public:
+	UpscaleJob(const u32 *pixels, int width, int height, int factor, bool hasAlpha);
+
+	bool isDone() const {
+		return state == Done;
+	}
+	// Upscaled pixels. Only valid once the job is done.
+	const u32 *data() const {
+		return result->data();
+	}
+	int getWidth() const {
+		return width * factor;
+	}
+	int getHeight() const {
+		return height * factor;
+	}
+
+private:
+	enum State { Queued, Running, Done, Dropped, Cancelled };
+
+	std::vector<u32> source;
+	const int width;
+	const int height;
+	const int factor;
+	const bool hasAlpha;
+	u64 hash = 0;
+	u64 seq = 0;
+	std::atomic<u32> lastUsed;
+	std::atomic<State> state { Queued };
+	std::shared_ptr<const std::vector<u32>> result;
+
+	friend class TextureUpscaler;
+};
+
+class TextureUpscaler
+{
+public:
+	~TextureUpscaler() {
+		term();
+	}
+
+	// Returns a job upscaling a copy of the given pixels, which may already be done
+	// if the result is in cache.
+	std::shared_ptr<UpscaleJob> upscale(const u32 *pixels, int width, int height, int factor, bool hasAlpha);
+	// Marks the job as used in the current frame. A dropped job is queued again.
+	void touch(const std::shared_ptr<UpscaleJob>& job);
+	// The result of a cancelled job is discarded
+	void cancel(const std::shared_ptr<UpscaleJob>& job);
+	// Stops the worker threads and clears the queue and cache
+	void term();
+
+private:
+	void enqueue(const std::shared_ptr<UpscaleJob>& job);
+	void processJob();
+	void addToCache(u64 hash, const std::shared_ptr<const std::vector<u32>>& pixels);
+
+	std::vector<std::unique_ptr<WorkerThread>> workers;
+	size_t nextWorker = 0;
+	std::vector<std::shared_ptr<UpscaleJob>> queue;
+	std::mutex mutex;
+	u64 nextSeq = 0;
+
+	// Result cache, most recently used first
+	using CacheList = std::list<std::pair<u64, std::shared_ptr<const std::vector<u32>>>>;
+	CacheList cacheList;
+	std::unordered_map<u64, CacheList::iterator> cache;
+	size_t cacheSize = 0;
+};
+
+extern TextureUpscaler textureUpscaler;
@@ -52,6 +52,100 @@ BufferData::BufferData(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::Memo
 	allocation = context->GetAllocator().AllocateForBuffer(*buffer, allocInfo);
 }
 
+StreamBuffer::StreamBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage)
+	: usage(usage)
+{
+	bufferData = std::make_unique<BufferData>(size, usage);
+	// Keep the memory mapped. Subsequent map calls don't need to map it again.
+	bufferData->MapMemory();
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	bufferData->UnmapMemory();
+}
+
+vk::DeviceSize StreamBuffer::allocate(FlightManager *flightManager, vk::DeviceSize size, vk::DeviceSize alignment)
+{
+	if (pending == 0)
+	{
+		head = tail = 0;
+		wrapped = false;
+	}
+	vk::DeviceSize offset = (head + alignment - 1) / alignment * alignment;
+	if (!wrapped)
+	{
+		if (offset + size > bufferData->bufferSize)
+		{
+			// wrap around if the oldest blocks have been released
+			offset = 0;
+			if (size <= tail)
+				wrapped = true;
+			else
+				offset = ~(vk::DeviceSize)0;
+		}
+	}
+	else if (offset + size > tail)
+	{
+		offset = ~(vk::DeviceSize)0;
+	}
+	if (offset == ~(vk::DeviceSize)0)
+	{
+		reallocate(flightManager, size);
+		offset = 0;
+	}
+	head = offset + size;
+	pending++;
+
+	class BlockHolder : public Deletable
+	{
+	public:
+		BlockHolder(std::shared_ptr<StreamBuffer> streamBuffer, u32 generation, vk::DeviceSize end)
+			: streamBuffer(std::move(streamBuffer)), generation(generation), end(end) {}
+
+		~BlockHolder() override {
+			streamBuffer->release(generation, end);
+		}
+
+	private:
+		std::shared_ptr<StreamBuffer> streamBuffer;
+		u32 generation;
+		vk::DeviceSize end;
+	};
+	flightManager->addToFlight(new BlockHolder(shared_from_this(), generation, head));
+
+	return offset;
+}
+
+void StreamBuffer::release(u32 generation, vk::DeviceSize end)
+{
+	// blocks of a previous buffer
+	if (generation != this->generation)
+		return;
+	// blocks are released in allocation order
+	pending--;
+	tail = end;
+	if (wrapped && end <= head)
+		wrapped = false;
+}
+
+void StreamBuffer::reallocate(FlightManager *flightManager, vk::DeviceSize size)
+{
+	vk::DeviceSize newSize = bufferData->bufferSize * 2;
+	// room for a few frames
+	while (newSize < size * 3)
+		newSize *= 2;
+	INFO_LOG(RENDERER, "Increasing stream buffer size %zd -> %zd", (size_t)bufferData->bufferSize, (size_t)newSize);
+	bufferData->UnmapMemory();
+	flightManager->addToFlight(new Deleter(bufferData.release()));
+	bufferData = std::make_unique<BufferData>(newSize, usage);
+	bufferData->MapMemory();
+	head = tail = 0;
+	wrapped = false;
+	pending = 0;
+	generation++;
+}
+
 BufferPacker::BufferPacker()
 {
 	uniformAlignment = VulkanContext::Instance()->GetUniformBufferAlignment();
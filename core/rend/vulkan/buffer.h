@@ -23,6 +23,8 @@
 #include "vmallocator.h"
 #include "utils.h"
 
+#include <memory>
+
 struct BufferData
 {
 	BufferData(vk::DeviceSize size, vk::BufferUsageFlags usage,
@@ -84,6 +86,35 @@ private:
 	vk::BufferUsageFlags    m_usage;
 };
 
+// Host-visible buffer that stays mapped and is used as a ring for per-frame data.
+// Allocated blocks are released once the frame they were allocated for has completed.
+// In-flight blocks keep the stream buffer alive.
+class StreamBuffer : public std::enable_shared_from_this<StreamBuffer>
+{
+public:
+	StreamBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage);
+	~StreamBuffer();
+
+	// Returns the offset of a new block. The buffer is reallocated if there isn't enough free space.
+	vk::DeviceSize allocate(FlightManager *flightManager, vk::DeviceSize size, vk::DeviceSize alignment);
+
+	BufferData& getBufferData() const { return *bufferData; }
+	vk::Buffer getBuffer() const { return *bufferData->buffer; }
+
+private:
+	void release(u32 generation, vk::DeviceSize end);
+	void reallocate(FlightManager *flightManager, vk::DeviceSize size);
+
+	std::unique_ptr<BufferData> bufferData;
+	vk::BufferUsageFlags usage;
+	// used blocks are between tail and head, or after tail and before head when wrapped
+	vk::DeviceSize head = 0;
+	vk::DeviceSize tail = 0;
+	bool wrapped = false;
+	u32 pending = 0;
+	u32 generation = 0;
+};
+
 class BufferPacker
 {
 public:
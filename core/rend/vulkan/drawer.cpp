@@ -184,7 +184,7 @@ void Drawer::DrawPoly(const vk::CommandBuffer& cmdBuffer, u32 listType, bool sor
 			trilinearAlpha = 1.f - trilinearAlpha;
 	}
 	int gpuPalette = poly.texture == nullptr || !poly.texture->gpuPalette ? 0
-			: poly.tsp.FilterMode + 1;
+			: poly.tsp.FilterMode == 0 ? 1 : 2;
 	float palette_index = 0.f;
 	if (gpuPalette != 0)
 	{
@@ -332,7 +332,7 @@ void Drawer::DrawModVols(const vk::CommandBuffer& cmdBuffer, int first, int coun
 			mod_base = -1;
 		}
 	}
-	cmdBuffer.bindVertexBuffers(0, curMainBuffer, {0});
+	cmdBuffer.bindVertexBuffers(0, curMainBuffer, offsets.vertexOffset);
 	SetTileClip(cmdBuffer, 0, scissorRect);
 
 	const std::array<float, 6> pushConstants = { 1 - FPU_SHAD_SCALE.scale_factor / 256.f, 0, 0, 0, 0, 0 };
@@ -346,6 +346,7 @@ void Drawer::DrawModVols(const vk::CommandBuffer& cmdBuffer, int first, int coun
 void Drawer::UploadMainBuffer(const VertexShaderUniforms& vertexUniforms, const FragmentShaderUniforms& fragmentUniforms)
 {
 	BufferPacker packer;
+	offsets = {};
 
 	// Vertex
 	packer.add(pvrrc.verts.data(), pvrrc.verts.size() * sizeof(decltype(*pvrrc.verts.data())));
@@ -364,9 +365,15 @@ void Drawer::UploadMainBuffer(const VertexShaderUniforms& vertexUniforms, const
 		offsets.lightsOffset = packNaomi2Lights(packer);
 	}
 
-	BufferData *buffer = GetMainBuffer(packer.size());
-	packer.upload(*buffer);
-	curMainBuffer = buffer->buffer.get();
+	const vk::DeviceSize base = AllocMainBuffer(packer.size());
+	packer.upload(mainBuffer->getBufferData(), base);
+	curMainBuffer = mainBuffer->getBuffer();
+	// packed offsets are relative to the allocated block
+	for (vk::DeviceSize *offset : { &offsets.vertexOffset, &offsets.indexOffset, &offsets.modVolOffset,
+			&offsets.vertexUniformOffset, &offsets.fragmentUniformOffset, &offsets.naomi2OpaqueOffset,
+			&offsets.naomi2PunchThroughOffset, &offsets.naomi2TranslucentOffset, &offsets.naomi2ModVolOffset,
+			&offsets.naomi2TrModVolOffset, &offsets.lightsOffset })
+		*offset += base;
 }
 
 bool Drawer::Draw(const Texture *fogTexture, const Texture *paletteTexture)
@@ -423,7 +430,7 @@ bool Drawer::Draw(const Texture *fogTexture, const Texture *paletteTexture)
 	descriptorSets.bindPerFrameDescriptorSets(cmdBuffer);
 
 	// Bind vertex and index buffers
-	cmdBuffer.bindVertexBuffers(0, curMainBuffer, {0});
+	cmdBuffer.bindVertexBuffers(0, curMainBuffer, offsets.vertexOffset);
 	cmdBuffer.bindIndexBuffer(curMainBuffer, offsets.indexOffset, vk::IndexType::eUint32);
 
 	// Make sure to push constants even if not used
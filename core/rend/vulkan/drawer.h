@@ -52,46 +52,19 @@ protected:
 		}
 	}
 
-	BufferData* GetMainBuffer(u32 size, vk::BufferUsageFlags extraFlags = {})
+	// Allocates a block for the current frame in the main buffer and returns its offset
+	vk::DeviceSize AllocMainBuffer(u32 size, vk::BufferUsageFlags extraFlags = {})
 	{
-		const vk::BufferUsageFlags usageFlags
-			{ vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eUniformBuffer | extraFlags };
-		BufferData *buffer;
-		if (!mainBuffers.empty())
+		if (!mainBuffer)
 		{
-			buffer = mainBuffers.back().release();
-			mainBuffers.pop_back();
-			if (buffer->bufferSize < size)
-			{
-				// FIXME vf4evob still complains about buffer in use after 2 frames. Due to swap chain size of 3
-				commandPool->addToFlight(new Deleter(buffer));
-				u32 newSize = (u32)buffer->bufferSize;
-				while (newSize < size)
-					newSize *= 2;
-				INFO_LOG(RENDERER, "Increasing main buffer size %zd -> %d", buffer->bufferSize, newSize);
-				buffer = new BufferData(newSize, usageFlags);
-			}
-		}
-		else {
-			buffer = new BufferData(std::max(512 * 1024u, size), usageFlags);
+			const vk::BufferUsageFlags usageFlags
+				{ vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eUniformBuffer | extraFlags };
+			mainBuffer = std::make_shared<StreamBuffer>(std::max<vk::DeviceSize>(2 * 1024 * 1024, size * 3), usageFlags);
 		}
+		// suitable for any kind of data
+		const vk::DeviceSize alignment = std::max(GetContext()->GetUniformBufferAlignment(), GetContext()->GetStorageBufferAlignment());
 
-		class BufferHolder : public Deletable
-		{
-		public:
-			BufferHolder(BufferData *buffer, BaseDrawer *drawer) : buffer(buffer), drawer(drawer) {}
-
-			~BufferHolder() override {
-				drawer->mainBuffers.emplace_back(buffer);
-			}
-
-		private:
-			BufferData *buffer;
-			BaseDrawer *drawer;
-		};
-		commandPool->addToFlight(new BufferHolder(buffer, this));
-
-		return buffer;
+		return mainBuffer->allocate(commandPool, size, alignment);
 	}
 
 	template<typename T>
@@ -209,7 +182,7 @@ protected:
 	vk::Rect2D currentScissor;
 	TransformMatrix<COORD_VULKAN> matrices;
 	CommandPool *commandPool = nullptr;
-	std::vector<std::unique_ptr<BufferData>> mainBuffers;
+	std::shared_ptr<StreamBuffer> mainBuffer;
 };
 
 class Drawer : public BaseDrawer
@@ -220,7 +193,7 @@ public:
 	void Term()
 	{
 		descriptorSets.term();
-		mainBuffers.clear();
+		mainBuffer.reset();
 	}
 
 	bool Draw(const Texture *fogTexture, const Texture *paletteTexture);
@@ -267,6 +240,7 @@ private:
 
 	int imageIndex = 0;
 	struct {
+		vk::DeviceSize vertexOffset = 0;
 		vk::DeviceSize indexOffset = 0;
 		vk::DeviceSize modVolOffset = 0;
 		vk::DeviceSize vertexUniformOffset = 0;
@@ -46,7 +46,7 @@ void OITDrawer::DrawPoly(const vk::CommandBuffer& cmdBuffer, u32 listType, bool
 	bool twoVolumes = poly.tsp1.full != (u32)-1 || poly.tcw1.full != (u32)-1;
 
 	int gpuPalette = poly.texture == nullptr || !poly.texture->gpuPalette ? 0
-			: poly.tsp.FilterMode + 1;
+			: poly.tsp.FilterMode == 0 ? 1 : 2;
 	float palette_index = 0.f;
 	if (gpuPalette != 0)
 	{
@@ -220,13 +220,14 @@ void OITDrawer::DrawModifierVolumes(const vk::CommandBuffer& cmdBuffer, int firs
 			}
 		}
 	}
-	cmdBuffer.bindVertexBuffers(0, curMainBuffer, {0});
+	cmdBuffer.bindVertexBuffers(0, curMainBuffer, offsets.vertexOffset);
 }
 
 void OITDrawer::UploadMainBuffer(const OITDescriptorSets::VertexShaderUniforms& vertexUniforms,
 		const OITDescriptorSets::FragmentShaderUniforms& fragmentUniforms)
 {
 	BufferPacker packer;
+	offsets = {};
 
 	// Vertex
 	packer.add(pvrrc.verts.data(), pvrrc.verts.size() * sizeof(decltype(*pvrrc.verts.data())));
@@ -262,9 +263,15 @@ void OITDrawer::UploadMainBuffer(const OITDescriptorSets::VertexShaderUniforms&
 		offsets.lightsOffset = packNaomi2Lights(packer);
 	}
 
-	BufferData *buffer = GetMainBuffer(packer.size());
-	packer.upload(*buffer);
-	curMainBuffer = buffer->buffer.get();
+	const vk::DeviceSize base = AllocMainBuffer(packer.size());
+	packer.upload(mainBuffer->getBufferData(), base);
+	curMainBuffer = mainBuffer->getBuffer();
+	// packed offsets are relative to the allocated block
+	for (vk::DeviceSize *offset : { &offsets.vertexOffset, &offsets.indexOffset, &offsets.modVolOffset,
+			&offsets.vertexUniformOffset, &offsets.fragmentUniformOffset, &offsets.polyParamsOffset,
+			&offsets.naomi2OpaqueOffset, &offsets.naomi2PunchThroughOffset, &offsets.naomi2TranslucentOffset,
+			&offsets.naomi2ModVolOffset, &offsets.naomi2TrModVolOffset, &offsets.lightsOffset })
+		*offset += base;
 }
 
 vk::Framebuffer OITTextureDrawer::getFramebuffer(int renderPass, int renderPassCount)
@@ -359,7 +366,7 @@ bool OITDrawer::Draw(const Texture *fogTexture, const Texture *paletteTexture)
 	descriptorSets.updateColorInputDescSet(1, colorAttachments[1]->GetImageView());
 
 	// Bind vertex and index buffers
-	cmdBuffer.bindVertexBuffers(0, curMainBuffer, {0});
+	cmdBuffer.bindVertexBuffers(0, curMainBuffer, offsets.vertexOffset);
 	cmdBuffer.bindIndexBuffer(curMainBuffer, offsets.indexOffset, vk::IndexType::eUint32);
 
 	// Make sure to push constants even if not used
@@ -425,7 +432,7 @@ bool OITDrawer::Draw(const Texture *fogTexture, const Texture *paletteTexture)
 			vk::MemoryBarrier memoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
 			cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eFragmentShader,
 					vk::DependencyFlagBits::eByRegion, memoryBarrier, nullptr, nullptr);
-			cmdBuffer.bindVertexBuffers(0, curMainBuffer, {0});
+			cmdBuffer.bindVertexBuffers(0, curMainBuffer, offsets.vertexOffset);
 			firstFrameAfterInit = false;
 		}
 		if (current_pass.autosort)
@@ -464,7 +471,7 @@ bool OITDrawer::Draw(const Texture *fogTexture, const Texture *paletteTexture)
 		if (!finalPass)
 		{
 	    	// Re-bind vertex and index buffers
-	    	cmdBuffer.bindVertexBuffers(0, curMainBuffer, {0});
+	    	cmdBuffer.bindVertexBuffers(0, curMainBuffer, offsets.vertexOffset);
 	    	cmdBuffer.bindIndexBuffer(curMainBuffer, offsets.indexOffset, vk::IndexType::eUint32);
 
 			// Tr depth-only pass
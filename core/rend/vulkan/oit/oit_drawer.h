@@ -66,7 +66,7 @@ protected:
 		tempFramebuffers[1].reset();
 		depthAttachments[0].reset();
 		depthAttachments[1].reset();
-		mainBuffers.clear();
+		mainBuffer.reset();
 		descriptorSets.term();
 		maxWidth = 0;
 		maxHeight = 0;
@@ -76,8 +76,8 @@ protected:
 		descriptorSets.nextFrame();
 	}
 
-	BufferData* GetMainBuffer(u32 size) {
-		return BaseDrawer::GetMainBuffer(size, vk::BufferUsageFlagBits::eStorageBuffer);
+	vk::DeviceSize AllocMainBuffer(u32 size) {
+		return BaseDrawer::AllocMainBuffer(size, vk::BufferUsageFlagBits::eStorageBuffer);
 	}
 
 	void MakeBuffers(int width, int height, vk::ImageUsageFlags colorUsage = {});
@@ -106,6 +106,7 @@ private:
 			const OITDescriptorSets::FragmentShaderUniforms& fragmentUniforms);
 
 	struct {
+		vk::DeviceSize vertexOffset = 0;
 		vk::DeviceSize indexOffset = 0;
 		vk::DeviceSize modVolOffset = 0;
 		vk::DeviceSize vertexUniformOffset = 0;
@@ -20,6 +20,8 @@
 */
 #include "pipeline.h"
 #include "hw/pvr/Renderer_if.h"
+#include <algorithm>
+#include <thread>
 
 void PipelineManager::CreateModVolPipeline(ModVolMode mode, int cullMode, bool naomi2)
 {
@@ -270,7 +272,7 @@ void PipelineManager::CreateDepthPassPipeline(int cullMode, bool naomi2)
 					graphicsPipelineCreateInfo).value;
 }
 
-void PipelineManager::CreatePipeline(u32 listType, bool sortTriangles, const PolyParam& pp, int gpuPalette, bool dithering)
+vk::UniquePipeline PipelineManager::MakePipeline(u32 listType, bool sortTriangles, const PolyParam& pp, int gpuPalette, bool dithering)
 {
 	vk::PipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo = GetMainVertexInputStateCreateInfo(true, pp.isNaomi2());
 
@@ -432,6 +434,101 @@ void PipelineManager::CreatePipeline(u32 listType, bool sortTriangles, const Pol
 	  renderPass                                  // renderPass
 	);
 
-	pipelines[hash(listType, sortTriangles, &pp, gpuPalette, dithering)] = GetContext()->GetDevice().createGraphicsPipelineUnique(GetContext()->GetPipelineCache(),
+	return GetContext()->GetDevice().createGraphicsPipelineUnique(GetContext()->GetPipelineCache(),
 			graphicsPipelineCreateInfo).value;
 }
+
+bool PipelineManager::DecodeHash(u64 key, u32& listType, bool& sortTriangles, PolyParam& pp, int& gpuPalette, bool& dithering) const
+{
+	pp.init();
+	pp.pcw.Gouraud = key & 1;
+	pp.pcw.Offset = (key >> 1) & 1;
+	pp.pcw.Texture = (key >> 2) & 1;
+	pp.pcw.Shadow = (key >> 3) & 1;
+	if (key & (1 << 4))
+		pp.tileclip = 3 << 28;
+	listType = ((key >> 5) & 3) << 1;
+	pp.tsp.ShadInstr = (key >> 7) & 3;
+	pp.tsp.IgnoreTexA = (key >> 9) & 1;
+	pp.tsp.UseAlpha = (key >> 10) & 1;
+	pp.tsp.ColorClamp = (key >> 11) & 1;
+	pp.tsp.FogCtrl = (key >> 12) & 3;
+	pp.tsp.SrcInstr = (key >> 14) & 7;
+	pp.tsp.DstInstr = (key >> 17) & 7;
+	pp.isp.ZWriteDis = (key >> 20) & 1;
+	pp.isp.CullMode = (key >> 21) & 3;
+	pp.isp.DepthMode = (key >> 23) & 7;
+	sortTriangles = (key >> 26) & 1;
+	gpuPalette = (key >> 27) & 3;
+	if ((key >> 29) & 1)
+		pp.projMatrix = 0;
+	if ((key >> 31) & 1)
+		pp.tcw.PixelFmt = PixelBumpMap;
+	dithering = (key >> 32) & 1;
+	if ((key >> 33) & 1)
+	{
+		pp.tsp.FilterMode = 2;
+		pp.tcw.MipMapped = 1;
+	}
+	// Fails if the native depth interpolation or fog settings have changed
+	return hash(listType, sortTriangles, &pp, gpuPalette, dithering) == key;
+}
+
+void PipelineManager::Precompile(const std::vector<u64>& keys)
+{
+	if (keys.empty())
+		return;
+	cancelPrecompile = false;
+	const size_t threadCount = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+	while (compilerThreads.size() < threadCount)
+		compilerThreads.push_back(std::make_unique<WorkerThread>("VkPipelineCompiler"));
+	for (size_t i = 0; i < threadCount; i++)
+	{
+		std::vector<u64> chunk;
+		for (size_t j = i; j < keys.size(); j += threadCount)
+			chunk.push_back(keys[j]);
+		precompileTasks.push_back(compilerThreads[i]->runFuture([this, chunk]() {
+			for (u64 key : chunk)
+			{
+				if (cancelPrecompile)
+					break;
+				u32 listType;
+				bool sortTriangles;
+				PolyParam pp;
+				int gpuPalette;
+				bool dithering;
+				if (!DecodeHash(key, listType, sortTriangles, pp, gpuPalette, dithering))
+					continue;
+				try {
+					vk::UniquePipeline pipeline = MakePipeline(listType, sortTriangles, pp, gpuPalette, dithering);
+					std::lock_guard<std::mutex> _(precompiledMutex);
+					precompiled.emplace_back(key, std::move(pipeline));
+				} catch (const std::exception& e) {
+					WARN_LOG(RENDERER, "Pipeline precompilation failed: %s", e.what());
+				}
+			}
+		}));
+	}
+	INFO_LOG(RENDERER, "Precompiling %d pipelines on %d threads", (int)keys.size(), (int)threadCount);
+}
+
+void PipelineManager::WaitPrecompile()
+{
+	cancelPrecompile = true;
+	for (auto& task : precompileTasks)
+		task.get();
+	precompileTasks.clear();
+}
+
+bool PipelineManager::CollectPrecompiled()
+{
+	std::lock_guard<std::mutex> _(precompiledMutex);
+	if (precompiled.empty())
+		return false;
+	for (auto& [key, pipeline] : precompiled)
+		// pipelines already created by the render thread are kept
+		pipelines.emplace(key, std::move(pipeline));
+	precompiled.clear();
+
+	return true;
+}
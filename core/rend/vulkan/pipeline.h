@@ -25,7 +25,12 @@
 #include "utils.h"
 #include "vulkan_context.h"
 #include "desc_set.h"
+#include "rend/pipeline_keys.h"
+#include "util/worker_thread.h"
+#include "profiler/perf_counters.h"
 #include <array>
+#include <atomic>
+#include <mutex>
 #include <unordered_map>
 
 class DescriptorSets
@@ -42,7 +47,7 @@ public:
 	void updateUniforms(vk::Buffer buffer, u32 vertexUniformOffset, u32 fragmentUniformOffset, vk::ImageView fogImageView, vk::ImageView paletteImageView)
 	{
 		perFrameDescSet = perFrameAlloc.alloc();
-		perPolyDescSets.clear();
+		clearPerPolyDescSets();
 
 		std::vector<vk::DescriptorBufferInfo> bufferInfos;
 		bufferInfos.emplace_back(buffer, vertexUniformOffset, sizeof(VertexShaderUniforms));
@@ -79,6 +84,40 @@ public:
 	void bindPerPolyDescriptorSets(vk::CommandBuffer cmdBuffer, const PolyParam& poly, int polyNumber, vk::Buffer buffer,
 			vk::DeviceSize uniformOffset, vk::DeviceSize lightOffset, bool punchThrough)
 	{
+		if (!poly.isNaomi2())
+		{
+			// Texture-only descriptor sets are shared by all the polygons using the same texture and sampler
+			if (poly.texture != nullptr && poly.texture == lastTexture && poly.tsp.full == lastTsp.full
+					&& punchThrough == lastPunchThrough)
+			{
+				bind(cmdBuffer, lastTextureDescSet);
+				return;
+			}
+			TextureKey key{};
+			if (poly.texture != nullptr)
+			{
+				key.imageView = ((Texture *)poly.texture)->GetReadOnlyImageView();
+				key.sampler = samplerManager->GetSampler(poly, punchThrough);
+			}
+			vk::DescriptorSet& descSet = textureDescSets[key];
+			if (!descSet)
+			{
+				descSet = perPolyAlloc.alloc();
+				if (poly.texture != nullptr)
+				{
+					vk::DescriptorImageInfo imageInfo(key.sampler, key.imageView, vk::ImageLayout::eShaderReadOnlyOptimal);
+					vk::WriteDescriptorSet writeDescriptorSet(descSet, 0, 0, vk::DescriptorType::eCombinedImageSampler, imageInfo);
+					getContext()->GetDevice().updateDescriptorSets(writeDescriptorSet, nullptr);
+					perfcounters::add(perfcounters::DescSetUpdates);
+				}
+			}
+			lastTexture = poly.texture;
+			lastTsp = poly.tsp;
+			lastPunchThrough = punchThrough;
+			lastTextureDescSet = descSet;
+			bind(cmdBuffer, descSet);
+			return;
+		}
 		vk::DescriptorSet perPolyDescSet;
 		auto it = perPolyDescSets.find(&poly);
 		if (it == perPolyDescSets.end())
@@ -94,26 +133,22 @@ public:
 				writeDescriptorSets.emplace_back(perPolyDescSet, 0, 0, vk::DescriptorType::eCombinedImageSampler, imageInfo);
 			}
 
-			vk::DescriptorBufferInfo uniBufferInfo;
-			vk::DescriptorBufferInfo lightBufferInfo;
-			if (poly.isNaomi2())
-			{
-				const vk::DeviceSize uniformAlignment = VulkanContext::Instance()->GetUniformBufferAlignment();
-				size_t size = sizeof(N2VertexShaderUniforms) + align(sizeof(N2VertexShaderUniforms), uniformAlignment);
-				uniBufferInfo = vk::DescriptorBufferInfo{ buffer, uniformOffset + polyNumber * size, sizeof(N2VertexShaderUniforms) };
-				writeDescriptorSets.emplace_back(perPolyDescSet, 2, 0, vk::DescriptorType::eUniformBuffer, nullptr, uniBufferInfo);
-
-				size = sizeof(N2LightModel) + align(sizeof(N2LightModel), uniformAlignment);
-				lightBufferInfo = vk::DescriptorBufferInfo{ buffer, lightOffset + poly.lightModel * size, sizeof(N2LightModel) };
-				writeDescriptorSets.emplace_back(perPolyDescSet, 3, 0, vk::DescriptorType::eUniformBuffer, nullptr, lightBufferInfo);
-			}
+			const vk::DeviceSize uniformAlignment = VulkanContext::Instance()->GetUniformBufferAlignment();
+			size_t size = sizeof(N2VertexShaderUniforms) + align(sizeof(N2VertexShaderUniforms), uniformAlignment);
+			vk::DescriptorBufferInfo uniBufferInfo{ buffer, uniformOffset + polyNumber * size, sizeof(N2VertexShaderUniforms) };
+			writeDescriptorSets.emplace_back(perPolyDescSet, 2, 0, vk::DescriptorType::eUniformBuffer, nullptr, uniBufferInfo);
+
+			size = sizeof(N2LightModel) + align(sizeof(N2LightModel), uniformAlignment);
+			vk::DescriptorBufferInfo lightBufferInfo{ buffer, lightOffset + poly.lightModel * size, sizeof(N2LightModel) };
+			writeDescriptorSets.emplace_back(perPolyDescSet, 3, 0, vk::DescriptorType::eUniformBuffer, nullptr, lightBufferInfo);
 
 			getContext()->GetDevice().updateDescriptorSets(writeDescriptorSets, nullptr);
+			perfcounters::add(perfcounters::DescSetUpdates);
 			perPolyDescSets[&poly] = perPolyDescSet;
 		}
 		else
 			perPolyDescSet = it->second;
-		cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 1, perPolyDescSet, nullptr);
+		bind(cmdBuffer, perPolyDescSet);
 	}
 
 	void bindPerPolyDescriptorSets(vk::CommandBuffer cmdBuffer, const ModifierVolumeParam& mvParam, int polyNumber, vk::Buffer buffer,
@@ -133,11 +168,12 @@ public:
 			vk::WriteDescriptorSet writeDescriptorSet(perPolyDescSet, 2, 0, vk::DescriptorType::eUniformBuffer, nullptr, uniBufferInfo);
 
 			getContext()->GetDevice().updateDescriptorSets(writeDescriptorSet, nullptr);
+			perfcounters::add(perfcounters::DescSetUpdates);
 			perPolyDescSets[&mvParam] = perPolyDescSet;
 		}
 		else
 			perPolyDescSet = it->second;
-		cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 1, perPolyDescSet, nullptr);
+		bind(cmdBuffer, perPolyDescSet);
 	}
 
 	void bindPerFrameDescriptorSets(vk::CommandBuffer cmdBuffer)
@@ -150,7 +186,7 @@ public:
 		perFrameAlloc.nextFrame();
 		perPolyAlloc.nextFrame();
 		perFrameDescSet = vk::DescriptorSet{};
-		perPolyDescSets.clear();
+		clearPerPolyDescSets();
 	}
 
 	void term()
@@ -162,11 +198,58 @@ public:
 private:
 	VulkanContext *getContext() const { return VulkanContext::Instance(); }
 
+	void bind(vk::CommandBuffer cmdBuffer, vk::DescriptorSet descSet)
+	{
+		if (cmdBuffer == boundCmdBuffer && descSet == boundDescSet)
+			return;
+		cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 1, descSet, nullptr);
+		perfcounters::add(perfcounters::DescSetBinds);
+		boundCmdBuffer = cmdBuffer;
+		boundDescSet = descSet;
+	}
+
+	void clearPerPolyDescSets()
+	{
+		perPolyDescSets.clear();
+		textureDescSets.clear();
+		lastTexture = nullptr;
+		lastTextureDescSet = vk::DescriptorSet{};
+		boundCmdBuffer = vk::CommandBuffer{};
+		boundDescSet = vk::DescriptorSet{};
+	}
+
+	struct TextureKey
+	{
+		vk::ImageView imageView;
+		vk::Sampler sampler;
+
+		bool operator==(const TextureKey& other) const {
+			return imageView == other.imageView && sampler == other.sampler;
+		}
+	};
+	struct TextureKeyHash
+	{
+		size_t operator()(const TextureKey& key) const {
+			return std::hash<u64>()((u64)(VkImageView)key.imageView) ^ (std::hash<u64>()((u64)(VkSampler)key.sampler) << 1);
+		}
+	};
+
 	vk::PipelineLayout pipelineLayout;
 	DynamicDescSetAlloc perFrameAlloc;
 	DynamicDescSetAlloc perPolyAlloc;
 	vk::DescriptorSet perFrameDescSet = {};
+	// Naomi2 and modifier volume descriptor sets, by polygon
 	std::unordered_map<const void *, vk::DescriptorSet> perPolyDescSets;
+	// Texture descriptor sets, by image view and sampler
+	std::unordered_map<TextureKey, vk::DescriptorSet, TextureKeyHash> textureDescSets;
+	// Last texture descriptor set, reused for consecutive polygons with the same texture and sampler
+	const BaseTextureCacheData *lastTexture = nullptr;
+	TSP lastTsp {};
+	bool lastPunchThrough = false;
+	vk::DescriptorSet lastTextureDescSet;
+	// Currently bound per-poly descriptor set
+	vk::CommandBuffer boundCmdBuffer;
+	vk::DescriptorSet boundDescSet;
 
 	SamplerManager* samplerManager = nullptr;
 };
@@ -174,7 +257,13 @@ private:
 class PipelineManager
 {
 public:
-	virtual ~PipelineManager() = default;
+	// keyStoreName identifies the file where the pipeline keys used by each game are saved
+	PipelineManager(const char *keyStoreName = "vulkan")
+		: keyStore(keyStoreName, KeyVersion) {}
+
+	virtual ~PipelineManager() {
+		WaitPrecompile();
+	}
 
 	void Init(ShaderManager *shaderManager, vk::RenderPass renderPass)
 	{
@@ -208,17 +297,32 @@ public:
 		{
 			this->renderPass = renderPass;
 			Reset();
+			if (!keysLoaded)
+			{
+				keysLoaded = true;
+				Precompile(keyStore.load());
+			}
+			else {
+				Precompile(keyStore.getKeys());
+			}
 		}
 	}
 
 	vk::Pipeline GetPipeline(u32 listType, bool sortTriangles, const PolyParam& pp, int gpuPalette, bool dithering)
 	{
 		u64 pipehash = hash(listType, sortTriangles, &pp, gpuPalette, dithering);
-		const auto &pipeline = pipelines.find(pipehash);
+		auto pipeline = pipelines.find(pipehash);
 		if (pipeline != pipelines.end())
 			return pipeline->second.get();
+		if (CollectPrecompiled())
+		{
+			pipeline = pipelines.find(pipehash);
+			if (pipeline != pipelines.end())
+				return pipeline->second.get();
+		}
 
 		CreatePipeline(listType, sortTriangles, pp, gpuPalette, dithering);
+		keyStore.add(pipehash);
 
 		return *pipelines[pipehash];
 	}
@@ -247,6 +351,8 @@ public:
 
 	void Reset()
 	{
+		WaitPrecompile();
+		precompiled.clear();
 		pipelines.clear();
 		modVolPipelines.clear();
 	}
@@ -274,6 +380,7 @@ private:
 		hash |= (u64)(!settings.platform.isNaomi2() && config::NativeDepthInterpolation) << 30;
 		hash |= (u64)(pp->tcw.PixelFmt == PixelBumpMap) << 31;
 		hash |= (u64)dithering << 32;
+		hash |= (u64)(pp->pcw.Texture && pp->tsp.FilterMode > 1 && listType != ListType_Punch_Through && pp->tcw.MipMapped == 1) << 33;
 
 		return hash;
 	}
@@ -285,6 +392,10 @@ private:
 	{
 		return cullMode | ((int)naomi2 << 2) | ((int)(!settings.platform.isNaomi2() && config::NativeDepthInterpolation) << 3);
 	}
+	// Rebuilds the pipeline parameters from a hash. Returns false if the hash isn't valid for the current settings.
+	bool DecodeHash(u64 key, u32& listType, bool& sortTriangles, PolyParam& pp, int& gpuPalette, bool& dithering) const;
+	// Version of the pipeline hash format
+	static constexpr int KeyVersion = 1;
 
 	vk::PipelineVertexInputStateCreateInfo GetMainVertexInputStateCreateInfo(bool full = true, bool naomi2 = false) const
 	{
@@ -334,7 +445,16 @@ private:
 		);
 	}
 
-	void CreatePipeline(u32 listType, bool sortTriangles, const PolyParam& pp, int gpuPalette, bool dithering);
+	void CreatePipeline(u32 listType, bool sortTriangles, const PolyParam& pp, int gpuPalette, bool dithering) {
+		pipelines[hash(listType, sortTriangles, &pp, gpuPalette, dithering)] = MakePipeline(listType, sortTriangles, pp, gpuPalette, dithering);
+	}
+	// Can be called from any thread
+	vk::UniquePipeline MakePipeline(u32 listType, bool sortTriangles, const PolyParam& pp, int gpuPalette, bool dithering);
+
+	// Create the pipelines used by this game the last time it ran on worker threads
+	void Precompile(const std::vector<u64>& keys);
+	// Move the precompiled pipelines to the pipeline map. Returns true if any.
+	bool CollectPrecompiled();
 
 	std::map<u64, vk::UniquePipeline> pipelines;
 	std::map<u32, vk::UniquePipeline> modVolPipelines;
@@ -344,8 +464,18 @@ private:
 	vk::UniqueDescriptorSetLayout perFrameLayout;
 	vk::UniqueDescriptorSetLayout perPolyLayout;
 
+	PipelineKeyStore keyStore;
+	bool keysLoaded = false;
+	std::vector<std::unique_ptr<WorkerThread>> compilerThreads;
+	std::vector<std::future<void>> precompileTasks;
+	std::atomic<bool> cancelPrecompile { false };
+	std::mutex precompiledMutex;
+	std::vector<std::pair<u64, vk::UniquePipeline>> precompiled;
+
 protected:
 	VulkanContext *GetContext() const { return VulkanContext::Instance(); }
+	// Must be called before destroying the render pass
+	void WaitPrecompile();
 
 	vk::RenderPass renderPass;
 	ShaderManager *shaderManager = nullptr;
@@ -354,8 +484,11 @@ protected:
 class RttPipelineManager : public PipelineManager
 {
 public:
+	RttPipelineManager() : PipelineManager("vulkan_rtt") {}
+
 	void Init(ShaderManager *shaderManager)
 	{
+		WaitPrecompile();
 		// RTT render pass
 		renderToTextureBuffer = config::RenderToTextureBuffer;
 	    vk::AttachmentDescription attachmentDescriptions[] = {
@@ -23,6 +23,7 @@
 
 #include <glm/glm.hpp>
 #include <map>
+#include <mutex>
 
 struct VertexShaderParams
 {
@@ -165,6 +166,8 @@ private:
 	template<typename T>
 	vk::ShaderModule getShader(std::map<u32, vk::UniqueShaderModule>& map, T params)
 	{
+		// Shaders can be requested by pipeline compiler threads
+		std::lock_guard<std::mutex> _(mutex);
 		u32 h = params.hash();
 		auto it = map.find(h);
 		if (it != map.end())
@@ -187,4 +190,5 @@ private:
 	vk::UniqueShaderModule quadRotateVertexShader;
 	vk::UniqueShaderModule quadFragmentShader;
 	vk::UniqueShaderModule quadNoAlphaFragmentShader;
+	std::mutex mutex;
 };
@@ -185,7 +185,13 @@ void Texture::UploadToGPU(int width, int height, const u8 *data, bool mipmapped,
 	bool isNew = true;
 	if (width != (int)extent.width || height != (int)extent.height
 			|| format != this->format || !this->image)
+	{
+		// The size changes when an upscaled texture replaces the original one or the other way around.
+		// The current image may still be used by frames in flight.
+		if (this->image && flightManager != nullptr)
+			deferDeleteResource(flightManager);
 		Init(width, height, format, dataSize, mipmapped, mipmapsIncluded);
+	}
 	else
 		isNew = false;
 	SetImage(dataSize, data, isNew, mipmapped && !mipmapsIncluded);
@@ -47,6 +47,7 @@ public:
 		std::swap(needsStaging, other.needsStaging);
 		std::swap(stagingBufferData, other.stagingBufferData);
 		std::swap(commandBuffer, other.commandBuffer);
+		std::swap(flightManager, other.flightManager);
 		std::swap(allocation, other.allocation);
 		std::swap(image, other.image);
 		std::swap(imageView, other.imageView);
@@ -61,7 +62,11 @@ public:
 	vk::ImageView GetImageView() const { return *imageView; }
 	vk::Image GetImage() const { return *image; }
 	vk::ImageView GetReadOnlyImageView() const { return readOnlyImageView ? readOnlyImageView : *imageView; }
-	void SetCommandBuffer(vk::CommandBuffer commandBuffer) { this->commandBuffer = commandBuffer; }
+	// When a flight manager is given, the current image is deleted through it if it must be recreated
+	void SetCommandBuffer(vk::CommandBuffer commandBuffer, FlightManager *flightManager = nullptr) {
+		this->commandBuffer = commandBuffer;
+		this->flightManager = flightManager;
+	}
 	bool Force32BitTexture(TextureType type) const override { return !VulkanContext::Instance()->IsFormatSupported(type); }
 	vk::Extent2D getSize() const { return extent; }
 	void deferDeleteResource(FlightManager *manager);
@@ -80,6 +85,7 @@ private:
 	bool needsStaging = false;
 	std::unique_ptr<BufferData> stagingBufferData;
 	vk::CommandBuffer commandBuffer;
+	FlightManager *flightManager = nullptr;
 
 	Allocation allocation;
 	vk::UniqueImage image;
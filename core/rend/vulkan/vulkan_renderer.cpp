@@ -65,7 +65,7 @@ BaseTextureCacheData *BaseVulkanRenderer::GetTexture(TSP tsp, TCW tcw, int area)
 		// This kills performance when a frame is skipped and lots of texture updated each frame
 		//if (textureCache.IsInFlight(tf, true))
 		//	textureCache.DestroyLater(tf);
-		tf->SetCommandBuffer(texCommandBuffer);
+		tf->SetCommandBuffer(texCommandBuffer, &texCommandPool);
 		if (!tf->Update())
 		{
 			tf->SetCommandBuffer(nullptr);
@@ -78,6 +78,11 @@ BaseTextureCacheData *BaseVulkanRenderer::GetTexture(TSP tsp, TCW tcw, int area)
 		tf->SetCommandBuffer(texCommandBuffer);
 		tf->CheckCustomTexture();
 	}
+	else if (tf->IsUpscaledTextureAvailable())
+	{
+		tf->SetCommandBuffer(texCommandBuffer, &texCommandPool);
+		tf->CheckUpscaledTexture();
+	}
 	tf->SetCommandBuffer(nullptr);
 	textureCache.SetInFlight(tf);
 
@@ -1609,7 +1609,7 @@ void gui_display_profiler()
 	{
 		ImguiStyleColor _(ImGuiCol_Text, ImVec4(0.8f, 0.8f, 0.8f, 1.0f));
 
-		std::unique_lock<std::recursive_mutex> lock(fc_profiler::ProfileThread::s_allThreadsLock);
+		std::lock_guard<std::mutex> lock(fc_profiler::ProfileThread::s_allThreadsLock);
 
 		for(const fc_profiler::ProfileThread* profileThread : fc_profiler::ProfileThread::s_allThreads)
 		{
@@ -19,6 +19,7 @@
 
 #include "mainui.h"
 #include "hw/pvr/Renderer_if.h"
+#include "hw/pvr/ta_capture.h"
 #include "gui.h"
 #include "oslib/oslib.h"
 #include "wsi/context.h"
@@ -85,6 +86,11 @@ void mainui_loop(bool forceStart)
 		mainui_enabled = true;
 	mainui_init();
 	RenderType currentRenderer = config::RendererType;
+	if (tacapture::replayRequested())
+	{
+		tacapture::replay();
+		mainui_enabled = false;
+	}
 
 	while (mainui_enabled)
 	{
@@ -23,6 +23,7 @@
 #include "log/LogManager.h"
 #include "hw/maple/maple_if.h"
 #include "imgui_stdlib.h"
+#include "profiler/guest_profiler.h"
 
 #ifdef GDB_SERVER
 #include "hw/mem/addrspace.h"
@@ -175,6 +176,27 @@ static void gui_debug_tab()
         ImGui::SameLine();
         ShowHelpMarker("Log to this hostname[:port] with UDP. Default port is 31667.");
 	}
+	if (game_started)
+	{
+		ImGui::Spacing();
+		header("Guest Profiler");
+		{
+			static std::string profilePath;
+			if (!guestprof::active)
+			{
+				if (ImGui::Button("Start"))
+					guestprof::start();
+			}
+			else if (ImGui::Button("Stop and Save"))
+			{
+				profilePath = guestprof::stop();
+			}
+			ImGui::SameLine();
+			ShowHelpMarker("Profile the emulated SH4 code while the game is running. The result is saved in speedscope format.");
+			if (!profilePath.empty())
+				ImGui::Text("Saved to %s", profilePath.c_str());
+		}
+	}
 #if FC_PROFILER
 	ImGui::Spacing();
 	header("Profiling");
@@ -188,6 +210,7 @@ static void gui_debug_tab()
 		}
 		OptionCheckbox("Display", config::ProfilerDrawToGUI, "Draw the profiler output in an overlay.");
 		OptionCheckbox("Output to terminal", config::ProfilerOutputTTY, "Write the profiler output to the terminal");
+		OptionCheckbox("Write trace file", config::ProfilerTrace, "Stream the events of all threads to flycast_trace.json in Chrome trace format. Open it with Perfetto or chrome://tracing");
 		// TODO frame warning time
 		if (!config::ProfilerEnabled)
 		{
@@ -24,6 +24,9 @@ void gui_settings_audio()
 {
 	OptionCheckbox("Enable DSP", config::DSPEnabled,
 			"Enable the Dreamcast Digital Sound Processor. Only recommended on fast platforms");
+	OptionCheckbox("Threaded Sound CPU", config::ThreadedAica,
+			"Experimental. Run the sound CPU, channels and DSP on a separate thread. Sound interrupts and CD audio are processed "
+			"in batches of about 1 ms, which can break timing-sensitive games. Always disabled during netplay");
     OptionCheckbox("Enable VMU Sounds", config::VmuSound, "Play VMU beeps when enabled.");
 
 	if (OptionSlider("Volume Level", config::AudioVolume, 0, 100, "Adjust the emulator's audio level", "%d%%"))
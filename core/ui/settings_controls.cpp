@@ -209,6 +209,7 @@ static const Mapping dcButtons[] = {
 	{ EMU_BTN_SAVESTATE, "Save State" },
 	{ EMU_BTN_BYPASS_KB, "Bypass Emulated Keyboard" },
 	{ EMU_BTN_SCREENSHOT, "Save Screenshot" },
+	{ EMU_BTN_CAPTURE_FRAME, "Capture TA Frame" },
 
 	{ EMU_BTN_NONE, nullptr }
 };
@@ -263,6 +264,7 @@ static const Mapping arcadeButtons[] = {
 	{ EMU_BTN_SAVESTATE, "Save State" },
 	{ EMU_BTN_BYPASS_KB, "Bypass Emulated Keyboard" },
 	{ EMU_BTN_SCREENSHOT, "Save Screenshot" },
+	{ EMU_BTN_CAPTURE_FRAME, "Capture TA Frame" },
 
 	{ EMU_BTN_NONE, nullptr }
 };
@@ -160,6 +160,21 @@ void create_mappings(const Mapping *vmem_maps, unsigned nummaps) {
 	}
 }
 
+// Shadow mappings aren't supported
+void *reserve_shadow(size_t size) {
+	return nullptr;
+}
+
+void release_shadow(void *base, size_t size) {
+}
+
+bool map_shadow(void *dest, size_t size, size_t memoffset, bool allow_writes) {
+	return false;
+}
+
+void unmap_shadow(void *dest, size_t size) {
+}
+
 template<typename Mapper>
 static void *prepare_jit_block_template(size_t size, Mapper mapper)
 {
@@ -281,6 +281,21 @@ void release_jit_block(void *code_area1, void *code_area2, size_t size)
 	virtmemUnlock();
 }
 
+// Shadow mappings aren't supported
+void *reserve_shadow(size_t size) {
+	return nullptr;
+}
+
+void release_shadow(void *base, size_t size) {
+}
+
+bool map_shadow(void *dest, size_t size, size_t memoffset, bool allow_writes) {
+	return false;
+}
+
+void unmap_shadow(void *dest, size_t size) {
+}
+
 } // namespace virtmem
 
 #include <ucontext.h>
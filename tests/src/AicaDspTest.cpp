@@ -0,0 +1,138 @@
+#include "types.h"
+#include "hw/mem/addrspace.h"
+#include "hw/aica/aica.h"
+#include "hw/aica/aica_if.h"
+#include "hw/aica/dsp.h"
+#include "emulator.h"
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace aica::dsp {
+
+class AicaDspTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		emu.dc_reset(true);
+	}
+
+	static void setInstruction(int step, u32 w0, u32 w1, u32 w2, u32 w3)
+	{
+		DSPData->MPRO[step * 4] = w0;
+		DSPData->MPRO[step * 4 + 1] = w1;
+		DSPData->MPRO[step * 4 + 2] = w2;
+		DSPData->MPRO[step * 4 + 3] = w3;
+	}
+
+	static constexpr u32 RingSize = 8192;
+	static constexpr u32 Delay = 0x100;
+
+	// Delay line: EFREG0 = MIXS0 delayed by Delay samples, stored in the ring buffer as packed floats
+	void loadProgram()
+	{
+		memset(DSPData->MPRO, 0, sizeof(DSPData->MPRO));
+		DSPData->COEF[0] = 0x4000;	// 0.5
+		DSPData->COEF[6] = 0x4000;
+		DSPData->MADRS[0] = 0;
+		DSPData->MADRS[1] = Delay;
+		// 0: ACC = MIXS0 * 0.5
+		setInstruction(0, 0, 0x8000 | (1 << 13) | (0x20 << 7), 2, 0);
+		// 1: SHIFTED = ACC * 2, write it to the ring buffer
+		setInstruction(1, 0, 0, 0x4000 | (1 << 4) | 2, 0 << 9);
+		// 3: read the sample written Delay samples ago into MEMVAL1
+		setInstruction(3, 0, 0, 0x2000 | 2, 1 << 9);
+		// 5: MEMS0 = MEMVAL1
+		setInstruction(5, 0, 0x40 | (0 << 1), 2, 0);
+		// 6: ACC = MEMS0 * 0.5
+		setInstruction(6, 0, 0x8000 | (1 << 13) | (0 << 7), 2, 0);
+		// 7: EFREG0 = ACC * 2
+		setInstruction(7, 0, 0, 0x1000 | (0 << 8) | (1 << 4) | 2, 0);
+		state.RBL = RingSize - 1;
+		state.RBP = 0;
+		state.dirty = true;
+	}
+
+	// the ring buffer is cleared to packed zeros like sound drivers do
+	void clearRingBuffer()
+	{
+		const u16 zero = PACK(0);
+		for (u32 i = 0; i < RingSize; i++)
+			*(u16 *)&aica_ram[i * 2] = zero;
+		memset(state.TEMP, 0, sizeof(state.TEMP));
+		memset(state.MEMS, 0, sizeof(state.MEMS));
+		state.MDEC_CT = 1;
+	}
+
+	// short bursts separated by long silences
+	static s32 input(int sample) {
+		return sample % 20000 < 100 ? ((sample * 7919) & 0xfffff) - 0x80000 : 0;
+	}
+
+	static u32 output(u16 stored)
+	{
+		s32 v = UNPACK(stored);
+		v = std::clamp((v >> 1) << 1, -0x800000, 0x7fffff);
+		return v >> 8;
+	}
+};
+
+TEST_F(AicaDspTest, DelayLine)
+{
+	constexpr int Samples = 200000;
+	// the cpu writes to the delay line while the dsp is idle
+	constexpr int CpuWrite = Samples / 2 + 10000;
+	constexpr u16 CpuValue = 0x1234;
+	loadProgram();
+	clearRingBuffer();
+
+	// reference: the packed value read back at each sample
+	std::vector<u16> stored(Samples + Delay, PACK(0));
+	for (int i = 0; i < Samples; i++)
+		stored[i + Delay] = PACK(input(i) << 4);
+	stored[CpuWrite + Delay / 2] = CpuValue;
+
+	for (int i = 0; i < Samples; i++)
+	{
+		memset(state.MIXS, 0, sizeof(state.MIXS));
+		state.MIXS[0] = input(i);
+		if (i == CpuWrite)
+		{
+			// word read Delay / 2 samples later
+			u32 addr = (Delay / 2 + state.MDEC_CT) & state.RBL;
+			*(u16 *)&aica_ram[addr * 2] = CpuValue;
+		}
+		step();
+		ASSERT_EQ(output(stored[i]), DSPData->EFREG[0]) << "sample " << i;
+	}
+	ASSERT_EQ(RingSize + 1 - Samples % RingSize, state.MDEC_CT);
+	ASSERT_NE(0u, output(stored[CpuWrite + Delay / 2]));
+}
+
+// Not run by default: --gtest_also_run_disabled_tests --gtest_filter=AicaDspTest.*Timing
+TEST_F(AicaDspTest, DISABLED_IdleTiming)
+{
+	constexpr int Samples = 1000000;
+	loadProgram();
+	for (bool busy : { false, true })
+	{
+		clearRingBuffer();
+		memset(state.MIXS, 0, sizeof(state.MIXS));
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < Samples; i++)
+		{
+			if (busy)
+				state.MIXS[0] = (i & 0xff) + 1;
+			step();
+		}
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("DSP %d %s samples: %.2f ms\n", Samples, busy ? "busy" : "idle", elapsed * 1000.0);
+	}
+}
+
+} // namespace aica::dsp
@@ -0,0 +1,279 @@
+#include "types.h"
+#include "hw/mem/addrspace.h"
+#include "hw/aica/aica.h"
+#include "hw/aica/aica_if.h"
+#include "hw/aica/aica_mem.h"
+#include "hw/aica/dsp.h"
+#include "hw/aica/sgc_if.h"
+#include "audio/audiostream.h"
+#include "cfg/option.h"
+#include "serialize.h"
+#include "emulator.h"
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <vector>
+
+namespace aica::sgc {
+
+// Captures the mixed output
+class CaptureAudioBackend : public AudioBackend
+{
+public:
+	CaptureAudioBackend() : AudioBackend("test_capture", "Test capture") {}
+
+	bool init() override {
+		return true;
+	}
+
+	u32 push(const void *data, u32 frames, bool wait) override
+	{
+		const u32 *samples = (const u32 *)data;
+		output.insert(output.end(), samples, samples + frames);
+		return frames;
+	}
+
+	std::vector<u32> output;
+};
+static CaptureAudioBackend captureBackend;
+
+class AicaSgcTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		config::AudioBackend.set(captureBackend.slug);
+		InitAudio();
+		// LFO and noise generator states survive a reset, so each run restores them
+		emu.dc_reset(true);
+		Serializer dryrun;
+		serialize(dryrun);
+		initialState.resize(dryrun.size());
+		Serializer ser(initialState.data(), initialState.size());
+		serialize(ser);
+	}
+
+	void TearDown() override
+	{
+		TermAudio();
+		config::AudioBackend.reset();
+		config::DSPEnabled.reset();
+	}
+
+	static void writeReg(int channel, u32 reg, u16 value) {
+		writeAicaReg<u16>(channel * 0x80 + reg, value);
+	}
+
+	static void keyOn(int channel, bool on)
+	{
+		u16 reg0 = readAicaReg<u16>(channel * 0x80);
+		writeReg(channel, 0, (reg0 & ~0xc000) | (on ? 0xc000 : 0x8000));
+	}
+
+	struct Channel
+	{
+		int number;
+		u16 reg0;	// SSCTL, LPCTL, PCMS
+		u32 sa;
+		u16 lsa;
+		u16 lea;
+		u16 aeg;	// D2R, D1R, AR
+		u16 reg14;	// LPSLNK, KRS, DL, RR
+		u16 pitch;	// OCT, FNS
+		u16 lfo;	// LFORE, LFOF, PLFOWS, PLFOS, ALFOWS, ALFOS
+		u16 dspSend;	// IMXL, ISEL
+		u16 direct;	// DISDL, DIPAN
+		u16 tl;	// TL, VOFF, LPOFF, Q
+	};
+
+	static constexpr u16 PCM16 = 0 << 7;
+	static constexpr u16 PCM8 = 1 << 7;
+	static constexpr u16 ADPCM = 2 << 7;
+	static constexpr u16 LOOP = 1 << 9;
+	static constexpr u16 NOISE = 1 << 10;
+	static constexpr u16 LPOFF = 1 << 5;
+	static constexpr u16 VOFF = 1 << 6;
+
+	static const Channel channels[9];
+
+	void setup()
+	{
+		// MVOL
+		writeAicaReg<u16>(0x2800, 0xf);
+		// wave data
+		u32 seed = 1;
+		for (u32 i = 0; i < 0x10000; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			aica_ram[i] = seed >> 16;
+		}
+		for (const Channel& c : channels)
+		{
+			writeReg(c.number, 0, c.reg0 | ((c.sa >> 16) & 0x7f));
+			writeReg(c.number, 4, c.sa & 0xffff);
+			writeReg(c.number, 8, c.lsa);
+			writeReg(c.number, 0xc, c.lea);
+			writeReg(c.number, 0x10, c.aeg);
+			writeReg(c.number, 0x14, c.reg14);
+			writeReg(c.number, 0x18, c.pitch);
+			writeReg(c.number, 0x1c, c.lfo);
+			writeReg(c.number, 0x20, c.dspSend);
+			writeReg(c.number, 0x24, c.direct);
+			writeReg(c.number, 0x28, c.tl);
+			// filter envelope
+			writeReg(c.number, 0x2c, 0x0800);
+			writeReg(c.number, 0x30, 0x1fff);
+			writeReg(c.number, 0x34, 0x1000);
+			writeReg(c.number, 0x38, 0x0400);
+			writeReg(c.number, 0x3c, 0x0200);
+			writeReg(c.number, 0x40, (20 << 8) | 12);
+			writeReg(c.number, 0x44, (8 << 8) | 16);
+		}
+	}
+
+	struct Trace
+	{
+		std::vector<u32> output;
+		std::vector<s32> mixs;
+		std::vector<u16> regs[std::size(channels)];
+	};
+
+	// Only the channels in the keyed mask are keyed on and off
+	Trace run(u64 keyed, bool dspEnabled)
+	{
+		emu.dc_reset(true);
+		Deserializer deser(initialState.data(), initialState.size());
+		deserialize(deser);
+		config::DSPEnabled = dspEnabled;
+		captureBackend.output.clear();
+		setup();
+
+		auto key = [keyed](int channel, bool on) {
+			if (keyed & (1ull << channel))
+				keyOn(channel, on);
+		};
+		Trace trace;
+		for (int i = 0; i < Samples; i++)
+		{
+			switch (i)
+			{
+			case 0:
+				for (const Channel& c : channels)
+					key(c.number, true);
+				break;
+			case 2000:
+				// key off while playing
+				key(3, false);
+				key(0, false);
+				break;
+			case 3000:
+				// pitch change while playing
+				writeReg(2, 0x18, (2 << 11) | 0x155);
+				break;
+			case 4000:
+				// key on again: one channel has stopped at the end of its sample, the other is being released or off
+				key(5, true);
+				key(3, true);
+				break;
+			case 6000:
+				for (const Channel& c : channels)
+					key(c.number, false);
+				break;
+			}
+			AICA_Sample();
+			trace.mixs.insert(trace.mixs.end(), std::begin(dsp::state.MIXS), std::end(dsp::state.MIXS));
+			if (i % 32 == 0)
+			{
+				// channel monitor registers
+				for (size_t j = 0; j < std::size(channels); j++)
+				{
+					writeAicaReg<u8>(0x280d, channels[j].number);	// MSLC
+					trace.regs[j].push_back(readAicaReg<u16>(0x2810));	// EG, SGC, LP
+					trace.regs[j].push_back(readAicaReg<u16>(0x2814));	// CA
+				}
+			}
+		}
+		trace.output = captureBackend.output;
+
+		return trace;
+	}
+
+	// Channels don't interact, so the reference output is computed by playing each channel alone
+	// and summing the results. With MVOL at max, the final mix only adds clipping.
+	void compare(bool dspEnabled)
+	{
+		Trace mixed = run(~0ull, dspEnabled);
+		ASSERT_EQ((size_t)Samples, mixed.output.size());
+
+		std::vector<s32> left(Samples);
+		std::vector<s32> right(Samples);
+		std::vector<s32> mixs(mixed.mixs.size());
+		for (size_t j = 0; j < std::size(channels); j++)
+		{
+			Trace solo = run(1ull << channels[j].number, dspEnabled);
+			ASSERT_EQ((size_t)Samples, solo.output.size());
+			ASSERT_EQ(solo.regs[j], mixed.regs[j]) << "channel " << channels[j].number;
+			bool nonZero = false;
+			for (int i = 0; i < Samples; i++)
+			{
+				left[i] += (s16)solo.output[i];
+				right[i] += (s16)(solo.output[i] >> 16);
+				nonZero |= solo.output[i] != 0;
+			}
+			for (size_t i = 0; i < mixs.size(); i++)
+			{
+				mixs[i] += solo.mixs[i];
+				nonZero |= solo.mixs[i] != 0;
+			}
+			ASSERT_TRUE(nonZero) << "channel " << channels[j].number;
+		}
+		for (int i = 0; i < Samples; i++)
+		{
+			ASSERT_EQ(std::clamp(left[i], -32768, 32767), (s16)mixed.output[i]) << "sample " << i;
+			ASSERT_EQ(std::clamp(right[i], -32768, 32767), (s16)(mixed.output[i] >> 16)) << "sample " << i;
+		}
+		ASSERT_EQ(mixs, mixed.mixs);
+	}
+
+	static constexpr int Samples = 8192;
+	std::vector<u8> initialState;
+};
+
+const AicaSgcTest::Channel AicaSgcTest::channels[9] = {
+	// 16-bit loop, triangle LFOs
+	{ 0, PCM16 | LOOP, 0x1000, 0x20, 0x300, (5 << 11) | (10 << 6) | 31, (8 << 5) | 20, 0x200,
+			(8 << 10) | (2 << 8) | (3 << 5) | (2 << 3) | 4, 0x80, (15 << 8) | 0, (0x10 << 8) | LPOFF },
+	// 8-bit without loop: stops at the end of the sample, low pass filter
+	{ 1, PCM8, 0x4000, 0, 0x800, 31, 31, 1 << 11, 0, 0, (13 << 8) | 0x1f, (0x08 << 8) | 4 },
+	// ADPCM loop, random LFOs, DSP send
+	{ 2, ADPCM | LOOP, 0x6000, 0x100, 0x900, 31, 10, 0x100,
+			(3 << 10) | (3 << 8) | (2 << 5) | (3 << 3) | 2, 0xf1, (10 << 8) | 0x10, LPOFF },
+	// noise, keyed off and on again
+	{ 3, NOISE, 0, 0, 0, 31, 28, 0, 0, 0, (12 << 8) | 5, LPOFF },
+	// loop start link, slow attack, LFO reset, square LFOs, low pitch
+	{ 4, PCM16 | LOOP, 0x2000, 0x40, 0x400, 10, (1 << 14) | (4 << 10) | (4 << 5) | 14, (0xe << 11) | 0x80,
+			0x8000 | (31 << 10) | (1 << 8) | (7 << 5) | (1 << 3) | 7, 0, (15 << 8) | 0x0f, 0x20 << 8 },
+	// short sample without loop, keyed on again after it stopped
+	{ 5, PCM16, 0x3000, 0, 0x40, 31, 31, 0x3ff, 0, 0, (9 << 8) | 0x18, LPOFF },
+	// DSP send only, no attenuation
+	{ 6, PCM16 | LOOP, 0x5000, 0, 0x200, 31, 31, 0, 0, 0x42, 0, VOFF | LPOFF },
+	// ADPCM without loop in the upper half of the channel mask
+	{ 32, ADPCM, 0x8000, 0, 0x1000, (2 << 11) | (20 << 6) | 31, (16 << 5) | 25, 0x300, 0, 0x23, (11 << 8) | 0x03, 0x04 << 8 },
+	// last channel, high pitch 8-bit loop, sawtooth LFOs
+	{ 63, PCM8 | LOOP, 0x9000, 0x10, 0x700, 31, 18, (7 << 11) | 0x3ff,
+			(16 << 10) | (0 << 8) | (5 << 5) | (0 << 3) | 5, 0, (14 << 8) | 0x0a, (0x04 << 8) | 8 },
+};
+
+TEST_F(AicaSgcTest, MixMatchesSoloChannels)
+{
+	compare(false);
+}
+
+TEST_F(AicaSgcTest, MixMatchesSoloChannelsWithDsp)
+{
+	compare(true);
+}
+
+} // namespace aica::sgc
@@ -0,0 +1,209 @@
+#include "gtest/gtest.h"
+#include "hw/pvr/elan_vertex.h"
+#include <cstring>
+#include <random>
+
+using namespace elan;
+
+class ElanVertexTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		data.resize(4096);
+		params.matrix = glm::mat4(
+				0.8f, -0.3f, 0.5f, 0.f,
+				0.2f, 0.9f, -0.4f, 0.f,
+				-0.5f, 0.3f, 0.7f, 0.f,
+				10.f, -5.f, -50.f, 1.f);
+		params.nearPlane = 1.5f;
+		params.envMapU = 0.25f;
+		params.envMapV = 0.75f;
+	}
+
+	template<typename T>
+	ICHList *makeList(u32 flags, u32 count)
+	{
+		ICHList *list = (ICHList *)data.data();
+		list->flags = flags;
+		list->vtxCount = count;
+		T *vtx = (T *)&data[sizeof(ICHList)];
+		u8 *bytes = (u8 *)vtx;
+		for (u32 i = 0; i < count * sizeof(T); i++)
+			bytes[i] = (u8)rng();
+		std::uniform_real_distribution<float> coord(-100.f, 100.f);
+		for (u32 i = 0; i < count; i++)
+		{
+			vtx[i].x = coord(rng);
+			vtx[i].y = coord(rng);
+			vtx[i].z = coord(rng);
+		}
+		return list;
+	}
+
+	static u32 bits(float f)
+	{
+		u32 v;
+		memcpy(&v, &f, sizeof(v));
+		return v;
+	}
+
+	static u32 packColor(const glm::vec4& color, bool bgra)
+	{
+		if (bgra)
+			return (int)(std::min(1.f, color.a) * 255.f) << 24
+					| (int)(std::min(1.f, color.r) * 255.f) << 16
+					| (int)(std::min(1.f, color.g) * 255.f) << 8
+					| (int)(std::min(1.f, color.b) * 255.f);
+		else
+			return (int)(std::min(1.f, color.r) * 255.f)
+					| (int)(std::min(1.f, color.g) * 255.f) << 8
+					| (int)(std::min(1.f, color.b) * 255.f) << 16
+					| (int)(std::min(1.f, color.a) * 255.f) << 24;
+	}
+
+	static glm::vec4 unpackColor(u32 color)
+	{
+		return glm::vec4((float)((color >> 16) & 0xff) / 255.f,
+				(float)((color >> 8) & 0xff) / 255.f,
+				(float)(color & 0xff) / 255.f,
+				(float)(color >> 24) / 255.f);
+	}
+
+	// Per-vertex conversion using float colors
+	template<typename T>
+	void checkList(const ICHList *list, const ConvertedList& converted)
+	{
+		const T *vtx = (const T *)((const u8 *)list + sizeof(ICHList));
+		ASSERT_EQ(list->vtxCount, converted.vertices.size());
+		glm::vec3 min(1e38f);
+		glm::vec3 max(-1e38f);
+		for (u32 i = 0; i < list->vtxCount; i++)
+		{
+			const T& vs = vtx[i];
+			const Vertex& vd = converted.vertices[i];
+			ASSERT_EQ(vs.x, vd.x);
+			ASSERT_EQ(vs.y, vd.y);
+			ASSERT_EQ(vs.z, vd.z);
+			ASSERT_EQ((int8_t)vs.header.nx / 127.f, vd.nx);
+			ASSERT_EQ((int8_t)vs.header.ny / 127.f, vd.ny);
+			ASSERT_EQ((int8_t)vs.header.nz / 127.f, vd.nz);
+			const glm::mat4& m = params.matrix;
+			float z = vs.x * m[0][2] + vs.y * m[1][2] + vs.z * m[2][2] + m[3][2];
+			ASSERT_EQ(-z - params.nearPlane, converted.nearDist[i]);
+			min = glm::min(min, glm::vec3(vs.x, vs.y, vs.z));
+			max = glm::max(max, glm::vec3(vs.x, vs.y, vs.z));
+
+			glm::vec4 baseCol0(1);
+			glm::vec4 baseCol1(1);
+			if constexpr (std::is_same_v<T, N2_VERTEX_VR> || std::is_same_v<T, N2_VERTEX_VUR>)
+			{
+				baseCol0 = unpackColor(vs.rgb.argb0);
+				baseCol1 = unpackColor(vs.rgb.argb1);
+			}
+			if (params.diffuse0)
+				baseCol0 = unpackColor(gmpColor);
+			ASSERT_EQ(packColor(baseCol0, params.bgra), *(const u32 *)vd.col);
+			ASSERT_EQ(packColor(baseCol1, params.bgra), *(const u32 *)vd.col1);
+			if constexpr (std::is_same_v<T, N2_VERTEX_VUB>)
+			{
+				ASSERT_EQ((u8)vs.bump.tangent.y, vd.spc[1]);
+				ASSERT_EQ((u8)vs.bump.bitangent.z, vd.spc1[2]);
+				ASSERT_EQ(vs.bump.scaleFactor.bumpDegree, vd.spc[3]);
+			}
+			else
+			{
+				ASSERT_EQ(0u, *(const u32 *)vd.spc);
+				ASSERT_EQ(0u, *(const u32 *)vd.spc1);
+			}
+			if constexpr (std::is_same_v<T, N2_VERTEX>)
+			{
+				ASSERT_EQ(params.envMapping ? params.envMapU : 0.f, vd.u);
+			}
+			else if constexpr (!std::is_same_v<T, N2_VERTEX_VR>)
+			{
+				ASSERT_EQ(bits(params.envMapping ? params.envMapU : vs.uv.u), bits(vd.u));
+				ASSERT_EQ(bits(params.envMapping ? params.envMapV : vs.uv.v), bits(vd.v1));
+			}
+		}
+		glm::vec4 center((min + max) / 2.f, 1);
+		glm::vec4 extents(max - glm::vec3(center), 0);
+		center = params.matrix * center;
+		glm::vec3 newExtent = glm::abs(glm::vec3(params.matrix * glm::vec4(extents.x, 0, 0, 0)))
+				+ glm::abs(glm::vec3(params.matrix * glm::vec4(0, extents.y, 0, 0)))
+				+ glm::abs(glm::vec3(params.matrix * glm::vec4(0, 0, extents.z, 0)));
+		ASSERT_EQ(glm::vec3(center) - newExtent, converted.min);
+		ASSERT_EQ(glm::vec3(center) + newExtent, converted.max);
+	}
+
+	template<typename T>
+	void test(u32 flags)
+	{
+		for (u32 count = 0; count <= 13; count++)
+		{
+			for (int variant = 0; variant < 4; variant++)
+			{
+				params.bgra = variant & 1;
+				params.envMapping = variant & 2;
+				params.diffuse0 = variant == 3;
+				params.diffuseColor0 = params.packColor(gmpColor);
+				const ICHList *list = makeList<T>(flags, count);
+				ConvertedList converted;
+				convertVertices(list, params, converted);
+				checkList<T>(list, converted);
+			}
+		}
+	}
+
+	std::vector<u8> data;
+	VertexParams params;
+	std::mt19937 rng{ 1234 };
+	const u32 gmpColor = 0x80ff4020;
+};
+
+TEST_F(ElanVertexTest, Convert)
+{
+	test<N2_VERTEX>(ICHList::VTX_TYPE_V);
+	test<N2_VERTEX_VU>(ICHList::VTX_TYPE_VU);
+	test<N2_VERTEX_VR>(ICHList::VTX_TYPE_VR);
+	test<N2_VERTEX_VUR>(ICHList::VTX_TYPE_VUR);
+	test<N2_VERTEX_VUB>(ICHList::VTX_TYPE_VUB);
+}
+
+TEST_F(ElanVertexTest, ListConverter)
+{
+	// several lists converted ahead of time
+	std::vector<std::vector<u8>> lists;
+	ListConverter converter;
+	for (int i = 0; i < 8; i++)
+	{
+		makeList<N2_VERTEX_VU>(ICHList::VTX_TYPE_VU, 100);
+		lists.push_back(data);
+		converter.add((const ICHList *)lists.back().data(), params);
+	}
+	converter.start();
+	for (int i = 0; i < 8; i++)
+	{
+		const ICHList *list = (const ICHList *)lists[i].data();
+		if (i == 2)
+		{
+			converter.skip(list);
+			continue;
+		}
+		VertexParams other = params;
+		if (i == 5)
+			other.nearPlane = 2.f;
+		const ConvertedList *converted = converter.get(list, other);
+		if (i == 5)
+		{
+			// different state
+			ASSERT_EQ(nullptr, converted);
+			continue;
+		}
+		ASSERT_NE(nullptr, converted);
+		checkList<N2_VERTEX_VU>(list, *converted);
+	}
+	// not prepared
+	ASSERT_EQ(nullptr, converter.get((const ICHList *)lists[0].data(), params));
+	converter.finish();
+}
@@ -0,0 +1,138 @@
+#include "gtest/gtest.h"
+#include "rend/fb_convert.h"
+#include <random>
+#include <vector>
+
+class FbConvertTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		std::mt19937 rng(42);
+		pixels.resize(MaxCount * 4);
+		for (u8& c : pixels)
+			c = (u8)rng();
+		// extreme values
+		pixels[0] = pixels[1] = pixels[2] = pixels[3] = 0xff;
+		pixels[4] = pixels[5] = pixels[6] = pixels[7] = 0;
+		words.resize(MaxCount);
+		for (u32& w : words)
+			w = rng();
+	}
+
+	static u32 reduce(u32 c, int bits, bool round)
+	{
+		if (round)
+			c = std::min(c + (1 << (7 - bits)), 255u);
+		return c >> (8 - bits);
+	}
+
+	template<bool Round>
+	void test16()
+	{
+		std::vector<u16> out(MaxCount);
+		for (u32 count = 0; count <= MaxCount; count++)
+		{
+			fbconv::pack0555<0, 1, 2, 3, Round>(pixels.data(), out.data(), count, 0x8000);
+			for (u32 i = 0; i < count; i++)
+			{
+				const u8 *p = &pixels[i * 4];
+				ASSERT_EQ((reduce(p[0], 5, Round) << 10) | (reduce(p[1], 5, Round) << 5) | reduce(p[2], 5, Round) | 0x8000, out[i]);
+			}
+			fbconv::pack565<2, 1, 0, 3, Round>(pixels.data(), out.data(), count);
+			for (u32 i = 0; i < count; i++)
+			{
+				const u8 *p = &pixels[i * 4];
+				ASSERT_EQ((reduce(p[2], 5, Round) << 11) | (reduce(p[1], 6, Round) << 5) | reduce(p[0], 5, Round), out[i]);
+			}
+			fbconv::pack4444<0, 1, 2, 3, Round>(pixels.data(), out.data(), count);
+			for (u32 i = 0; i < count; i++)
+			{
+				const u8 *p = &pixels[i * 4];
+				ASSERT_EQ((reduce(p[3], 4, Round) << 12) | (reduce(p[0], 4, Round) << 8)
+						| (reduce(p[1], 4, Round) << 4) | reduce(p[2], 4, Round), out[i]);
+			}
+			for (u8 threshold : { 0, 1, 0x80, 0xff })
+			{
+				fbconv::pack1555<0, 1, 2, 3, Round>(pixels.data(), out.data(), count, threshold);
+				for (u32 i = 0; i < count; i++)
+				{
+					const u8 *p = &pixels[i * 4];
+					ASSERT_EQ((reduce(p[0], 5, Round) << 10) | (reduce(p[1], 5, Round) << 5) | reduce(p[2], 5, Round)
+							| (p[3] >= threshold ? 0x8000 : 0), out[i]);
+				}
+			}
+		}
+	}
+
+	static constexpr u32 MaxCount = 40;
+	std::vector<u8> pixels;
+	std::vector<u32> words;
+};
+
+TEST_F(FbConvertTest, Pack16)
+{
+	test16<false>();
+	test16<true>();
+}
+
+TEST_F(FbConvertTest, Pack32)
+{
+	std::vector<u32> out(MaxCount);
+	std::vector<u8> out24(MaxCount * 3);
+	for (u32 count = 0; count <= MaxCount; count++)
+	{
+		fbconv::pack0888<2, 1, 0, 3>(pixels.data(), out.data(), count, 0x80000000);
+		for (u32 i = 0; i < count; i++)
+		{
+			const u8 *p = &pixels[i * 4];
+			ASSERT_EQ((p[2] << 16) | (p[1] << 8) | p[0] | 0x80000000, out[i]);
+		}
+		fbconv::pack8888<0, 1, 2, 3>(pixels.data(), out.data(), count);
+		for (u32 i = 0; i < count; i++)
+		{
+			const u8 *p = &pixels[i * 4];
+			ASSERT_EQ(((u32)p[3] << 24) | (p[0] << 16) | (p[1] << 8) | p[2], out[i]);
+		}
+		fbconv::pack888<0, 1, 2, 3>(pixels.data(), out24.data(), count);
+		for (u32 i = 0; i < count; i++)
+		{
+			ASSERT_EQ(pixels[i * 4 + 2], out24[i * 3]);
+			ASSERT_EQ(pixels[i * 4 + 1], out24[i * 3 + 1]);
+			ASSERT_EQ(pixels[i * 4], out24[i * 3 + 2]);
+		}
+	}
+}
+
+TEST_F(FbConvertTest, Unpack)
+{
+	const u16 *src16 = (const u16 *)words.data();
+	std::vector<u32> out(MaxCount * 4 / 3);
+	for (u32 count = 0; count <= MaxCount; count++)
+	{
+		for (u32 concat : { 0, 7 })
+		{
+			fbconv::unpack0555<RGBAPacker>(src16, out.data(), count, concat);
+			for (u32 i = 0; i < count; i++)
+			{
+				const u16 s = src16[i];
+				ASSERT_EQ(RGBAPacker::pack((((s >> 10) & 0x1F) << 3) | concat, (((s >> 5) & 0x1F) << 3) | concat,
+						((s & 0x1F) << 3) | concat, 0xff), out[i]);
+			}
+			fbconv::unpack565<BGRAPacker>(src16, out.data(), count, concat);
+			for (u32 i = 0; i < count; i++)
+			{
+				const u16 s = src16[i];
+				ASSERT_EQ(BGRAPacker::pack((((s >> 11) & 0x1F) << 3) | concat, (((s >> 5) & 0x3F) << 2) | (concat & 3),
+						((s & 0x1F) << 3) | concat, 0xff), out[i]);
+			}
+		}
+		fbconv::unpack0888<BGRAPacker>(words.data(), out.data(), count);
+		for (u32 i = 0; i < count; i++)
+			ASSERT_EQ(BGRAPacker::pack(words[i] >> 16, words[i] >> 8, words[i], 0xff), out[i]);
+		fbconv::unpack888<RGBAPacker>(words.data(), out.data(), count * 4 / 3);
+		const u8 *p = (const u8 *)words.data();
+		for (u32 i = 0; i < count * 4 / 3; i++)
+			ASSERT_EQ(RGBAPacker::pack(p[i * 3 + 2], p[i * 3 + 1], p[i * 3], 0xff), out[i]);
+	}
+}
@@ -233,3 +233,99 @@ TEST_F(MmuTest, TestErrors)
 	ASSERT_EQ(MmuError::FIRSTWRITE, err);
 #endif
 }
+
+#ifdef FAST_MMU
+class FastMmuTest : public MmuTest
+{
+protected:
+	static void loadEntry(u32 index, u32 vaddr, u32 paddr, u32 asid, bool shared = false)
+	{
+		UTLB[index].Address.VPN = vaddr >> 10;
+		UTLB[index].Address.ASID = asid;
+		UTLB[index].Data.PPN = paddr >> 10;
+		UTLB[index].Data.SZ0 = 1;
+		UTLB[index].Data.SZ1 = 0;
+		UTLB[index].Data.SH = shared;
+		UTLB[index].Data.V = 1;
+		UTLB[index].Data.PR = 3;
+		UTLB[index].Data.D = 1;
+		UTLB_Sync(index);
+	}
+
+	static void switchAsid(u32 asid)
+	{
+		mmuAddressLUTSwitchAsid(CCN_PTEH.ASID, asid);
+		CCN_PTEH.ASID = asid;
+	}
+
+	// What the dynarec does on a LUT miss
+	static u32 access(u32 vaddr)
+	{
+		u32 pa;
+		MmuError err = mmu_data_translation<MMU_TT_DREAD>(vaddr, pa);
+		EXPECT_EQ(MmuError::NONE, err);
+		mmuAddressLUTSet(vaddr, pa);
+		return pa;
+	}
+
+	static u32 lut(u32 vaddr) {
+		return mmuAddressLUT[vaddr >> 12];
+	}
+};
+
+TEST_F(FastMmuTest, AsidRestore)
+{
+	switchAsid(1);
+	loadEntry(0, 0x01000000, 0x0C100000, 1);
+	ASSERT_EQ(0x0C100010u, access(0x01000010));
+	ASSERT_EQ(0x0C100000u, lut(0x01000000));
+
+	// the LUT page is saved and restored
+	switchAsid(2);
+	ASSERT_EQ(0u, lut(0x01000000));
+	switchAsid(1);
+	ASSERT_EQ(0x0C100000u, lut(0x01000000));
+}
+
+TEST_F(FastMmuTest, EvictedEntry)
+{
+	switchAsid(1);
+	loadEntry(0, 0x01000000, 0x0C100000, 1);
+	ASSERT_EQ(0x0C100010u, access(0x01000010));
+
+	// the entry is evicted while another process runs
+	switchAsid(2);
+	loadEntry(0, 0x01800000, 0x0C200000, 2);
+	ASSERT_EQ(0x0C200020u, access(0x01800020));
+	switchAsid(1);
+	// the saved page of the evicted entry isn't restored
+	ASSERT_EQ(0u, lut(0x01000000));
+
+	// the entry is evicted while its process runs
+	loadEntry(1, 0x01000000, 0x0C300000, 1);
+	ASSERT_EQ(0x0C300000u, access(0x01000000));
+	loadEntry(1, 0x01400000, 0x0C400000, 3);
+	ASSERT_EQ(0u, lut(0x01000000));
+	switchAsid(3);
+	ASSERT_EQ(0x0C400000u, access(0x01400000));
+	switchAsid(1);
+	ASSERT_EQ(0u, lut(0x01000000));
+}
+
+TEST_F(FastMmuTest, EvictedSharedEntry)
+{
+	switchAsid(1);
+	loadEntry(0, 0x01000000, 0x0C100000, 0, true);
+	ASSERT_EQ(0x0C100000u, access(0x01000000));
+	switchAsid(2);
+	ASSERT_EQ(0x0C100000u, access(0x01000000));
+
+	// evicting a shared entry invalidates the saved pages of all processes
+	switchAsid(3);
+	loadEntry(0, 0x01800000, 0x0C200000, 3);
+	switchAsid(1);
+	ASSERT_EQ(0u, lut(0x01000000));
+	switchAsid(2);
+	ASSERT_EQ(0u, lut(0x01000000));
+}
+#endif
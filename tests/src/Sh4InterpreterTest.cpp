@@ -102,3 +102,16 @@ TEST_F(Sh4InterpreterTest, DoubleFloatingPointTest)
 {
 	Sh4OpTest::DoubleFloatingPointTest();
 }
+TEST_F(Sh4InterpreterTest, SelfModifyingCodeTest)
+{
+	ClearRegs();
+	PrepareOp(0xe000 | Rn(1) | Imm8(1));	// mov #1, R1
+	RunOp();
+	ASSERT_EQ(r(1), 1u);
+
+	// overwrite the instruction through a different RAM mirror
+	addrspace::write16(START_PC - 0x20000000, 0xe000 | Rn(1) | Imm8(2));	// mov #2, R1
+	RunOp();
+	ASSERT_EQ(r(1), 2u);
+	AssertState();
+}
@@ -0,0 +1,85 @@
+#include "types.h"
+#include "hw/pvr/ta_ctx.h"
+#include "hw/pvr/ta.h"
+
+#include "gtest/gtest.h"
+
+class TaUtilTest : public ::testing::Test {
+protected:
+	// Adds a quad strip covering the given rectangle
+	void addPoly(std::vector<PolyParam>& polys, u32 texAddr, float x, float y, float size)
+	{
+		PolyParam pp;
+		pp.init();
+		pp.first = ctx.verts.size();
+		pp.count = 4;
+		pp.pcw.Texture = 1;
+		pp.tcw.TexAddr = texAddr;
+		pp.isp.DepthMode = 6;
+		for (int i = 0; i < 4; i++)
+		{
+			Vertex vtx{};
+			vtx.x = x + (i & 1) * size;
+			vtx.y = y + (i >> 1) * size;
+			vtx.z = 1.f;
+			ctx.verts.push_back(vtx);
+		}
+		polys.push_back(pp);
+	}
+
+	std::vector<u32> texAddresses(const std::vector<PolyParam>& polys)
+	{
+		std::vector<u32> addresses;
+		for (const PolyParam& pp : polys)
+			addresses.push_back(pp.tcw.TexAddr);
+		return addresses;
+	}
+
+	rend_context ctx{};
+};
+
+TEST_F(TaUtilTest, GroupNonOverlapping)
+{
+	std::vector<PolyParam> polys;
+	addPoly(polys, 1, 0, 0, 10);
+	addPoly(polys, 2, 20, 0, 10);
+	addPoly(polys, 1, 40, 0, 10);
+	addPoly(polys, 2, 60, 0, 10);
+	groupPolyParams(polys, 0, polys.size(), ctx);
+	ASSERT_EQ((std::vector<u32>{ 1, 1, 2, 2 }), texAddresses(polys));
+
+	makeIndex(polys, 0, polys.size(), true, ctx);
+	ASSERT_NE(0u, polys[0].count);
+	ASSERT_EQ(0u, polys[1].count);
+	ASSERT_NE(0u, polys[2].count);
+	ASSERT_EQ(0u, polys[3].count);
+}
+
+TEST_F(TaUtilTest, KeepOverlappingOrder)
+{
+	std::vector<PolyParam> polys;
+	addPoly(polys, 1, 0, 0, 10);
+	addPoly(polys, 2, 20, 0, 10);
+	// overlaps the previous polygon
+	addPoly(polys, 1, 25, 5, 10);
+	groupPolyParams(polys, 0, polys.size(), ctx);
+	ASSERT_EQ((std::vector<u32>{ 1, 2, 1 }), texAddresses(polys));
+}
+
+TEST_F(TaUtilTest, Naomi2Barrier)
+{
+	std::vector<PolyParam> polys;
+	addPoly(polys, 1, 0, 0, 10);
+	addPoly(polys, 2, 20, 0, 10);
+	polys.back().projMatrix = 0;
+	addPoly(polys, 1, 40, 0, 10);
+	groupPolyParams(polys, 0, polys.size(), ctx);
+	ASSERT_EQ((std::vector<u32>{ 1, 2, 1 }), texAddresses(polys));
+}
+
+// The store queue fast paths skip the state machine for these parameters
+TEST_F(TaUtilTest, VertexContinuationKeepsState)
+{
+	for (u32 obj = 0; obj < 32; obj++)
+		ASSERT_EQ((u8)TAS_PLV32, ta_fsm[(TAS_PLV32 << 8) | (ParamType_Vertex_Parameter << 5) | obj]);
+}
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "rend/texture_upscaler.h"
+#include "deps/xbrz/xbrz.h"
+#include <cstring>
+
+#include "test_utils.h"
+
+class TextureUpscalerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		pixels.resize(32 * 32);
+		for (size_t i = 0; i < pixels.size(); i++)
+			pixels[i] = 0xff000000 | (u32)(i * 2654435761u);
+	}
+
+	void TearDown() override {
+		textureUpscaler.term();
+	}
+
+	bool waitDone(const std::shared_ptr<UpscaleJob>& job)
+	{
+		for (int i = 0; i < 200 && !job->isDone(); i++)
+			usleep(10'000);
+		return job->isDone();
+	}
+
+	std::vector<u32> pixels;
+};
+
+TEST_F(TextureUpscalerTest, Upscale)
+{
+	std::shared_ptr<UpscaleJob> job = textureUpscaler.upscale(pixels.data(), 32, 32, 2, false);
+	ASSERT_TRUE(waitDone(job));
+	ASSERT_EQ(64, job->getWidth());
+	ASSERT_EQ(64, job->getHeight());
+
+	std::vector<u32> reference(64 * 64);
+	xbrz::scale(2, pixels.data(), reference.data(), 32, 32, xbrz::ColorFormat::RGB, xbrz::ScalerCfg());
+	ASSERT_EQ(0, memcmp(reference.data(), job->data(), reference.size() * sizeof(u32)));
+
+	// Same pixels: result from cache
+	job = textureUpscaler.upscale(pixels.data(), 32, 32, 2, false);
+	ASSERT_TRUE(job->isDone());
+	// Different factor
+	job = textureUpscaler.upscale(pixels.data(), 32, 32, 3, false);
+	ASSERT_TRUE(waitDone(job));
+	ASSERT_EQ(96, job->getWidth());
+}
+
+TEST_F(TextureUpscalerTest, Cancel)
+{
+	std::vector<std::shared_ptr<UpscaleJob>> jobs;
+	for (int i = 0; i < 10; i++)
+	{
+		pixels[0] = i;
+		jobs.push_back(textureUpscaler.upscale(pixels.data(), 32, 32, 2, false));
+	}
+	textureUpscaler.cancel(jobs.back());
+	for (int i = 0; i < 9; i++)
+		ASSERT_TRUE(waitDone(jobs[i]));
+	usleep(50'000);
+	ASSERT_FALSE(jobs.back()->isDone());
+}